@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+  Golden checks and timing of the queued bit copies drivers like mpsse use
+  to scatter the bits read back into the scan fields.
+
+  The checks compare bit_copy() with a bit by bit reference for random
+  offsets and lengths, including the bits around the destination range,
+  which must be preserved, and run the same copies through a queue.
+
+  The timing queues the fields of 4096 scans per run, laid out in the read
+  buffer the way mpsse lays them out: each scan starts on a byte, its
+  fields follow each other bit by bit. The scan mixes are
+  - ADIv5 DPACC/APACC: 3 bit ACK + 32 bit data,
+  - RISC-V DMI: 2 bit op + 32 bit data + 7 bit address,
+  - long 4096 bit data scans.
+
+  To compile, from a configured build directory:
+  gcc -Wall -O2 -DHAVE_CONFIG_H -I. -I<src>/src -I<src>/src/helper \
+	  -o bit_copy_bench <src>/contrib/bench/bit_copy_bench.c \
+	  <src>/src/helper/binarybuffer.c
+
+  Usage:
+  ./bit_copy_bench [runs, default 2000]
+*/
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <helper/binarybuffer.h>
+
+static int failures;
+
+static void check(bool ok, const char *what, unsigned int dst_offset,
+		unsigned int src_offset, unsigned int bit_count)
+{
+	if (!ok) {
+		printf("FAIL: %s, dst offset %u, src offset %u, %u bits\n",
+			what, dst_offset, src_offset, bit_count);
+		failures++;
+	}
+}
+
+static void ref_bit_copy(uint8_t *dst, unsigned int dst_offset, const uint8_t *src,
+		unsigned int src_offset, unsigned int bit_count)
+{
+	for (unsigned int i = 0; i < bit_count; i++) {
+		unsigned int s = src_offset + i, d = dst_offset + i;
+		if (src[s / 8] & (1 << (s % 8)))
+			dst[d / 8] |= 1 << (d % 8);
+		else
+			dst[d / 8] &= ~(1 << (d % 8));
+	}
+}
+
+static void golden_checks(void)
+{
+	enum { BUF_SIZE = 700 };
+	uint8_t src[BUF_SIZE], dst[BUF_SIZE], ref[BUF_SIZE];
+	struct bit_copy_queue queue;
+
+	srand(1);
+	for (size_t i = 0; i < sizeof(src); i++)
+		src[i] = rand();
+
+	for (unsigned int n = 0; n < 200000; n++) {
+		/* mostly short copies, some crossing the vector width */
+		unsigned int bit_count = (n & 7) ? rand() % 80 : rand() % 4200;
+		unsigned int src_offset = rand() % (8 * BUF_SIZE - bit_count + 1);
+		unsigned int dst_offset = rand() % (8 * BUF_SIZE - bit_count + 1);
+
+		memset(dst, n & 1 ? 0xff : 0x00, sizeof(dst));
+		memcpy(ref, dst, sizeof(ref));
+		bit_copy(dst, dst_offset, src, src_offset, bit_count);
+		ref_bit_copy(ref, dst_offset, src, src_offset, bit_count);
+		check(!memcmp(dst, ref, sizeof(dst)), "bit_copy", dst_offset, src_offset, bit_count);
+		if (failures > 10)
+			return;
+	}
+
+	/* queued, as in the ADIv5 mix */
+	bit_copy_queue_init(&queue);
+	memset(dst, 0, sizeof(dst));
+	memset(ref, 0, sizeof(ref));
+	for (unsigned int scan = 0; scan < 100; scan++) {
+		unsigned int src_offset = 40 * scan;
+		bit_copy_queued(&queue, dst, 35 * scan, src, src_offset, 3);
+		bit_copy_queued(&queue, dst, 35 * scan + 3, src, src_offset + 3, 32);
+		ref_bit_copy(ref, 35 * scan, src, src_offset, 35);
+	}
+	bit_copy_execute(&queue);
+	check(!memcmp(dst, ref, sizeof(dst)), "queued copies", 0, 0, 3500);
+	check(!queue.count, "queue emptied", 0, 0, 0);
+	bit_copy_queue_free(&queue);
+}
+
+struct scan_mix {
+	const char *name;
+	unsigned int num_fields;
+	unsigned int field_bits[3];
+};
+
+static const struct scan_mix mixes[] = {
+	{ "ADIv5 (3 + 32 bits)", 2, { 3, 32 } },
+	{ "RISC-V DMI (2 + 32 + 7 bits)", 3, { 2, 32, 7 } },
+	{ "4096 bit scans", 1, { 4096 } },
+};
+
+#define SCANS_PER_RUN 4096
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void time_mix(const struct scan_mix *mix, unsigned int runs)
+{
+	unsigned int scan_bits = 0;
+	for (unsigned int f = 0; f < mix->num_fields; f++)
+		scan_bits += mix->field_bits[f];
+	unsigned int scan_bytes = DIV_ROUND_UP(scan_bits, 8);
+
+	uint8_t *read_buffer = calloc(SCANS_PER_RUN, scan_bytes);
+	/* one in_value per field, as the callers allocate them */
+	uint8_t *fields = calloc(SCANS_PER_RUN * mix->num_fields, DIV_ROUND_UP(4096, 8));
+	if (!read_buffer || !fields) {
+		printf("out of memory\n");
+		exit(1);
+	}
+	for (size_t i = 0; i < (size_t)SCANS_PER_RUN * scan_bytes; i++)
+		read_buffer[i] = i * 13;
+
+	struct bit_copy_queue queue;
+	bit_copy_queue_init(&queue);
+
+	double t = now();
+	for (unsigned int run = 0; run < runs; run++) {
+		uint8_t *field = fields;
+		for (unsigned int scan = 0; scan < SCANS_PER_RUN; scan++) {
+			unsigned int src_offset = 8 * scan_bytes * scan;
+			for (unsigned int f = 0; f < mix->num_fields; f++) {
+				bit_copy_queued(&queue, field, 0, read_buffer, src_offset, mix->field_bits[f]);
+				src_offset += mix->field_bits[f];
+				field += DIV_ROUND_UP(mix->field_bits[f], 8);
+			}
+		}
+		bit_copy_execute(&queue);
+	}
+	double elapsed = now() - t;
+
+	printf("%-30s %8.1f ns per field\n", mix->name,
+		elapsed * 1e9 / ((double)runs * SCANS_PER_RUN * mix->num_fields));
+
+	bit_copy_queue_free(&queue);
+	free(fields);
+	free(read_buffer);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int runs = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+
+	golden_checks();
+	if (failures) {
+		printf("%d golden checks failed\n", failures);
+		return 1;
+	}
+	printf("golden checks passed\n");
+
+	for (size_t i = 0; i < ARRAY_SIZE(mixes); i++)
+		time_mix(&mixes[i], mixes[i].field_bits[0] > 64 ? runs / 20 + 1 : runs);
+
+	return 0;
+}
@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+  Golden checks and scan throughput of the bitbang driver core, on a fake
+  GPIO backend held in memory.
+
+  The backend models the GPIO output and input registers of a SoC and a
+  single TAP in BYPASS behind them: TDO reads back TDI delayed by one clock,
+  and a 0 at the start of each DR scan. The same scans are run through the
+  three ways bitbang can drive it:
+  - write() and read(), the generic path;
+  - write() with buffered sample() and read_sample();
+  - the optional shift() callback, as bcm2835gpio implements it.
+  Each must read back the expected TDO, clock the same number of edges and
+  leave the model and the driver in the same TAP state.
+
+  To compile, from a configured build directory:
+  gcc -Wall -O2 -DHAVE_CONFIG_H -I. -I<src>/src -I<src>/src/helper \
+	  -o bitbang_bench <src>/contrib/bench/bitbang_bench.c \
+	  <src>/src/jtag/drivers/bitbang.c <src>/src/jtag/interface.c \
+	  <src>/src/jtag/commands.c <src>/src/helper/binarybuffer.c
+
+  Usage:
+  ./bitbang_bench [total scan bits in Mbit, default 64]
+*/
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <helper/binarybuffer.h>
+#include <helper/log.h>
+#include <jtag/interface.h>
+#include <jtag/commands.h>
+#include <jtag/drivers/bitbang.h>
+#include <transport/transport.h>
+
+/* the few symbols the driver core needs from the rest of OpenOCD */
+int debug_level = LOG_LVL_WARNING;
+
+void log_printf_lf(enum log_levels level, const char *file, unsigned line,
+		const char *function, const char *format, ...)
+{
+	va_list ap;
+
+	if (level > debug_level)
+		return;
+	va_start(ap, format);
+	fprintf(stderr, "%s:%u %s(): ", file, line, function);
+	vfprintf(stderr, format, ap);
+	fputc('\n', stderr);
+	va_end(ap);
+}
+
+void jtag_sleep(uint32_t us)
+{
+}
+
+bool transport_is_jtag(void)
+{
+	return true;
+}
+
+/* fake GPIO registers */
+#define GPIO_TCK	(1u << 0)
+#define GPIO_TMS	(1u << 1)
+#define GPIO_TDI	(1u << 2)
+#define GPIO_TDO	(1u << 3)
+
+static volatile uint32_t gpio_out;
+static volatile uint32_t gpio_in;
+
+/* the TAP behind them */
+static tap_state_t tap_model_state = TAP_RESET;
+static uint64_t tap_model_edges;
+
+static inline void tap_model_clock(uint32_t out)
+{
+	bool tck_rise = (out & GPIO_TCK) && !(gpio_out & GPIO_TCK);
+
+	gpio_out = out;
+	if (!tck_rise)
+		return;
+
+	tap_model_edges++;
+	if (tap_model_state == TAP_DRCAPTURE)
+		gpio_in = 0;
+	else if (tap_model_state == TAP_DRSHIFT)
+		gpio_in = (out & GPIO_TDI) ? GPIO_TDO : 0;
+	tap_model_state = tap_state_transition(tap_model_state, out & GPIO_TMS);
+}
+
+static int fake_write(int tck, int tms, int tdi)
+{
+	tap_model_clock((tck ? GPIO_TCK : 0) | (tms ? GPIO_TMS : 0) | (tdi ? GPIO_TDI : 0));
+	return ERROR_OK;
+}
+
+static bb_value_t fake_read(void)
+{
+	return (gpio_in & GPIO_TDO) ? BB_HIGH : BB_LOW;
+}
+
+static uint8_t fake_samples[64];
+static unsigned int fake_sample_count, fake_sample_next;
+
+static int fake_sample(void)
+{
+	fake_samples[fake_sample_count++] = !!(gpio_in & GPIO_TDO);
+	return ERROR_OK;
+}
+
+static bb_value_t fake_read_sample(void)
+{
+	bb_value_t value = fake_samples[fake_sample_next++] ? BB_HIGH : BB_LOW;
+
+	if (fake_sample_next == fake_sample_count)
+		fake_sample_count = fake_sample_next = 0;
+	return value;
+}
+
+static int fake_shift(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits)
+{
+	for (unsigned int i = 0; i < num_bits; i++) {
+		uint8_t mask = 1 << (i % 8);
+		uint32_t out = 0;
+
+		if (tms && (tms[i / 8] & mask))
+			out |= GPIO_TMS;
+		if (tdi && (tdi[i / 8] & mask))
+			out |= GPIO_TDI;
+
+		tap_model_clock(out);
+		if (tdo) {
+			if (gpio_in & GPIO_TDO)
+				tdo[i / 8] |= mask;
+			else
+				tdo[i / 8] &= ~mask;
+		}
+		tap_model_clock(out | GPIO_TCK);
+	}
+
+	return ERROR_OK;
+}
+
+static struct bitbang_interface fake_generic = {
+	.read = fake_read,
+	.write = fake_write,
+};
+
+static struct bitbang_interface fake_buffered = {
+	.buf_size = sizeof(fake_samples),
+	.sample = fake_sample,
+	.read_sample = fake_read_sample,
+	.write = fake_write,
+};
+
+static struct bitbang_interface fake_shifting = {
+	.read = fake_read,
+	.write = fake_write,
+	.shift = fake_shift,
+};
+
+static const struct {
+	const char *name;
+	struct bitbang_interface *interface;
+} modes[] = {
+	{ "write/read", &fake_generic },
+	{ "write/sample", &fake_buffered },
+	{ "shift", &fake_shifting },
+};
+
+static int failures;
+
+static void check(bool ok, const char *what, const char *mode, unsigned int bits)
+{
+	if (!ok) {
+		printf("FAIL: %s, %s, %u bits\n", what, mode, bits);
+		failures++;
+	}
+}
+
+static void queue_dr_scan(const uint8_t *out, uint8_t *in, unsigned int num_bits,
+		tap_state_t end_state)
+{
+	struct jtag_command *cmd = cmd_queue_alloc(sizeof(*cmd));
+	struct scan_command *scan = cmd_queue_alloc(sizeof(*scan));
+	struct scan_field *field = cmd_queue_alloc(sizeof(*field));
+
+	*field = (struct scan_field){
+		.num_bits = num_bits,
+		.out_value = out,
+		.in_value = in,
+	};
+	*scan = (struct scan_command){
+		.ir_scan = false,
+		.num_fields = 1,
+		.fields = field,
+		.end_state = end_state,
+	};
+	cmd->type = JTAG_SCAN;
+	cmd->cmd.scan = scan;
+	jtag_queue_command(cmd);
+}
+
+static void queue_runtest(int num_cycles)
+{
+	struct jtag_command *cmd = cmd_queue_alloc(sizeof(*cmd));
+	struct runtest_command *runtest = cmd_queue_alloc(sizeof(*runtest));
+
+	runtest->num_cycles = num_cycles;
+	runtest->end_state = TAP_IDLE;
+	cmd->type = JTAG_RUNTEST;
+	cmd->cmd.runtest = runtest;
+	jtag_queue_command(cmd);
+}
+
+static int execute_queue(void)
+{
+	jtag_command_queue = cmd_queue_commands(NULL);
+	int retval = bitbang_execute_queue();
+	jtag_command_queue_reset();
+	return retval;
+}
+
+static void golden_checks(void)
+{
+	static const unsigned int lengths[] = { 1, 2, 7, 8, 9, 31, 32, 33, 63, 64, 65, 100, 1000 };
+	static const tap_state_t end_states[] = { TAP_IDLE, TAP_DRPAUSE, TAP_IDLE };
+	uint8_t out[128], in[128], expected[128];
+	uint64_t edges[ARRAY_SIZE(modes)];
+
+	srand(1);
+	for (size_t i = 0; i < sizeof(out); i++)
+		out[i] = rand();
+
+	for (size_t m = 0; m < ARRAY_SIZE(modes); m++) {
+		bitbang_interface = modes[m].interface;
+		tap_set_state(TAP_RESET);
+		tap_model_state = TAP_RESET;
+		tap_model_edges = 0;
+
+		for (size_t l = 0; l < ARRAY_SIZE(lengths); l++) {
+			unsigned int bits = lengths[l];
+			tap_state_t end_state = end_states[l % ARRAY_SIZE(end_states)];
+
+			/* the BYPASS register: a 0, then TDI one clock late */
+			memset(expected, 0, sizeof(expected));
+			buf_set_buf(out, 0, expected, 1, bits - 1);
+
+			memset(in, 0xaa, sizeof(in));
+			queue_dr_scan(out, in, bits, end_state);
+			queue_runtest(5);
+			check(execute_queue() == ERROR_OK, "execute", modes[m].name, bits);
+			check(!buf_cmp(in, expected, bits), "TDO", modes[m].name, bits);
+			check(tap_get_state() == TAP_IDLE && tap_model_state == TAP_IDLE,
+				"end state", modes[m].name, bits);
+		}
+		edges[m] = tap_model_edges;
+	}
+
+	for (size_t m = 1; m < ARRAY_SIZE(modes); m++)
+		check(edges[m] == edges[0], "edge count", modes[m].name, 0);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t total_bits = (argc > 1 ? strtoull(argv[1], NULL, 0) : 64) << 20;
+	/* a few scans per queue, as ADIv5 or a flash programmer makes them */
+	static const unsigned int scan_bits[] = { 35, 1024 };
+	static uint8_t out[128], in[128];
+
+	golden_checks();
+	if (failures) {
+		printf("%d golden checks failed\n", failures);
+		return 1;
+	}
+	printf("golden checks passed\n");
+
+	for (size_t i = 0; i < sizeof(out); i++)
+		out[i] = i * 37;
+
+	for (size_t s = 0; s < ARRAY_SIZE(scan_bits); s++) {
+		unsigned int bits = scan_bits[s];
+		uint64_t scans = total_bits / bits;
+
+		for (size_t m = 0; m < ARRAY_SIZE(modes); m++) {
+			bitbang_interface = modes[m].interface;
+
+			double t = now();
+			for (uint64_t n = 0; n < scans; n += 16) {
+				for (unsigned int i = 0; i < 16; i++)
+					queue_dr_scan(out, in, bits, TAP_IDLE);
+				if (execute_queue() != ERROR_OK)
+					return 1;
+			}
+			double elapsed = now() - t;
+
+			printf("%4u bit scans, %-12s %7.1f Mbit/s\n", bits, modes[m].name,
+				scans * bits / elapsed * 1e-6);
+		}
+	}
+
+	bitbang_quit();
+	return 0;
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+  Golden checks and throughput of hexify() and unhexify().
+
+  The checks cover the cases the vector kernels must leave to the scalar
+  code: invalid characters, odd length strings and a count larger than the
+  string, as gdb_server and the image loaders pass. Every input string is
+  copied to a heap buffer of its exact size, so building with
+  -fsanitize=address catches reads past the terminating null.
+
+  To compile, from a configured build directory:
+  gcc -Wall -O2 -DHAVE_CONFIG_H -I. -I<src>/src -I<src>/src/helper \
+	  -o hex_bench <src>/contrib/bench/hex_bench.c \
+	  <src>/src/helper/binarybuffer.c
+
+  Usage:
+  ./hex_bench [size in MiB, default 64]
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <helper/binarybuffer.h>
+
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+static uint8_t bin_value(char c)
+{
+	return c <= '9' ? c - '0' : c - 'a' + 10;
+}
+
+/* unhexify() a heap copy of exactly strlen(hex) + 1 bytes */
+static size_t unhexify_exact(uint8_t *bin, const char *hex, size_t count)
+{
+	char *copy = strdup(hex);
+	size_t n = unhexify(bin, copy, count);
+	free(copy);
+	return n;
+}
+
+static void golden_checks(void)
+{
+	uint8_t bin[260];
+	char hex[600];
+	char long_hex[257];
+
+	/* short string, count much larger than the string */
+	memset(bin, 0xaa, sizeof(bin));
+	check(unhexify_exact(bin, "0102030405", sizeof(bin)) == 5, "short string count");
+	check(!memcmp(bin, "\x01\x02\x03\x04\x05", 5), "short string data");
+	check(bin[5] == 0 && bin[sizeof(bin) - 1] == 0, "short string clears the rest");
+
+	/* odd length, the last high nibble is kept */
+	memset(bin, 0xaa, sizeof(bin));
+	check(unhexify_exact(bin, "abc", 2) == 1, "odd length count");
+	check(bin[0] == 0xab && bin[1] == 0xc0, "odd length data");
+
+	/* both cases */
+	check(unhexify_exact(bin, "DeadBEEF", 4) == 4, "mixed case count");
+	check(!memcmp(bin, "\xde\xad\xbe\xef", 4), "mixed case data");
+
+	/* long strings, one vector block or more, with a bad character */
+	for (unsigned int i = 0; i < 256; i++)
+		long_hex[i] = "0123456789abcdef"[(i * 7) & 15];
+	long_hex[256] = '\0';
+	check(unhexify_exact(bin, long_hex, 128) == 128, "long string count");
+	check(bin[0] == 0x07 && bin[1] == 0xe5 && bin[127] == 0x29, "long string data");
+	for (unsigned int pos = 0; pos < 256; pos += 13) {
+		char c = long_hex[pos];
+		long_hex[pos] = 'g';
+		memset(bin, 0xaa, sizeof(bin));
+		size_t n = unhexify_exact(bin, long_hex, 128);
+		check(n == pos / 2, "invalid character position");
+		/* a bad low nibble keeps the high one, a bad high nibble clears the byte */
+		uint8_t expected = (pos & 1) ? bin_value(long_hex[pos - 1]) << 4 : 0;
+		check(bin[n] == expected, "invalid character data");
+		check(bin[127] == 0, "invalid character clears the rest");
+		long_hex[pos] = c;
+	}
+
+	/* long string ending in an odd character, count past its end */
+	long_hex[255] = '\0';
+	check(unhexify_exact(bin, long_hex, 200) == 127, "long odd length count");
+	long_hex[255] = '9';
+
+	/* hexify, including truncated output */
+	for (unsigned int i = 0; i < 256; i++)
+		bin[i] = i;
+	check(hexify(hex, bin, 256, sizeof(hex)) == 512, "hexify length");
+	check(!strncmp(hex, "000102", 6) && !strcmp(hex + 506, "fdfeff"), "hexify data");
+	check(hexify(hex, bin, 256, 9) == 8 && !strcmp(hex, "00010203"), "hexify truncated");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = (argc > 1 ? strtoul(argv[1], NULL, 0) : 64) << 20;
+
+	golden_checks();
+	if (failures) {
+		printf("%d golden checks failed\n", failures);
+		return 1;
+	}
+	printf("golden checks passed\n");
+
+	uint8_t *bin = malloc(size);
+	char *hex = malloc(2 * size + 1);
+	if (!bin || !hex)
+		return 1;
+	/* fault the pages in outside of the timed runs */
+	memset(hex, 0, 2 * size + 1);
+	srand(1);
+	for (size_t i = 0; i < size; i++)
+		bin[i] = rand();
+
+	double t = now();
+	hexify(hex, bin, size, 2 * size + 1);
+	double t_hexify = now() - t;
+
+	t = now();
+	size_t n = unhexify(bin, hex, size);
+	double t_unhexify = now() - t;
+
+	printf("hexify:   %.2f GB/s\n", size / t_hexify * 1e-9);
+	printf("unhexify: %.2f GB/s (%zu bytes)\n", size / t_unhexify * 1e-9, n);
+
+	free(hex);
+	free(bin);
+	return n == size ? 0 : 1;
+}
@@ -0,0 +1,410 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+  Reference simulator for the jtag_sim driver.
+
+  It serves one OpenOCD connection with the protocol described in
+  doc/manual/jtag/drivers/jtag_sim.txt, over TCP or a unix socket, and
+  models a single TAP with a 4 bit IR, IDCODE (0xe), BYPASS (0xf) and a
+  64 bit scratch data register selected by all other instructions. It shows
+  what a simulator has to implement, and lets the driver be tested without
+  an HDL simulation.
+
+  To compile run:
+  gcc -Wall -O2 -o jtag_sim_server jtag_sim_server.c
+
+  Usage example, over TCP:
+  ./jtag_sim_server -t 5555 &
+  openocd -c "adapter driver jtag_sim; jtag_sim port 5555" ...
+
+  The same over a unix socket:
+  ./jtag_sim_server -u /tmp/jtag_sim.sock &
+  openocd -c "adapter driver jtag_sim; jtag_sim host /tmp/jtag_sim.sock" ...
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/* ------------------------------------------------------------------------
+ * Protocol. Keep in sync with src/jtag/drivers/jtag_sim.c.
+ */
+
+#define JTAG_SIM_MAGIC			0x4d49534a	/* "JSIM" */
+#define JTAG_SIM_HEADER_SIZE	8
+#define JTAG_SIM_RECORD_SIZE	8
+
+#define JTAG_SIM_OP_TMS			1
+#define JTAG_SIM_OP_SHIFT		2
+#define JTAG_SIM_OP_CLOCKS		3
+#define JTAG_SIM_OP_RESET		4
+#define JTAG_SIM_OP_STOP		5
+
+#define JTAG_SIM_SHIFT_TDI		0x1
+#define JTAG_SIM_SHIFT_TDO		0x2
+#define JTAG_SIM_SHIFT_EXIT		0x4
+
+#define JTAG_SIM_CLOCKS_TMS		0x1
+
+#define JTAG_SIM_RESET_TRST		0x1
+#define JTAG_SIM_RESET_SRST		0x2
+
+static int sim_fd = -1;
+
+static uint32_t le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = value >> (8 * i);
+}
+
+static bool sim_read(void *buf, size_t size)
+{
+	uint8_t *p = buf;
+
+	while (size) {
+		ssize_t n = read(sim_fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool sim_write(const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+
+	while (size) {
+		ssize_t n = write(sim_fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static int tcp_accept(int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int one = 1;
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(s, 1) < 0) {
+		perror("bind");
+		return -1;
+	}
+	sim_fd = accept(s, NULL, NULL);
+	close(s);
+	if (sim_fd < 0) {
+		perror("accept");
+		return -1;
+	}
+	/* each reply is written at once, and then waited for */
+	setsockopt(sim_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return 0;
+}
+
+static int unix_accept(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int s = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(s, 1) < 0) {
+		perror("bind");
+		return -1;
+	}
+	sim_fd = accept(s, NULL, NULL);
+	close(s);
+	unlink(path);
+	if (sim_fd < 0) {
+		perror("accept");
+		return -1;
+	}
+	return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * TAP model
+ */
+
+enum tap_state {
+	RESET, IDLE, DRSELECT, DRCAPTURE, DRSHIFT, DREXIT1, DRPAUSE, DREXIT2, DRUPDATE,
+	IRSELECT, IRCAPTURE, IRSHIFT, IREXIT1, IRPAUSE, IREXIT2, IRUPDATE,
+};
+
+static const enum tap_state tap_next[16][2] = {
+	[RESET] = { IDLE, RESET },
+	[IDLE] = { IDLE, DRSELECT },
+	[DRSELECT] = { DRCAPTURE, IRSELECT },
+	[DRCAPTURE] = { DRSHIFT, DREXIT1 },
+	[DRSHIFT] = { DRSHIFT, DREXIT1 },
+	[DREXIT1] = { DRPAUSE, DRUPDATE },
+	[DRPAUSE] = { DRPAUSE, DREXIT2 },
+	[DREXIT2] = { DRSHIFT, DRUPDATE },
+	[DRUPDATE] = { IDLE, DRSELECT },
+	[IRSELECT] = { IRCAPTURE, RESET },
+	[IRCAPTURE] = { IRSHIFT, IREXIT1 },
+	[IRSHIFT] = { IRSHIFT, IREXIT1 },
+	[IREXIT1] = { IRPAUSE, IRUPDATE },
+	[IRPAUSE] = { IRPAUSE, IREXIT2 },
+	[IREXIT2] = { IRSHIFT, IRUPDATE },
+	[IRUPDATE] = { IDLE, DRSELECT },
+};
+
+#define IR_LEN		4
+#define IR_IDCODE	0xe
+#define IR_BYPASS	0xf
+#define IDCODE		0x4ba00477
+
+static enum tap_state state = RESET;
+static uint32_t ir = IR_IDCODE;
+static uint32_t ir_shift;
+static uint64_t dr_shift;
+static uint64_t scratch;
+static bool trst;
+
+static unsigned int dr_len(void)
+{
+	if (ir == IR_IDCODE)
+		return 32;
+	if (ir == IR_BYPASS)
+		return 1;
+	return 64;
+}
+
+static void tap_reset(void)
+{
+	state = RESET;
+	ir = IR_IDCODE;
+}
+
+/* one TCK cycle, returns TDO as sampled before the rising edge */
+static int tap_clock(int tms, int tdi)
+{
+	int tdo = 0;
+
+	/* TRST holds the TAP in reset */
+	if (trst)
+		return 0;
+
+	switch (state) {
+	case DRCAPTURE:
+		dr_shift = ir == IR_IDCODE ? IDCODE : ir == IR_BYPASS ? 0 : scratch;
+		break;
+	case DRSHIFT:
+		tdo = dr_shift & 1;
+		dr_shift = (dr_shift >> 1) | ((uint64_t)tdi << (dr_len() - 1));
+		break;
+	case IRCAPTURE:
+		ir_shift = 0x1;
+		break;
+	case IRSHIFT:
+		tdo = ir_shift & 1;
+		ir_shift = (ir_shift >> 1) | ((uint32_t)tdi << (IR_LEN - 1));
+		break;
+	default:
+		break;
+	}
+
+	state = tap_next[state][tms];
+
+	if (state == DRUPDATE && ir != IR_IDCODE && ir != IR_BYPASS)
+		scratch = dr_shift;
+	else if (state == IRUPDATE)
+		ir = ir_shift;
+	else if (state == RESET)
+		ir = IR_IDCODE;
+
+	return tdo;
+}
+
+/* ------------------------------------------------------------------------
+ * Requests
+ */
+
+static uint8_t *req;
+static size_t req_size;
+static uint8_t *reply;
+static size_t reply_size;
+
+static uint8_t *reserve(uint8_t **buf, size_t *size, size_t needed)
+{
+	if (needed > *size) {
+		uint8_t *p = realloc(*buf, needed);
+		if (!p)
+			return NULL;
+		*buf = p;
+		*size = needed;
+	}
+	return *buf;
+}
+
+static int get_bit(const uint8_t *bits, uint32_t i)
+{
+	return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+/*
+ * Execute the records of a request and write the reply. Returns false on a
+ * malformed request, and sets *stop on a stop record.
+ */
+static bool execute_request(uint32_t len, bool *stop)
+{
+	size_t tdo_len = 0;
+	uint32_t pos = 0;
+
+	while (pos < len) {
+		if (len - pos < JTAG_SIM_RECORD_SIZE)
+			return false;
+
+		const uint8_t *record = req + pos;
+		uint8_t op = record[0];
+		uint8_t flags = record[1];
+		uint32_t count = le32(record + 4);
+		size_t bytes = ((size_t)count + 7) / 8;
+		pos += JTAG_SIM_RECORD_SIZE;
+
+		const uint8_t *payload = req + pos;
+		if (op == JTAG_SIM_OP_TMS || (op == JTAG_SIM_OP_SHIFT && (flags & JTAG_SIM_SHIFT_TDI))) {
+			if (len - pos < bytes)
+				return false;
+			pos += bytes;
+		}
+
+		switch (op) {
+		case JTAG_SIM_OP_TMS:
+			for (uint32_t i = 0; i < count; i++)
+				tap_clock(get_bit(payload, i), 0);
+			break;
+		case JTAG_SIM_OP_SHIFT: {
+			uint8_t *tdo = NULL;
+			if (flags & JTAG_SIM_SHIFT_TDO) {
+				if (!reserve(&reply, &reply_size, JTAG_SIM_HEADER_SIZE + tdo_len + bytes))
+					return false;
+				tdo = reply + JTAG_SIM_HEADER_SIZE + tdo_len;
+				memset(tdo, 0, bytes);
+				tdo_len += bytes;
+			}
+			for (uint32_t i = 0; i < count; i++) {
+				int tms = (flags & JTAG_SIM_SHIFT_EXIT) && i == count - 1;
+				int tdi = (flags & JTAG_SIM_SHIFT_TDI) ? get_bit(payload, i) : 0;
+				int bit = tap_clock(tms, tdi);
+				if (tdo)
+					tdo[i / 8] |= bit << (i % 8);
+			}
+			break;
+		}
+		case JTAG_SIM_OP_CLOCKS:
+			for (uint32_t i = 0; i < count; i++)
+				tap_clock(flags & JTAG_SIM_CLOCKS_TMS, 0);
+			break;
+		case JTAG_SIM_OP_RESET:
+			trst = flags & JTAG_SIM_RESET_TRST;
+			if (trst)
+				tap_reset();
+			/* the model has no system to reset, SRST is ignored */
+			break;
+		case JTAG_SIM_OP_STOP:
+			*stop = true;
+			return true;
+		default:
+			fprintf(stderr, "unknown operation %u\n", op);
+			return false;
+		}
+	}
+
+	if (!reserve(&reply, &reply_size, JTAG_SIM_HEADER_SIZE + tdo_len))
+		return false;
+	put_le32(reply, JTAG_SIM_MAGIC);
+	put_le32(reply + 4, tdo_len);
+	return sim_write(reply, JTAG_SIM_HEADER_SIZE + tdo_len);
+}
+
+static bool serve(void)
+{
+	uint8_t header[JTAG_SIM_HEADER_SIZE];
+	bool stop = false;
+
+	while (!stop) {
+		/* the driver closing the connection ends the session */
+		if (!sim_read(header, sizeof(header)))
+			return true;
+
+		if (le32(header) != JTAG_SIM_MAGIC) {
+			fprintf(stderr, "bad magic 0x%08x\n", le32(header));
+			return false;
+		}
+
+		uint32_t len = le32(header + 4);
+		if (!reserve(&req, &req_size, len) || !sim_read(req, len))
+			return false;
+
+		if (!execute_request(len, &stop))
+			return false;
+	}
+
+	return true;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s -t tcp_port | -u unix_socket_path\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	int port = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:u:")) != -1) {
+		switch (c) {
+		case 't':
+			port = atoi(optarg);
+			break;
+		case 'u':
+			path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!path == !port)
+		usage(argv[0]);
+
+	if (path ? unix_accept(path) : tcp_accept(port))
+		return 1;
+
+	bool ok = serve();
+	if (!ok)
+		fprintf(stderr, "protocol error, stopping\n");
+
+	close(sim_fd);
+	free(req);
+	free(reply);
+
+	return ok ? 0 : 1;
+}
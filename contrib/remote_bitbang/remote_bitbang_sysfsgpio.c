@@ -280,6 +280,67 @@ static void cleanup_all_fds(void)
 	cleanup_fd(srst_fd, srst_gpio);
 }
 
+/* Protocol v2 commands, see doc/manual/jtag/drivers/remote_bitbang.txt */
+#define SHIFT_TMS	0x1
+#define SHIFT_TDI	0x2
+#define SHIFT_TDO	0x4
+#define SHIFT_MAX_BYTES	8192
+
+/* 'X' flags count16: clock count bits from packed TMS and TDI vectors */
+static void process_shift(void)
+{
+	static unsigned char tms[SHIFT_MAX_BYTES], tdi[SHIFT_MAX_BYTES], tdo[SHIFT_MAX_BYTES];
+	int flags = getchar();
+	int lo = getchar();
+	int hi = getchar();
+
+	if (flags == EOF || lo == EOF || hi == EOF)
+		return;
+
+	unsigned int num_bits = lo | (hi << 8);
+	size_t num_bytes = (num_bits + 7) / 8;
+
+	memset(tms, 0, num_bytes);
+	memset(tdi, 0, num_bytes);
+	memset(tdo, 0, num_bytes);
+	if ((flags & SHIFT_TMS) && fread(tms, 1, num_bytes, stdin) != num_bytes)
+		return;
+	if ((flags & SHIFT_TDI) && fread(tdi, 1, num_bytes, stdin) != num_bytes)
+		return;
+
+	for (unsigned int i = 0; i < num_bits; i++) {
+		int tms_bit = (tms[i / 8] >> (i % 8)) & 1;
+		int tdi_bit = (tdi[i / 8] >> (i % 8)) & 1;
+
+		sysfsgpio_write(0, tms_bit, tdi_bit);
+		if ((flags & SHIFT_TDO) && sysfsgpio_read() == '1')
+			tdo[i / 8] |= 1 << (i % 8);
+		sysfsgpio_write(1, tms_bit, tdi_bit);
+	}
+
+	if (flags & SHIFT_TDO)
+		fwrite(tdo, 1, num_bytes, stdout);
+}
+
+/* 'Y' flags count32: clock count cycles with constant TMS and TDI */
+static void process_clocks(void)
+{
+	int flags = getchar();
+	unsigned long count = 0;
+
+	for (int i = 0; i < 4; i++) {
+		int c = getchar();
+		if (c == EOF)
+			return;
+		count |= (unsigned long)c << (8 * i);
+	}
+
+	for (unsigned long i = 0; i < count; i++) {
+		sysfsgpio_write(0, !!(flags & SHIFT_TMS), !!(flags & SHIFT_TDI));
+		sysfsgpio_write(1, !!(flags & SHIFT_TMS), !!(flags & SHIFT_TDI));
+	}
+}
+
 static void process_remote_protocol(void)
 {
 	int c;
@@ -300,6 +361,13 @@ static void process_remote_protocol(void)
 					(d & 1));
 		} else if (c == 'R')
 			putchar(sysfsgpio_read());
+		else if (c == 'V') { /* Version query */
+			putchar('V');
+			putchar('2');
+		} else if (c == 'X')
+			process_shift();
+		else if (c == 'Y')
+			process_clocks();
 		else
 			LOG_ERROR("Unknown command '%c' received", c);
 	}
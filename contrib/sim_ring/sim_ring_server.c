@@ -0,0 +1,638 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+  Stand-in simulator for the jtag_dpi and vdebug drivers.
+
+  It models a single TAP, with a 4 bit IR, IDCODE (0xe), BYPASS (0xf) and a
+  64 bit scratch data register selected by all other instructions, and
+  serves one OpenOCD connection, either over the shared memory ring
+  described in doc/manual/jtag/drivers/sim_ring.txt or over TCP. This lets
+  the drivers and their transports be tested without an HDL simulator.
+
+  To compile run:
+  gcc -Wall -O2 -o sim_ring_server sim_ring_server.c
+  (add -lrt for glibc older than 2.34)
+
+  Usage example, with the jtag_dpi driver over the ring:
+  ./sim_ring_server -p dpi -r /openocd_sim &
+  openocd -c "adapter driver jtag_dpi; jtag_dpi set_shm_ring /openocd_sim" ...
+
+  The same model over TCP, to compare with the ring:
+  ./sim_ring_server -p dpi -t 5555 &
+  openocd -c "adapter driver jtag_dpi; jtag_dpi set_port 5555" ...
+
+  With -p vdebug the vdebug protocol is served instead, for its JTAG
+  transport only:
+  ./sim_ring_server -p vdebug -r /openocd_sim &
+  openocd -c "adapter driver vdebug; vdebug shm_ring /openocd_sim; \
+	  vdebug bfm_path tb.tap 10ns" ...
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/futex.h>
+
+/* ------------------------------------------------------------------------
+ * Shared memory ring, simulator side. Keep in sync with sim_ring.h.
+ */
+
+#define SIM_RING_MAGIC			0x474e5253
+#define SIM_RING_VERSION		1
+#define SIM_RING_CLOSED_SIM		0x1
+#define SIM_RING_CLOSED_CLIENT	0x2
+#define SIM_RING_SPIN			2000
+
+struct sim_ring_ctl {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t consumer_waiting;
+	uint32_t producer_waiting;
+	uint32_t reserved[12];
+};
+
+struct sim_ring_shm {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t closed;
+	uint32_t sim_pid;
+	uint32_t reserved[11];
+	struct sim_ring_ctl to_sim;
+	struct sim_ring_ctl from_sim;
+};
+
+static struct sim_ring_shm *shm;
+static uint8_t *rx_data;
+static uint8_t *tx_data;
+static uint32_t ring_mask;
+static uint32_t tx_head;
+
+static int tcp_fd = -1;
+static uint8_t tcp_out[65536];
+static size_t tcp_out_len;
+
+static uint32_t load(uint32_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static void store(uint32_t *p, uint32_t value)
+{
+	__atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+static void futex_wake(uint32_t *word)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* returns false once OpenOCD closed the ring */
+static bool ring_wait(uint32_t *word, uint32_t *waiting, uint32_t old)
+{
+	for (int i = 0; i < SIM_RING_SPIN; i++)
+		if (load(word) != old)
+			return true;
+
+	store(waiting, 1);
+	while (load(word) == old) {
+		if (load(&shm->closed) & SIM_RING_CLOSED_CLIENT) {
+			store(waiting, 0);
+			return false;
+		}
+		syscall(SYS_futex, word, FUTEX_WAIT, old, NULL, NULL, 0);
+	}
+	store(waiting, 0);
+	return true;
+}
+
+static void ring_flush(void)
+{
+	if (load(&shm->from_sim.head) == tx_head)
+		return;
+	store(&shm->from_sim.head, tx_head);
+	if (load(&shm->from_sim.consumer_waiting))
+		futex_wake(&shm->from_sim.head);
+}
+
+static bool ring_write(const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+
+	while (size) {
+		uint32_t tail = load(&shm->from_sim.tail);
+		uint32_t space = ring_mask + 1 - (tx_head - tail);
+		if (!space) {
+			ring_flush();
+			if (!ring_wait(&shm->from_sim.tail, &shm->from_sim.producer_waiting, tail))
+				return false;
+			continue;
+		}
+		uint32_t offset = tx_head & ring_mask;
+		size_t n = size;
+		if (n > space)
+			n = space;
+		if (n > ring_mask + 1 - offset)
+			n = ring_mask + 1 - offset;
+		memcpy(tx_data + offset, p, n);
+		tx_head += n;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool ring_read(void *buf, size_t size)
+{
+	uint8_t *p = buf;
+
+	while (size) {
+		uint32_t tail = load(&shm->to_sim.tail);
+		uint32_t head = load(&shm->to_sim.head);
+		if (head == tail) {
+			/* out of requests: publish the answers before waiting */
+			ring_flush();
+			if (!ring_wait(&shm->to_sim.head, &shm->to_sim.consumer_waiting, head))
+				return false;
+			continue;
+		}
+		uint32_t offset = tail & ring_mask;
+		size_t n = size;
+		if (n > head - tail)
+			n = head - tail;
+		if (n > ring_mask + 1 - offset)
+			n = ring_mask + 1 - offset;
+		memcpy(p, rx_data + offset, n);
+		store(&shm->to_sim.tail, tail + n);
+		if (load(&shm->to_sim.producer_waiting))
+			futex_wake(&shm->to_sim.tail);
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static int ring_create(const char *name, uint32_t size)
+{
+	size_t map_size = sizeof(struct sim_ring_shm) + 2 * (size_t)size;
+
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0 || ftruncate(fd, map_size) < 0) {
+		perror("shm_open");
+		return -1;
+	}
+	shm = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+
+	shm->version = SIM_RING_VERSION;
+	shm->size = size;
+	shm->sim_pid = getpid();
+	rx_data = (uint8_t *)(shm + 1);
+	tx_data = rx_data + size;
+	ring_mask = size - 1;
+	store(&shm->magic, SIM_RING_MAGIC);
+	return 0;
+}
+
+static int tcp_accept(int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int one = 1;
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(s, 1) < 0) {
+		perror("bind");
+		return -1;
+	}
+	tcp_fd = accept(s, NULL, NULL);
+	close(s);
+	if (tcp_fd < 0) {
+		perror("accept");
+		return -1;
+	}
+	setsockopt(tcp_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	return 0;
+}
+
+static bool tcp_flush(void)
+{
+	size_t done = 0;
+
+	while (done < tcp_out_len) {
+		ssize_t n = write(tcp_fd, tcp_out + done, tcp_out_len - done);
+		if (n <= 0)
+			return false;
+		done += n;
+	}
+	tcp_out_len = 0;
+	return true;
+}
+
+static bool sim_write(const void *buf, size_t size)
+{
+	if (shm)
+		return ring_write(buf, size);
+
+	if (tcp_out_len + size > sizeof(tcp_out) && !tcp_flush())
+		return false;
+	if (size > sizeof(tcp_out))
+		return write(tcp_fd, buf, size) == (ssize_t)size;
+	memcpy(tcp_out + tcp_out_len, buf, size);
+	tcp_out_len += size;
+	return true;
+}
+
+static bool sim_read(void *buf, size_t size)
+{
+	if (shm)
+		return ring_read(buf, size);
+
+	if (!tcp_flush())
+		return false;
+	uint8_t *p = buf;
+	while (size) {
+		ssize_t n = read(tcp_fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------------------
+ * TAP model
+ */
+
+enum tap_state {
+	RESET, IDLE, DRSELECT, DRCAPTURE, DRSHIFT, DREXIT1, DRPAUSE, DREXIT2, DRUPDATE,
+	IRSELECT, IRCAPTURE, IRSHIFT, IREXIT1, IRPAUSE, IREXIT2, IRUPDATE,
+};
+
+static const enum tap_state tap_next[16][2] = {
+	[RESET] = { IDLE, RESET },
+	[IDLE] = { IDLE, DRSELECT },
+	[DRSELECT] = { DRCAPTURE, IRSELECT },
+	[DRCAPTURE] = { DRSHIFT, DREXIT1 },
+	[DRSHIFT] = { DRSHIFT, DREXIT1 },
+	[DREXIT1] = { DRPAUSE, DRUPDATE },
+	[DRPAUSE] = { DRPAUSE, DREXIT2 },
+	[DREXIT2] = { DRSHIFT, DRUPDATE },
+	[DRUPDATE] = { IDLE, DRSELECT },
+	[IRSELECT] = { IRCAPTURE, RESET },
+	[IRCAPTURE] = { IRSHIFT, IREXIT1 },
+	[IRSHIFT] = { IRSHIFT, IREXIT1 },
+	[IREXIT1] = { IRPAUSE, IRUPDATE },
+	[IRPAUSE] = { IRPAUSE, IREXIT2 },
+	[IREXIT2] = { IRSHIFT, IRUPDATE },
+	[IRUPDATE] = { IDLE, DRSELECT },
+};
+
+#define IR_LEN		4
+#define IR_IDCODE	0xe
+#define IR_BYPASS	0xf
+#define IDCODE		0x4ba00477
+
+static enum tap_state state = RESET;
+static uint32_t ir = IR_IDCODE;
+static uint32_t ir_shift;
+static uint64_t dr_shift;
+static uint64_t scratch;
+
+static unsigned int dr_len(void)
+{
+	if (ir == IR_IDCODE)
+		return 32;
+	if (ir == IR_BYPASS)
+		return 1;
+	return 64;
+}
+
+static void tap_reset(void)
+{
+	state = RESET;
+	ir = IR_IDCODE;
+}
+
+/* one TCK cycle, returns TDO as sampled before the rising edge */
+static int tap_clock(int tms, int tdi)
+{
+	int tdo = 0;
+
+	switch (state) {
+	case DRCAPTURE:
+		dr_shift = ir == IR_IDCODE ? IDCODE : ir == IR_BYPASS ? 0 : scratch;
+		break;
+	case DRSHIFT:
+		tdo = dr_shift & 1;
+		dr_shift = (dr_shift >> 1) | ((uint64_t)tdi << (dr_len() - 1));
+		break;
+	case IRCAPTURE:
+		ir_shift = 0x1;
+		break;
+	case IRSHIFT:
+		tdo = ir_shift & 1;
+		ir_shift = (ir_shift >> 1) | ((uint32_t)tdi << (IR_LEN - 1));
+		break;
+	default:
+		break;
+	}
+
+	state = tap_next[state][tms];
+
+	if (state == DRUPDATE && ir != IR_IDCODE && ir != IR_BYPASS)
+		scratch = dr_shift;
+	else if (state == IRUPDATE)
+		ir = ir_shift;
+	else if (state == RESET)
+		ir = IR_IDCODE;
+
+	return tdo;
+}
+
+/* ------------------------------------------------------------------------
+ * jtag_dpi protocol: text commands, scans always go back to Run-Test/Idle
+ */
+
+static bool serve_dpi(void)
+{
+	char line[32];
+	unsigned int len = 0;
+
+	while (true) {
+		if (!sim_read(&line[len], 1))
+			return true;
+		if (line[len] != '\n') {
+			if (++len == sizeof(line))
+				return false;
+			continue;
+		}
+		line[len] = '\0';
+		len = 0;
+
+		if (!strcmp(line, "reset")) {
+			tap_reset();
+			tap_clock(0, 0);
+			continue;
+		}
+
+		unsigned int num_bits;
+		if ((line[0] != 'i' && line[0] != 'd') || line[1] != 'b' ||
+				sscanf(line + 2, "%u", &num_bits) != 1 || !num_bits) {
+			fprintf(stderr, "unknown request '%s'\n", line);
+			return false;
+		}
+
+		size_t bytes = (num_bits + 7) / 8;
+		uint8_t *buf = malloc(bytes);
+		if (!buf || !sim_read(buf, bytes))
+			return false;
+
+		/* from Run-Test/Idle to Shift-IR or Shift-DR */
+		if (state == RESET)
+			tap_clock(0, 0);
+		tap_clock(1, 0);
+		if (line[0] == 'i')
+			tap_clock(1, 0);
+		tap_clock(0, 0);
+		tap_clock(0, 0);
+
+		for (unsigned int i = 0; i < num_bits; i++) {
+			int tdi = (buf[i / 8] >> (i % 8)) & 1;
+			int tdo = tap_clock(i == num_bits - 1, tdi);
+			buf[i / 8] = (buf[i / 8] & ~(1 << (i % 8))) | (tdo << (i % 8));
+		}
+		tap_clock(1, 0);
+		tap_clock(0, 0);
+
+		bool ok = sim_write(buf, bytes);
+		free(buf);
+		if (!ok)
+			return false;
+	}
+}
+
+/* ------------------------------------------------------------------------
+ * vdebug protocol, JTAG transactor only; see src/jtag/drivers/vdebug.c
+ */
+
+#define VD_VERSION			46
+#define VD_BUFFER_LEN		4024
+#define VD_CHEADER_LEN		24
+#define VD_SHEADER_LEN		16
+
+#define VD_CMD_OPEN			0x01
+#define VD_CMD_CLOSE		0x02
+#define VD_CMD_CONNECT		0x04
+#define VD_CMD_DISCONNECT	0x05
+#define VD_CMD_WAIT			0x09
+#define VD_CMD_SIGSET		0x0a
+#define VD_CMD_JTAGCLOCK	0x0f
+#define VD_CMD_JTAGSHTAP	0x1a
+
+#define VD_SIG_TRST			0x0010
+#define VD_ERR_NOT_IMPL		0x0100
+
+static uint16_t le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+	return le16(p) | (uint32_t)le16(p + 2) << 16;
+}
+
+static uint64_t le64(const uint8_t *p)
+{
+	return le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+static void put_le32(uint8_t *p, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = value >> (8 * i);
+}
+
+static uint32_t vd_shift_tap(const uint8_t *wd, unsigned int wbytes, unsigned int count,
+		uint8_t *rd, unsigned int rbytes)
+{
+	unsigned int waddr = 0;
+	unsigned int rwords = 0;
+
+	memset(rd, 0, rbytes);
+	for (unsigned int req = 0; req < count; req++) {
+		if (waddr + 8 > wbytes)
+			return VD_ERR_NOT_IMPL;
+		uint64_t jhdr = le64(wd + waddr);
+		unsigned int anum = jhdr & 0xffffff;
+		unsigned int read = ((jhdr >> 30) & 0x3) == 3;
+		unsigned int hwords = (jhdr >> 32) & 0xffff;
+		unsigned int words = jhdr >> 48;
+		const uint8_t *data = wd + waddr + 8;
+
+		/* TDI and TMS come as pairs of 32 bit words */
+		if (waddr + 8 + 8 * hwords > wbytes || (read && 8 * (rwords + words) > rbytes))
+			return VD_ERR_NOT_IMPL;
+		for (unsigned int i = 0; i < anum; i++) {
+			unsigned int byte = (i / 32) * 8 + (i / 8) % 4;
+			int tdi = (data[byte] >> (i % 8)) & 1;
+			int tms = (data[byte + 4] >> (i % 8)) & 1;
+			int tdo = tap_clock(tms, tdi);
+			if (read)
+				rd[8 * rwords + i / 8] |= tdo << (i % 8);
+		}
+
+		if (read)
+			rwords += words;
+		waddr += 8 + 8 * hwords;
+	}
+
+	return 0;
+}
+
+static bool serve_vdebug(void)
+{
+	static uint8_t req[VD_CHEADER_LEN + VD_BUFFER_LEN];
+	static uint8_t rsp[VD_SHEADER_LEN + VD_BUFFER_LEN];
+	uint64_t duttime = 0;
+
+	while (true) {
+		if (!sim_read(req, VD_CHEADER_LEN))
+			return true;
+
+		uint8_t cmd = req[0];
+		unsigned int wbytes = le16(req + 4);
+		unsigned int rbytes = le16(req + 6);
+		if (wbytes > VD_BUFFER_LEN || rbytes > VD_BUFFER_LEN ||
+				!sim_read(req + VD_CHEADER_LEN, wbytes))
+			return false;
+
+		const uint8_t *wd = req + VD_CHEADER_LEN;
+		uint8_t *rd = rsp + VD_SHEADER_LEN;
+		uint32_t status = 0;
+		uint32_t rwdata = le32(req + 12);
+
+		memset(rsp, 0, VD_SHEADER_LEN + rbytes);
+		switch (cmd) {
+		case VD_CMD_OPEN:
+			rsp[0] = VD_VERSION;
+			break;
+		case VD_CMD_CONNECT:
+			if (rbytes >= 12) {
+				put_le32(rd, 64);		/* transactor buffer width, in bits */
+				put_le32(rd + 8, 32);	/* address bits */
+			}
+			break;
+		case VD_CMD_SIGSET:
+			/* TRST is active low */
+			if ((rwdata >> 16) & VD_SIG_TRST && !(rwdata & VD_SIG_TRST))
+				tap_reset();
+			break;
+		case VD_CMD_WAIT:
+			duttime += rwdata;
+			break;
+		case VD_CMD_JTAGSHTAP:
+			status = vd_shift_tap(wd, wbytes, le16(req + 2), rd, rbytes);
+			break;
+		case VD_CMD_CLOSE:
+		case VD_CMD_DISCONNECT:
+		case VD_CMD_JTAGCLOCK:
+			break;
+		default:
+			status = VD_ERR_NOT_IMPL;
+			break;
+		}
+
+		/* rid echoes the request id, except for the version of OPEN */
+		if (cmd != VD_CMD_OPEN) {
+			rsp[0] = req[22];
+			rsp[1] = req[23];
+		}
+		put_le32(rsp + 4, status);
+		put_le32(rsp + 8, duttime);
+		put_le32(rsp + 12, duttime >> 32);
+		if (!sim_write(rsp, VD_SHEADER_LEN + rbytes))
+			return false;
+	}
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s -p dpi|vdebug (-r /shm_name [-s ring_size] | -t tcp_port)\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *protocol = NULL;
+	const char *ring_name = NULL;
+	uint32_t ring_size = 1 << 20;
+	int port = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "p:r:s:t:")) != -1) {
+		switch (c) {
+		case 'p':
+			protocol = optarg;
+			break;
+		case 'r':
+			ring_name = optarg;
+			break;
+		case 's':
+			ring_size = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			port = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!protocol || (strcmp(protocol, "dpi") && strcmp(protocol, "vdebug")) ||
+			!ring_name == !port || ring_size < 64 || (ring_size & (ring_size - 1)))
+		usage(argv[0]);
+
+	if (ring_name ? ring_create(ring_name, ring_size) : tcp_accept(port))
+		return 1;
+
+	bool ok = !strcmp(protocol, "dpi") ? serve_dpi() : serve_vdebug();
+	if (!ok)
+		fprintf(stderr, "protocol error, stopping\n");
+
+	if (shm) {
+		ring_flush();
+		__atomic_or_fetch(&shm->closed, SIM_RING_CLOSED_SIM, __ATOMIC_SEQ_CST);
+		futex_wake(&shm->from_sim.head);
+		futex_wake(&shm->to_sim.tail);
+		shm_unlink(ring_name);
+	} else {
+		tcp_flush();
+		close(tcp_fd);
+	}
+
+	return ok ? 0 : 1;
+}
@@ -32,6 +32,7 @@ int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 	int retval;
 
 	retval = bank->driver->erase(bank, first, last);
+	target_memory_changed();
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %u to %u", first, last);
 
@@ -88,6 +89,7 @@ int flash_driver_write(struct flash_bank *bank,
 	int retval;
 
 	retval = bank->driver->write(bank, buffer, offset, count);
+	target_memory_changed();
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error writing to flash at address " TARGET_ADDR_FMT
@@ -894,59 +896,84 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
-		/* allocate buffer */
-		buffer = malloc(run_size);
-		if (!buffer) {
-			LOG_ERROR("Out of memory for flash bank buffer");
-			retval = ERROR_FAIL;
-			goto done;
-		}
-
-		if (padding_at_start)
-			memset(buffer, c->default_padded_value, padding_at_start);
-
-		buffer_idx = padding_at_start;
-
-		/* read sections to the buffer */
-		while (buffer_idx < run_size) {
-			size_t size_read;
-
-			size_read = run_size - buffer_idx;
-			if (size_read > sections[section]->size - section_offset)
-				size_read = sections[section]->size - section_offset;
-
-			/* KLUDGE!
-			 *
-			 * #¤%#"%¤% we have to figure out the section # from the sorted
-			 * list of pointers to sections to invoke image_read_section()...
-			 */
+		/* a run covering part of a single section, without any padding, is
+		 * written straight from the image without an intermediate copy */
+		const uint8_t *run_data = NULL;
+		buffer = NULL;
+		if (!padding_at_start && !padding[section] &&
+				run_size <= sections[section]->size - section_offset) {
 			intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
 			int t_section_num = diff / sizeof(struct imagesection);
+			size_t size_read;
 
-			LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
-					"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
-				section, t_section_num, section_offset,
-				buffer_idx, size_read);
-			retval = image_read_section(image, t_section_num, section_offset,
-					size_read, buffer + buffer_idx, &size_read);
-			if (retval != ERROR_OK || size_read == 0) {
-				free(buffer);
+			if (image_borrow_section(image, t_section_num, section_offset,
+					run_size, &run_data, &size_read) != ERROR_OK)
+				run_data = NULL;
+		}
+
+		if (run_data) {
+			section_offset += run_size;
+			if (section_offset >= sections[section]->size) {
+				section++;
+				section_offset = 0;
+			}
+		} else {
+			/* allocate buffer */
+			buffer = malloc(run_size);
+			if (!buffer) {
+				LOG_ERROR("Out of memory for flash bank buffer");
+				retval = ERROR_FAIL;
 				goto done;
 			}
 
-			buffer_idx += size_read;
-			section_offset += size_read;
+			if (padding_at_start)
+				memset(buffer, c->default_padded_value, padding_at_start);
+
+			buffer_idx = padding_at_start;
+
+			/* read sections to the buffer */
+			while (buffer_idx < run_size) {
+				size_t size_read;
+
+				size_read = run_size - buffer_idx;
+				if (size_read > sections[section]->size - section_offset)
+					size_read = sections[section]->size - section_offset;
+
+				/* KLUDGE!
+				 *
+				 * #¤%#"%¤% we have to figure out the section # from the sorted
+				 * list of pointers to sections to invoke image_read_section()...
+				 */
+				intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
+				int t_section_num = diff / sizeof(struct imagesection);
+
+				LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
+						"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
+					section, t_section_num, section_offset,
+					buffer_idx, size_read);
+				retval = image_read_section(image, t_section_num, section_offset,
+						size_read, buffer + buffer_idx, &size_read);
+				if (retval != ERROR_OK || size_read == 0) {
+					free(buffer);
+					goto done;
+				}
 
-			/* see if we need to pad the section */
-			if (padding[section]) {
-				memset(buffer + buffer_idx, c->default_padded_value, padding[section]);
-				buffer_idx += padding[section];
-			}
+				buffer_idx += size_read;
+				section_offset += size_read;
 
-			if (section_offset >= sections[section]->size) {
-				section++;
-				section_offset = 0;
+				/* see if we need to pad the section */
+				if (padding[section]) {
+					memset(buffer + buffer_idx, c->default_padded_value, padding[section]);
+					buffer_idx += padding[section];
+				}
+
+				if (section_offset >= sections[section]->size) {
+					section++;
+					section_offset = 0;
+				}
 			}
+
+			run_data = buffer;
 		}
 
 		retval = ERROR_OK;
@@ -964,14 +991,14 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 		if (retval == ERROR_OK) {
 			if (write) {
 				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+				retval = flash_driver_write(c, run_data, run_address - c->base, run_size);
 			}
 		}
 
 		if (retval == ERROR_OK) {
 			if (verify) {
 				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+				retval = flash_driver_verify(c, run_data, run_address - c->base, run_size);
 			}
 		}
 
@@ -16,6 +16,11 @@
 #include "log.h"
 #include "binarybuffer.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BUF_HAVE_SIMD
+#include <immintrin.h>
+#endif
+
 static const unsigned char bit_reverse_table256[] = {
 	0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
 	0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8,
@@ -40,6 +45,14 @@ static const char hex_digits[] = {
 	'a', 'b', 'c', 'd', 'e', 'f'
 };
 
+/* value of each hexadecimal digit plus one, zero for any other character */
+static const uint8_t hex_digit_values[256] = {
+	['0'] = 0x01, ['1'] = 0x02, ['2'] = 0x03, ['3'] = 0x04, ['4'] = 0x05,
+	['5'] = 0x06, ['6'] = 0x07, ['7'] = 0x08, ['8'] = 0x09, ['9'] = 0x0a,
+	['a'] = 0x0b, ['b'] = 0x0c, ['c'] = 0x0d, ['d'] = 0x0e, ['e'] = 0x0f, ['f'] = 0x10,
+	['A'] = 0x0b, ['B'] = 0x0c, ['C'] = 0x0d, ['D'] = 0x0e, ['E'] = 0x0f, ['F'] = 0x10,
+};
+
 void *buf_cpy(const void *from, void *_to, unsigned size)
 {
 	if (!from || !_to)
@@ -74,7 +87,7 @@ bool buf_cmp(const void *_buf1, const void *_buf2, unsigned size)
 
 	unsigned last = size / 8;
 	if (memcmp(_buf1, _buf2, last) != 0)
-		return false;
+		return true;
 
 	unsigned trailing = size % 8;
 	if (!trailing)
@@ -92,7 +105,17 @@ bool buf_cmp_mask(const void *_buf1, const void *_buf2,
 
 	const uint8_t *buf1 = _buf1, *buf2 = _buf2, *mask = _mask;
 	unsigned last = size / 8;
-	for (unsigned i = 0; i < last; i++) {
+	unsigned i = 0;
+	/* a word at a time, JTAG verification compares whole scans */
+	for (; i + sizeof(uint64_t) <= last; i += sizeof(uint64_t)) {
+		uint64_t w1, w2, m;
+		memcpy(&w1, buf1 + i, sizeof(w1));
+		memcpy(&w2, buf2 + i, sizeof(w2));
+		memcpy(&m, mask + i, sizeof(m));
+		if ((w1 ^ w2) & m)
+			return true;
+	}
+	for (; i < last; i++) {
 		if (buf_cmp_masked(buf1[i], buf2[i], mask[i]))
 			return true;
 	}
@@ -118,48 +141,107 @@ void *buf_set_ones(void *_buf, unsigned size)
 	return buf;
 }
 
+/* Up to 64 bits of @a src, starting @a offset (0-7) bits into it. */
+static inline uint64_t buf_get_bits64(const uint8_t *src, unsigned int offset,
+	unsigned int len)
+{
+	unsigned int bytes = DIV_ROUND_UP(offset + len, 8);
+	uint64_t value = 0;
+
+	for (unsigned int i = 0; i < bytes && i < 8; i++)
+		value |= (uint64_t)src[i] << (8 * i);
+	value >>= offset;
+	/* a ninth byte only holds bits beyond the first 64 - offset */
+	if (bytes > 8)
+		value |= (uint64_t)src[8] << (64 - offset);
+
+	return value;
+}
+
+/* Store the @a len (up to 64) low bits of @a value, @a offset (0-7) bits into @a dst. */
+static inline void buf_put_bits64(uint8_t *dst, unsigned int offset,
+	unsigned int len, uint64_t value)
+{
+	unsigned int end = offset + len;
+
+	for (unsigned int i = 0; 8 * i < end; i++) {
+		unsigned int first = i ? 0 : offset;
+		unsigned int last = MIN(8, end - 8 * i);
+		uint8_t mask = ((1 << last) - 1) & ~((1 << first) - 1);
+		uint8_t bits = i ? value >> (8 * i - offset) : value << offset;
+		dst[i] = (dst[i] & ~mask) | (bits & mask);
+	}
+}
+
+#ifdef BUF_HAVE_SIMD
+/*
+ * Fill @a count bytes with the bits of @a src starting @a shift (1-7) bits
+ * into it, 16 bytes per iteration. Each 64 bit lane is a funnel shift of
+ * the source and of the source one byte further. Like the scalar loop, it
+ * reads up to one byte past the bytes written.
+ * Returns the number of bytes written, a multiple of 16.
+ */
+static size_t buf_shift_copy_sse2(uint8_t *dst, const uint8_t *src,
+	unsigned int shift, size_t count)
+{
+	const __m128i right = _mm_cvtsi32_si128(shift);
+	const __m128i left = _mm_cvtsi32_si128(8 - shift);
+	size_t i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(src + i + 1));
+		__m128i v = _mm_or_si128(_mm_srl_epi64(lo, right), _mm_sll_epi64(hi, left));
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	}
+
+	return i;
+}
+#endif
+
 void *buf_set_buf(const void *_src, unsigned src_start,
 	void *_dst, unsigned dst_start, unsigned len)
 {
-	const uint8_t *src = _src;
-	uint8_t *dst = _dst;
-	unsigned i, sb, db, sq, dq, lb, lq;
-
-	sb = src_start / 8;
-	db = dst_start / 8;
-	sq = src_start % 8;
-	dq = dst_start % 8;
-	lb = len / 8;
-	lq = len % 8;
-
-	src += sb;
-	dst += db;
-
-	/* check if both buffers are on byte boundary and
-	 * len is a multiple of 8bit so we can simple copy
-	 * the buffer */
-	if ((sq == 0) && (dq == 0) &&  (lq == 0)) {
-		for (i = 0; i < lb; i++)
-			*dst++ = *src++;
-		return _dst;
+	const uint8_t *src = (const uint8_t *)_src + src_start / 8;
+	uint8_t *dst = (uint8_t *)_dst + dst_start / 8;
+	unsigned int sq = src_start % 8;
+	unsigned int dq = dst_start % 8;
+
+	/* bring the destination to a byte boundary */
+	if (dq && len) {
+		unsigned int n = MIN(len, 8 - dq);
+		buf_put_bits64(dst, dq, n, buf_get_bits64(src, sq, n));
+		dst++;
+		src += (sq + n) / 8;
+		sq = (sq + n) % 8;
+		len -= n;
 	}
 
-	/* fallback to slow bit copy */
-	for (i = 0; i < len; i++) {
-		if (((*src >> (sq&7)) & 1) == 1)
-			*dst |= 1 << (dq&7);
-		else
-			*dst &= ~(1 << (dq&7));
-		if (sq++ == 7) {
-			sq = 0;
-			src++;
-		}
-		if (dq++ == 7) {
-			dq = 0;
-			dst++;
+	/*
+	 * Whole destination bytes. An unaligned source spans one more byte,
+	 * which holds source bits, so reading it stays within the source.
+	 */
+	size_t bytes = len / 8;
+	size_t i = 0;
+	if (!sq) {
+		memcpy(dst, src, bytes);
+		i = bytes;
+	} else {
+#ifdef BUF_HAVE_SIMD
+		i = buf_shift_copy_sse2(dst, src, sq, bytes);
+#endif
+		for (; i + 8 <= bytes; i += 8) {
+			uint64_t value = le_to_h_u64(src + i) >> sq |
+				(uint64_t)src[i + 8] << (64 - sq);
+			h_u64_to_le(dst + i, value);
 		}
 	}
 
+	/* less than 64 bits left */
+	unsigned int tail = len - 8 * i;
+	if (tail)
+		buf_put_bits64(dst + i, 0, tail, buf_get_bits64(src + i, sq, tail));
+
 	return _dst;
 }
 
@@ -298,47 +380,214 @@ int str_to_buf(const char *str, unsigned str_len,
 
 void bit_copy_queue_init(struct bit_copy_queue *q)
 {
-	INIT_LIST_HEAD(&q->list);
+	q->entries = NULL;
+	q->count = 0;
+	q->size = 0;
 }
 
 int bit_copy_queued(struct bit_copy_queue *q, uint8_t *dst, unsigned dst_offset, const uint8_t *src,
 	unsigned src_offset, unsigned bit_count)
 {
-	struct bit_copy_queue_entry *qe = malloc(sizeof(*qe));
-	if (!qe)
-		return ERROR_FAIL;
+	if (q->count == q->size) {
+		unsigned int size = q->size ? 2 * q->size : 64;
+		struct bit_copy_queue_entry *entries = realloc(q->entries, size * sizeof(*entries));
+		if (!entries)
+			return ERROR_FAIL;
+		q->entries = entries;
+		q->size = size;
+	}
 
-	qe->dst = dst;
-	qe->dst_offset = dst_offset;
-	qe->src = src;
-	qe->src_offset = src_offset;
-	qe->bit_count = bit_count;
-	list_add_tail(&qe->list, &q->list);
+	q->entries[q->count++] = (struct bit_copy_queue_entry){
+		.dst = dst,
+		.dst_offset = dst_offset,
+		.src = src,
+		.src_offset = src_offset,
+		.bit_count = bit_count,
+	};
 
 	return ERROR_OK;
 }
 
 void bit_copy_execute(struct bit_copy_queue *q)
 {
-	struct bit_copy_queue_entry *qe;
-	struct bit_copy_queue_entry *tmp;
-	list_for_each_entry_safe(qe, tmp, &q->list, list) {
+	for (unsigned int i = 0; i < q->count; i++) {
+		const struct bit_copy_queue_entry *qe = &q->entries[i];
 		bit_copy(qe->dst, qe->dst_offset, qe->src, qe->src_offset, qe->bit_count);
-		list_del(&qe->list);
-		free(qe);
 	}
+	q->count = 0;
 }
 
 void bit_copy_discard(struct bit_copy_queue *q)
 {
-	struct bit_copy_queue_entry *qe;
-	struct bit_copy_queue_entry *tmp;
-	list_for_each_entry_safe(qe, tmp, &q->list, list) {
-		list_del(&qe->list);
-		free(qe);
+	q->count = 0;
+}
+
+void bit_copy_queue_free(struct bit_copy_queue *q)
+{
+	free(q->entries);
+	bit_copy_queue_init(q);
+}
+
+#ifdef BUF_HAVE_SIMD
+/*
+ * Vector kernels converting 16 (SSE2) or 32 (AVX2) bytes per iteration.
+ * SSE2 is part of the x86-64 baseline, AVX2 is selected at runtime.
+ * They return the number of bytes converted, leaving the rest of the data,
+ * or a block containing a character that is not a hexadecimal digit, to
+ * the scalar code.
+ */
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/* nibbles to lower case hexadecimal digits */
+static inline __m128i hex_digits_sse2(__m128i n)
+{
+	__m128i letter = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+	n = _mm_add_epi8(n, _mm_set1_epi8('0'));
+	return _mm_add_epi8(n, _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+static size_t hexify_sse2(char *hex, const uint8_t *bin, size_t count)
+{
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	size_t i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(bin + i));
+		__m128i hi = hex_digits_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		__m128i lo = hex_digits_sse2(_mm_and_si128(v, mask));
+		_mm_storeu_si128((__m128i *)(hex + 2 * i), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(hex + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
 	}
+
+	return i;
 }
 
+AVX2_TARGET
+static inline __m256i hex_digits_avx2(__m256i n)
+{
+	__m256i letter = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+	n = _mm256_add_epi8(n, _mm256_set1_epi8('0'));
+	return _mm256_add_epi8(n, _mm256_and_si256(letter, _mm256_set1_epi8('a' - '0' - 10)));
+}
+
+AVX2_TARGET
+static size_t hexify_avx2(char *hex, const uint8_t *bin, size_t count)
+{
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	size_t i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(bin + i));
+		__m256i hi = hex_digits_avx2(_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+		__m256i lo = hex_digits_avx2(_mm256_and_si256(v, mask));
+		/* unpack works within 128 bit lanes, put the halves back in order */
+		__m256i a = _mm256_unpacklo_epi8(hi, lo);
+		__m256i b = _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256((__m256i *)(hex + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i *)(hex + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+
+	return i;
+}
+
+/*
+ * Value of each hexadecimal digit in 16 bit lanes, high nibble in the low
+ * byte. Clears *valid if any character is not a hexadecimal digit.
+ */
+static inline __m128i hex_values_sse2(__m128i c, bool *valid)
+{
+	__m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+	__m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	__m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+
+	if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff)
+		*valid = false;
+
+	__m128i v = _mm_or_si128(_mm_and_si128(is_digit, d),
+		_mm_and_si128(is_letter, _mm_add_epi8(l, _mm_set1_epi8(10))));
+	/* one byte per 16 bit lane */
+	return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00ff)), 4),
+		_mm_srli_epi16(v, 8));
+}
+
+static size_t unhexify_sse2(uint8_t *bin, const char *hex, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		const char *p = hex + 2 * i;
+		bool valid = true;
+		__m128i a = hex_values_sse2(_mm_loadu_si128((const __m128i *)p), &valid);
+		__m128i b = hex_values_sse2(_mm_loadu_si128((const __m128i *)(p + 16)), &valid);
+		if (!valid)
+			break;
+		_mm_storeu_si128((__m128i *)(bin + i), _mm_packus_epi16(a, b));
+	}
+
+	return i;
+}
+
+AVX2_TARGET
+static inline __m256i hex_values_avx2(__m256i c, bool *valid)
+{
+	__m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+	__m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	__m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+	__m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+
+	if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_letter)) != -1)
+		*valid = false;
+
+	__m256i v = _mm256_or_si256(_mm256_and_si256(is_digit, d),
+		_mm256_and_si256(is_letter, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+	return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x00ff)), 4),
+		_mm256_srli_epi16(v, 8));
+}
+
+AVX2_TARGET
+static size_t unhexify_avx2(uint8_t *bin, const char *hex, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		const char *p = hex + 2 * i;
+		bool valid = true;
+		__m256i a = hex_values_avx2(_mm256_loadu_si256((const __m256i *)p), &valid);
+		__m256i b = hex_values_avx2(_mm256_loadu_si256((const __m256i *)(p + 32)), &valid);
+		if (!valid)
+			break;
+		/* packing works within 128 bit lanes, put the quarters back in order */
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+		_mm256_storeu_si256((__m256i *)(bin + i), v);
+	}
+
+	/* remaining block of 16 bytes, or an invalid block to locate */
+	return i + unhexify_sse2(bin + i, hex + 2 * i, count - i);
+}
+
+typedef size_t (*hexify_kernel_t)(char *hex, const uint8_t *bin, size_t count);
+typedef size_t (*unhexify_kernel_t)(uint8_t *bin, const char *hex, size_t count);
+
+static hexify_kernel_t hexify_kernel;
+static unhexify_kernel_t unhexify_kernel;
+
+static void hex_kernels_init(void)
+{
+	if (hexify_kernel)
+		return;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		unhexify_kernel = unhexify_avx2;
+		hexify_kernel = hexify_avx2;
+	} else {
+		unhexify_kernel = unhexify_sse2;
+		hexify_kernel = hexify_sse2;
+	}
+}
+#endif /* BUF_HAVE_SIMD */
+
 /**
  * Convert a string of hexadecimal pairs into its binary
  * representation.
@@ -353,28 +602,34 @@ void bit_copy_discard(struct bit_copy_queue *q)
  */
 size_t unhexify(uint8_t *bin, const char *hex, size_t count)
 {
-	size_t i;
-	char tmp;
+	size_t i = 0;
 
 	if (!bin || !hex)
 		return 0;
 
-	memset(bin, 0, count);
+#ifdef BUF_HAVE_SIMD
+	/* the kernels load whole blocks, keep them inside the string */
+	hex_kernels_init();
+	i = unhexify_kernel(bin, hex, strnlen(hex, 2 * count) / 2);
+#endif
 
-	for (i = 0; i < 2 * count; i++) {
-		if (hex[i] >= 'a' && hex[i] <= 'f')
-			tmp = hex[i] - 'a' + 10;
-		else if (hex[i] >= 'A' && hex[i] <= 'F')
-			tmp = hex[i] - 'A' + 10;
-		else if (hex[i] >= '0' && hex[i] <= '9')
-			tmp = hex[i] - '0';
-		else
-			return i / 2;
+	for (; i < count; i++) {
+		uint8_t hi = hex_digit_values[(uint8_t)hex[2 * i]];
+		if (!hi) {
+			memset(bin + i, 0, count - i);
+			return i;
+		}
+		bin[i] = (hi - 1) << 4;
 
-		bin[i / 2] |= tmp << (4 * ((i + 1) % 2));
+		uint8_t lo = hex_digit_values[(uint8_t)hex[2 * i + 1]];
+		if (!lo) {
+			memset(bin + i + 1, 0, count - i - 1);
+			return i;
+		}
+		bin[i] |= lo - 1;
 	}
 
-	return i / 2;
+	return count;
 }
 
 /**
@@ -391,13 +646,19 @@ size_t unhexify(uint8_t *bin, const char *hex, size_t count)
  */
 size_t hexify(char *hex, const uint8_t *bin, size_t count, size_t length)
 {
-	size_t i;
+	size_t i = 0;
 	uint8_t tmp;
 
 	if (!length)
 		return 0;
 
-	for (i = 0; i < length - 1 && i < 2 * count; i++) {
+#ifdef BUF_HAVE_SIMD
+	hex_kernels_init();
+	/* whole bytes that fit before the null-terminator */
+	i = 2 * hexify_kernel(hex, bin, MIN(count, (length - 1) / 2));
+#endif
+
+	for (; i < length - 1 && i < 2 * count; i++) {
 		tmp = (bin[i / 2] >> (4 * ((i + 1) % 2))) & 0x0f;
 		hex[i] = hex_digits[tmp];
 	}
@@ -204,24 +204,35 @@ static inline void bit_copy(uint8_t *dst, unsigned dst_offset, const uint8_t *sr
 	buf_set_buf(src, src_offset, dst, dst_offset, bit_count);
 }
 
-struct bit_copy_queue {
-	struct list_head list;
-};
-
+/*
+ * Bit copies deferred until the source is filled in, e.g. by the USB
+ * transfer of an adapter. The entries are kept in an array which is reused
+ * once executed or discarded, so queueing does not allocate memory after
+ * the first queues.
+ */
 struct bit_copy_queue_entry {
 	uint8_t *dst;
 	unsigned dst_offset;
 	const uint8_t *src;
 	unsigned src_offset;
 	unsigned bit_count;
-	struct list_head list;
+};
+
+struct bit_copy_queue {
+	struct bit_copy_queue_entry *entries;
+	unsigned int count;
+	unsigned int size;
 };
 
 void bit_copy_queue_init(struct bit_copy_queue *q);
 int bit_copy_queued(struct bit_copy_queue *q, uint8_t *dst, unsigned dst_offset, const uint8_t *src,
 		    unsigned src_offset, unsigned bit_count);
+/** Run the queued copies in order and empty the queue. */
 void bit_copy_execute(struct bit_copy_queue *q);
+/** Empty the queue without copying. */
 void bit_copy_discard(struct bit_copy_queue *q);
+/** Empty the queue and release its memory. */
+void bit_copy_queue_free(struct bit_copy_queue *q);
 
 /* functions to convert to/from hex encoded buffer
  * used in ti-icdi driver and gdb server */
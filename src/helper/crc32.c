@@ -13,9 +13,28 @@
 #endif
 
 #include "crc32.h"
+#include "types.h"
 #include <stdint.h>
 #include <stddef.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRC32_HAVE_PCLMUL
+#include <immintrin.h>
+#endif
+
+/*
+ * Slice-by-8 lookup tables for the two polynomials in use: table[0] is the
+ * classic byte table, table[k] advances the CRC over k more zero bytes.
+ */
+static uint32_t crc32_le_table[8][256];
+static uint32_t crc32_be_table[8][256];
+static bool crc32_tables_ready;
+
+typedef uint32_t (*crc32_kernel_t)(uint32_t crc, const uint8_t *data, size_t len);
+
+static crc32_kernel_t crc32_le_kernel;
+static crc32_kernel_t crc32_be_kernel;
+
 static uint32_t crc_le_step(uint32_t poly, uint32_t crc, uint32_t data_in,
 		unsigned int data_bits)
 {
@@ -30,21 +49,245 @@ static uint32_t crc_le_step(uint32_t poly, uint32_t crc, uint32_t data_in,
 	return crc;
 }
 
+static uint32_t crc_be_step(uint32_t poly, uint32_t crc, uint8_t data_in)
+{
+	crc ^= (uint32_t)data_in << 24;
+	for (unsigned int i = 0; i < 8; i++)
+		crc = (crc & 0x80000000) ? (crc << 1) ^ poly : (crc << 1);
+
+	return crc;
+}
+
+static uint32_t crc32_le_slice8(uint32_t crc, const uint8_t *data, size_t len)
+{
+	const uint32_t (*t)[256] = crc32_le_table;
+
+	while (len && ((uintptr_t)data & 0x7)) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+		len--;
+	}
+
+	while (len >= 8) {
+		uint32_t lo = crc ^ le_to_h_u32(data);
+		uint32_t hi = le_to_h_u32(data + 4);
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+			t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+			t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+			t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+		data += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+	return crc;
+}
+
+static uint32_t crc32_be_slice8(uint32_t crc, const uint8_t *data, size_t len)
+{
+	const uint32_t (*t)[256] = crc32_be_table;
+
+	while (len && ((uintptr_t)data & 0x7)) {
+		crc = (crc << 8) ^ t[0][((crc >> 24) ^ *data++) & 0xff];
+		len--;
+	}
+
+	while (len >= 8) {
+		uint32_t hi = crc ^ be_to_h_u32(data);
+		uint32_t lo = be_to_h_u32(data + 4);
+		crc = t[7][hi >> 24] ^ t[6][(hi >> 16) & 0xff] ^
+			t[5][(hi >> 8) & 0xff] ^ t[4][hi & 0xff] ^
+			t[3][lo >> 24] ^ t[2][(lo >> 16) & 0xff] ^
+			t[1][(lo >> 8) & 0xff] ^ t[0][lo & 0xff];
+		data += 8;
+		len -= 8;
+	}
+
+	while (len--)
+		crc = (crc << 8) ^ t[0][((crc >> 24) ^ *data++) & 0xff];
+
+	return crc;
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/*
+ * Carry-less multiplication folding, see Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction". The message is folded
+ * 64 bytes at a time into four 128 bit lanes, then into a single lane.
+ * The remaining 128 bit residue is congruent to the folded prefix, so the
+ * final reduction and the tail are left to the slice-by-8 code.
+ *
+ * Constants are x^n mod P; for the bit reflected variant they are stored
+ * bit reversed and shifted left by one, as the reflected product of two
+ * operands comes out one bit short.
+ */
+#define CRC32_PCLMUL_MIN_LEN	128
+
+#define PCLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+/* multiply each half of the lane by the matching half of the constant */
+PCLMUL_TARGET
+static inline __m128i crc32_fold(__m128i x, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+		_mm_clmulepi64_si128(x, k, 0x11));
+}
+
+PCLMUL_TARGET
+static uint32_t crc32_le_pclmul(uint32_t crc, const uint8_t *data, size_t len)
+{
+	if (len < CRC32_PCLMUL_MIN_LEN)
+		return crc32_le_slice8(crc, data, len);
+
+	/* { x^(512+32), x^(512-32) } and { x^(128+32), x^(128-32) } */
+	const __m128i k512 = _mm_set_epi64x(0x1c6e41596, 0x154442bd4);
+	const __m128i k128 = _mm_set_epi64x(0x0ccaa009e, 0x1751997d0);
+	const __m128i *p = (const __m128i *)data;
+
+	__m128i x0 = _mm_xor_si128(_mm_loadu_si128(p + 0), _mm_cvtsi32_si128(crc));
+	__m128i x1 = _mm_loadu_si128(p + 1);
+	__m128i x2 = _mm_loadu_si128(p + 2);
+	__m128i x3 = _mm_loadu_si128(p + 3);
+	p += 4;
+	len -= 64;
+
+	while (len >= 64) {
+		x0 = _mm_xor_si128(crc32_fold(x0, k512), _mm_loadu_si128(p + 0));
+		x1 = _mm_xor_si128(crc32_fold(x1, k512), _mm_loadu_si128(p + 1));
+		x2 = _mm_xor_si128(crc32_fold(x2, k512), _mm_loadu_si128(p + 2));
+		x3 = _mm_xor_si128(crc32_fold(x3, k512), _mm_loadu_si128(p + 3));
+		p += 4;
+		len -= 64;
+	}
+
+	x1 = _mm_xor_si128(crc32_fold(x0, k128), x1);
+	x2 = _mm_xor_si128(crc32_fold(x1, k128), x2);
+	x0 = _mm_xor_si128(crc32_fold(x2, k128), x3);
+
+	while (len >= 16) {
+		x0 = _mm_xor_si128(crc32_fold(x0, k128), _mm_loadu_si128(p));
+		p++;
+		len -= 16;
+	}
+
+	uint8_t residue[16];
+	_mm_storeu_si128((__m128i *)residue, x0);
+	crc = crc32_le_slice8(0, residue, sizeof(residue));
+
+	return crc32_le_slice8(crc, (const uint8_t *)p, len);
+}
+
+PCLMUL_TARGET
+static uint32_t crc32_be_pclmul(uint32_t crc, const uint8_t *data, size_t len)
+{
+	if (len < CRC32_PCLMUL_MIN_LEN)
+		return crc32_be_slice8(crc, data, len);
+
+	/* { x^512, x^(512+64) } and { x^128, x^(128+64) } */
+	const __m128i k512 = _mm_set_epi64x(0x8833794c, 0xe6228b11);
+	const __m128i k128 = _mm_set_epi64x(0xc5b9cd4c, 0xe8a45605);
+	/* the first message byte holds the highest order coefficients */
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+		8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i *p = (const __m128i *)data;
+
+#define LOAD_BE(q) _mm_shuffle_epi8(_mm_loadu_si128(q), bswap)
+	__m128i x0 = _mm_xor_si128(LOAD_BE(p + 0), _mm_set_epi32(crc, 0, 0, 0));
+	__m128i x1 = LOAD_BE(p + 1);
+	__m128i x2 = LOAD_BE(p + 2);
+	__m128i x3 = LOAD_BE(p + 3);
+	p += 4;
+	len -= 64;
+
+	while (len >= 64) {
+		x0 = _mm_xor_si128(crc32_fold(x0, k512), LOAD_BE(p + 0));
+		x1 = _mm_xor_si128(crc32_fold(x1, k512), LOAD_BE(p + 1));
+		x2 = _mm_xor_si128(crc32_fold(x2, k512), LOAD_BE(p + 2));
+		x3 = _mm_xor_si128(crc32_fold(x3, k512), LOAD_BE(p + 3));
+		p += 4;
+		len -= 64;
+	}
+
+	x1 = _mm_xor_si128(crc32_fold(x0, k128), x1);
+	x2 = _mm_xor_si128(crc32_fold(x1, k128), x2);
+	x0 = _mm_xor_si128(crc32_fold(x2, k128), x3);
+
+	while (len >= 16) {
+		x0 = _mm_xor_si128(crc32_fold(x0, k128), LOAD_BE(p));
+		p++;
+		len -= 16;
+	}
+#undef LOAD_BE
+
+	uint8_t residue[16];
+	_mm_storeu_si128((__m128i *)residue, _mm_shuffle_epi8(x0, bswap));
+	crc = crc32_be_slice8(0, residue, sizeof(residue));
+
+	return crc32_be_slice8(crc, (const uint8_t *)p, len);
+}
+#endif /* CRC32_HAVE_PCLMUL */
+
+void crc32_init(void)
+{
+	if (crc32_tables_ready)
+		return;
+
+	for (unsigned int i = 0; i < 256; i++) {
+		crc32_le_table[0][i] = crc_le_step(CRC32_POLY_LE, 0, i, 8);
+		crc32_be_table[0][i] = crc_be_step(CRC32_POLY_BE, 0, i);
+	}
+
+	for (unsigned int i = 0; i < 256; i++) {
+		for (unsigned int k = 1; k < 8; k++) {
+			uint32_t le = crc32_le_table[k - 1][i];
+			uint32_t be = crc32_be_table[k - 1][i];
+			crc32_le_table[k][i] = (le >> 8) ^ crc32_le_table[0][le & 0xff];
+			crc32_be_table[k][i] = (be << 8) ^ crc32_be_table[0][be >> 24];
+		}
+	}
+
+	crc32_le_kernel = crc32_le_slice8;
+	crc32_be_kernel = crc32_be_slice8;
+
+#ifdef CRC32_HAVE_PCLMUL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) {
+		crc32_le_kernel = crc32_le_pclmul;
+		crc32_be_kernel = crc32_be_pclmul;
+	}
+#endif
+
+	crc32_tables_ready = true;
+}
+
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *_data,
 		size_t data_len)
 {
-	if (((uintptr_t)_data & 0x3) || (data_len & 0x3)) {
-		/* data is unaligned, processing data one byte at a time */
-		const uint8_t *data = _data;
+	const uint8_t *data = _data;
+
+	if (poly != CRC32_POLY_LE) {
+		/* uncommon polynomial, processing data one byte at a time */
 		for (size_t i = 0; i < data_len; i++)
 			seed = crc_le_step(poly, seed, data[i], 8);
-	} else {
-		/* data is aligned, processing 32 bit at a time */
-		data_len >>= 2;
-		const uint32_t *data = _data;
+		return seed;
+	}
+
+	crc32_init();
+	return crc32_le_kernel(seed, data, data_len);
+}
+
+uint32_t crc32_be(uint32_t poly, uint32_t seed, const void *_data,
+		size_t data_len)
+{
+	const uint8_t *data = _data;
+
+	if (poly != CRC32_POLY_BE) {
 		for (size_t i = 0; i < data_len; i++)
-			seed = crc_le_step(poly, seed, data[i], 32);
+			seed = crc_be_step(poly, seed, data[i]);
+		return seed;
 	}
 
-	return seed;
+	crc32_init();
+	return crc32_be_kernel(seed, data, data_len);
 }
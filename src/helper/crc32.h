@@ -13,6 +13,10 @@
 
 /** @file
  * A generic CRC32 implementation
+ *
+ * The commonly used polynomials below are handled with slice-by-8 tables,
+ * or with carry-less multiplication when the host CPU supports it. Any
+ * other polynomial is processed one bit at a time.
  */
 
 /**
@@ -20,6 +24,18 @@
  */
 #define CRC32_POLY_LE	0xedb88320
 
+/**
+ * CRC32 polynomial used MSB first, e.g. by GDB's qCRC and verify_image
+ */
+#define CRC32_POLY_BE	0x04c11db7
+
+/**
+ * Build the lookup tables and select the fastest implementation for the
+ * host. Called implicitly, but must be called once before computing CRCs
+ * from more than one thread.
+ */
+void crc32_init(void);
+
 /**
  * Calculate the CRC32 value of the given data
  * @param	poly		The polynomial of the CRC
@@ -34,4 +50,16 @@
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *data,
 		size_t data_len);
 
+/**
+ * Calculate the MSB first (non reflected) CRC32 value of the given data
+ * @param	poly		The polynomial of the CRC, MSB first
+ * @param	seed		The seed to use (mostly either `0` or `0xffffffff`)
+ * @param	data		The data to calculate the CRC32 of
+ * @param	data_len	The length of the data in @p data in bytes
+ * @return	The CRC value of the first @p data_len bytes at @p data
+ * @note	As crc32_le(), it can be used to compute the CRC incrementally.
+ */
+uint32_t crc32_be(uint32_t poly, uint32_t seed, const void *data,
+		size_t data_len);
+
 #endif /* OPENOCD_HELPER_CRC32_H */
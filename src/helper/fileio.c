@@ -20,16 +20,28 @@
 #include "fileio.h"
 #include "replacements.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	/* read-only mapping of the whole file, see fileio_mmap() */
+	void *map;
 };
 
 static inline int fileio_close_local(struct fileio *fileio)
 {
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+#endif
+	fileio->map = NULL;
+
 	int retval = fclose(fileio->file);
 	if (retval != 0) {
 		if (retval == EBADF)
@@ -117,6 +129,7 @@ int fileio_open(struct fileio **fileio, const char *url,
 	tmp->type = type;
 	tmp->access = access_type;
 	tmp->url = strdup(url);
+	tmp->map = NULL;
 
 	retval = fileio_open_local(tmp);
 
@@ -262,3 +275,34 @@ int fileio_size(struct fileio *fileio, size_t *size)
 
 	return ERROR_OK;
 }
+
+int fileio_mmap(struct fileio *fileio, const uint8_t **data)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->map) {
+		*data = fileio->map;
+		return ERROR_OK;
+	}
+
+	/* text mode may translate line endings, the size may change on write */
+	if (fileio->access != FILEIO_READ || fileio->type != FILEIO_BINARY ||
+			fileio->size == 0)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	void *map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE,
+			fileno(fileio->file), 0);
+	if (map == MAP_FAILED) {
+		LOG_DEBUG("couldn't map %s: %s", fileio->url, strerror(errno));
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+	}
+
+	/* sections are usually consumed front to back */
+	madvise(map, fileio->size, MADV_SEQUENTIAL);
+
+	fileio->map = map;
+	*data = map;
+	return ERROR_OK;
+#else
+	return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+#endif
+}
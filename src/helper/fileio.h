@@ -51,6 +51,14 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data);
 int fileio_write_u32(struct fileio *fileio, uint32_t data);
 int fileio_size(struct fileio *fileio, size_t *size);
 
+/**
+ * Map the whole file read-only into memory. The mapping is created on the
+ * first call and stays valid until fileio_close().
+ * @returns ERROR_OK, or ERROR_FILEIO_OPERATION_NOT_SUPPORTED if the file
+ * cannot be mapped; the caller then falls back to fileio_read().
+ */
+int fileio_mmap(struct fileio *fileio, const uint8_t **data);
+
 #define ERROR_FILEIO_LOCATION_UNKNOWN			(-1200)
 #define ERROR_FILEIO_NOT_FOUND					(-1201)
 #define ERROR_FILEIO_OPERATION_FAILED			(-1202)
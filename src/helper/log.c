@@ -24,6 +24,10 @@
 
 #include <stdarg.h>
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #ifdef _DEBUG_FREE_SPACE_
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
@@ -52,6 +56,54 @@ static const char * const log_strings[6] = {
 
 static int count;
 
+#ifdef HAVE_PTHREAD_H
+/*
+ * Messages logged by other threads, e.g. the JTAG adapter worker. They are
+ * not output at once since the log callbacks write to the GDB and telnet
+ * connections, which belong to the main thread; log_flush_deferred() does.
+ */
+struct log_deferred {
+	struct log_deferred *next;
+	enum log_levels level;
+	const char *file;
+	int line;
+	const char *function;
+	char string[];
+};
+
+static pthread_t log_main_thread;
+static bool log_main_thread_known;
+static pthread_mutex_t log_deferred_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct log_deferred *log_deferred_head;
+static struct log_deferred **log_deferred_tail = &log_deferred_head;
+
+static bool log_in_main_thread(void)
+{
+	return !log_main_thread_known || pthread_equal(pthread_self(), log_main_thread);
+}
+
+static void log_defer(enum log_levels level, const char *file, int line,
+	const char *function, const char *string)
+{
+	size_t len = strlen(string) + 1;
+	struct log_deferred *entry = malloc(sizeof(*entry) + len);
+	if (!entry)
+		return;
+
+	entry->next = NULL;
+	entry->level = level;
+	entry->file = file;
+	entry->line = line;
+	entry->function = function;
+	memcpy(entry->string, string, len);
+
+	pthread_mutex_lock(&log_deferred_lock);
+	*log_deferred_tail = entry;
+	log_deferred_tail = &entry->next;
+	pthread_mutex_unlock(&log_deferred_lock);
+}
+#endif
+
 /* forward the log to the listeners */
 static void log_forward(const char *file, unsigned line, const char *function, const char *string)
 {
@@ -83,6 +135,13 @@ static void log_puts(enum log_levels level,
 {
 	char *f;
 
+#ifdef HAVE_PTHREAD_H
+	if (!log_in_main_thread()) {
+		log_defer(level, file, line, function, string);
+		return;
+	}
+#endif
+
 	if (!log_output) {
 		/* log_init() not called yet; print on stderr */
 		fputs(string, stderr);
@@ -285,10 +344,35 @@ void log_init(void)
 		log_output = stderr;
 
 	start = last_time = timeval_ms();
+
+#ifdef HAVE_PTHREAD_H
+	log_main_thread = pthread_self();
+	log_main_thread_known = true;
+#endif
+}
+
+void log_flush_deferred(void)
+{
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_lock(&log_deferred_lock);
+	struct log_deferred *entry = log_deferred_head;
+	log_deferred_head = NULL;
+	log_deferred_tail = &log_deferred_head;
+	pthread_mutex_unlock(&log_deferred_lock);
+
+	while (entry) {
+		struct log_deferred *next = entry->next;
+		log_puts(entry->level, entry->file, entry->line, entry->function, entry->string);
+		free(entry);
+		entry = next;
+	}
+#endif
 }
 
 void log_exit(void)
 {
+	log_flush_deferred();
+
 	if (log_output && log_output != stderr) {
 		/* Close log file, if it was open and wasn't stderr. */
 		fclose(log_output);
@@ -417,6 +501,12 @@ static void gdb_timeout_warning(int64_t delta_time)
 
 void keep_alive(void)
 {
+#ifdef HAVE_PTHREAD_H
+	/* the thread waiting for this one keeps the connections alive */
+	if (!log_in_main_thread())
+		return;
+#endif
+
 	int64_t current_time = timeval_ms();
 	int64_t delta_time = current_time - last_time;
 
@@ -445,6 +535,11 @@ void keep_alive(void)
 /* reset keep alive timer without sending message */
 void kept_alive(void)
 {
+#ifdef HAVE_PTHREAD_H
+	if (!log_in_main_thread())
+		return;
+#endif
+
 	int64_t current_time = timeval_ms();
 
 	int64_t delta_time = current_time - last_time;
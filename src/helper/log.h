@@ -62,6 +62,8 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 5, 6)));
  */
 void log_init(void);
 void log_exit(void);
+/** Output the messages logged by other threads; call from the main thread. */
+void log_flush_deferred(void);
 
 int log_register_commands(struct command_context *cmd_ctx);
 
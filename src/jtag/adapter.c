@@ -183,6 +183,9 @@ int adapter_init(struct command_context *cmd_ctx)
 
 int adapter_quit(void)
 {
+	/* nothing must be in flight when the driver is closed */
+	jtag_set_async_flush(false);
+
 	if (is_adapter_initialized() && adapter_driver->quit) {
 		/* close the JTAG interface */
 		int result = adapter_driver->quit();
@@ -193,6 +196,9 @@ int adapter_quit(void)
 	free(adapter_config.serial);
 	free(adapter_config.usb_location);
 
+	jtag_command_queue_free();
+	interface_jtag_free_checks();
+
 	struct jtag_tap *t = jtag_all_taps();
 	while (t) {
 		struct jtag_tap *n = t->next_tap;
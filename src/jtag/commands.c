@@ -26,15 +26,43 @@
 struct cmd_queue_page {
 	struct cmd_queue_page *next;
 	void *address;
+	size_t size;
 	size_t used;
 };
 
+/*
+ * The pages are kept across queue resets and reused by the next queue,
+ * so that the queue memory is not allocated and freed on every flush.
+ * Only pages larger than the default size, made for a single large
+ * allocation, are released on reset.
+ */
 #define CMD_QUEUE_PAGE_SIZE (1024 * 1024)
-static struct cmd_queue_page *cmd_queue_pages;
-static struct cmd_queue_page *cmd_queue_pages_tail;
+
+/*
+ * A command queue with the memory of its commands. One of them is active
+ * at a time: jtag_queue_command() and cmd_queue_alloc() refer to it. The
+ * list is only published in jtag_command_queue while a driver executes it,
+ * so a queue can be executed while the next one is being built.
+ */
+struct cmd_queue {
+	struct jtag_command *head;
+	/* where the next command pointer will be stored */
+	struct jtag_command **next_command_pointer;
+	struct cmd_queue_page *pages;
+	/* page allocations are taken from, the following ones are empty */
+	struct cmd_queue_page *page_current;
+	/* bytes allocated in the queue */
+	size_t used;
+};
+
+static struct cmd_queue cmd_queue_default = {
+	.next_command_pointer = &cmd_queue_default.head,
+};
+static struct cmd_queue *cmd_queue_active = &cmd_queue_default;
+/* allocator statistics, for all the queues */
+static struct cmd_queue_stats cmd_queue_stats;
 
 struct jtag_command *jtag_command_queue;
-static struct jtag_command **next_command_pointer = &jtag_command_queue;
 
 void jtag_queue_command(struct jtag_command *cmd)
 {
@@ -54,21 +82,18 @@ void jtag_queue_command(struct jtag_command *cmd)
 	/* this command goes on the end, so ensure the queue terminates */
 	cmd->next = NULL;
 
-	struct jtag_command **last_cmd = next_command_pointer;
+	struct cmd_queue *queue = cmd_queue_active;
+	struct jtag_command **last_cmd = queue->next_command_pointer;
 	assert(last_cmd);
 	assert(!*last_cmd);
 	*last_cmd = cmd;
 
 	/* store location where the next command pointer will be stored */
-	next_command_pointer = &cmd->next;
+	queue->next_command_pointer = &cmd->next;
 }
 
 void *cmd_queue_alloc(size_t size)
 {
-	struct cmd_queue_page **p_page = &cmd_queue_pages;
-	int offset;
-	uint8_t *t;
-
 	/*
 	 * WARNING:
 	 *    We align/round the *SIZE* per below
@@ -101,50 +126,145 @@ void *cmd_queue_alloc(size_t size)
 	size = (size + ALIGN_SIZE - 1) & (~(ALIGN_SIZE - 1));
 	/* Done... */
 
-	if (*p_page) {
-		p_page = &cmd_queue_pages_tail;
-		if (CMD_QUEUE_PAGE_SIZE - (*p_page)->used < size)
-			p_page = &((*p_page)->next);
-	}
+	struct cmd_queue *queue = cmd_queue_active;
+	struct cmd_queue_page *page = queue->page_current;
+
+	if (!page || page->size - page->used < size) {
+		struct cmd_queue_page **p_page = page ? &page->next : &queue->pages;
+
+		if (!*p_page || (*p_page)->size < size) {
+			size_t alloc_size = MAX(size, (size_t)CMD_QUEUE_PAGE_SIZE);
+			struct cmd_queue_page *new_page = malloc(sizeof(*new_page));
+			uint8_t *address = malloc(alloc_size);
+			if (!new_page || !address) {
+				LOG_ERROR("Out of memory");
+				free(new_page);
+				free(address);
+				return NULL;
+			}
+			new_page->address = address;
+			new_page->size = alloc_size;
+			new_page->used = 0;
+			new_page->next = *p_page;
+			*p_page = new_page;
+
+			cmd_queue_stats.page_mallocs++;
+			cmd_queue_stats.retained_bytes += alloc_size;
+		}
 
-	if (!*p_page) {
-		*p_page = malloc(sizeof(struct cmd_queue_page));
-		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
-					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
-		(*p_page)->next = NULL;
-		cmd_queue_pages_tail = *p_page;
+		page = *p_page;
+		queue->page_current = page;
 	}
 
-	offset = (*p_page)->used;
-	(*p_page)->used += size;
+	void *t = (uint8_t *)page->address + page->used;
+	page->used += size;
+
+	queue->used += size;
+	cmd_queue_stats.allocs++;
+	cmd_queue_stats.alloc_bytes += size;
+	if (queue->used > cmd_queue_stats.peak_bytes)
+		cmd_queue_stats.peak_bytes = queue->used;
 
-	t = (*p_page)->address;
-	return t + offset;
+	return t;
 }
 
-static void cmd_queue_free(void)
+/* rewind the pages for the next commands */
+static void cmd_queue_rewind(struct cmd_queue *queue)
 {
-	struct cmd_queue_page *page = cmd_queue_pages;
+	struct cmd_queue_page **p_page = &queue->pages;
+
+	while (*p_page) {
+		struct cmd_queue_page *page = *p_page;
+		if (page->size > CMD_QUEUE_PAGE_SIZE) {
+			*p_page = page->next;
+			cmd_queue_stats.retained_bytes -= page->size;
+			free(page->address);
+			free(page);
+			continue;
+		}
+		page->used = 0;
+		p_page = &page->next;
+	}
+
+	queue->page_current = queue->pages;
+	queue->used = 0;
+}
 
-	while (page) {
-		struct cmd_queue_page *last = page;
+static void cmd_queue_free_pages(struct cmd_queue *queue)
+{
+	while (queue->pages) {
+		struct cmd_queue_page *page = queue->pages;
+		queue->pages = page->next;
+		cmd_queue_stats.retained_bytes -= page->size;
 		free(page->address);
-		page = page->next;
-		free(last);
+		free(page);
 	}
 
-	cmd_queue_pages = NULL;
-	cmd_queue_pages_tail = NULL;
+	queue->page_current = NULL;
+	queue->used = 0;
 }
 
-void jtag_command_queue_reset(void)
+void cmd_queue_reset(struct cmd_queue *queue)
 {
-	cmd_queue_free();
+	cmd_queue_rewind(queue);
+	cmd_queue_stats.resets++;
 
+	queue->head = NULL;
+	queue->next_command_pointer = &queue->head;
+}
+
+void jtag_command_queue_reset(void)
+{
+	cmd_queue_reset(cmd_queue_active);
 	jtag_command_queue = NULL;
-	next_command_pointer = &jtag_command_queue;
+}
+
+void jtag_command_queue_free(void)
+{
+	jtag_command_queue_reset();
+	cmd_queue_free_pages(cmd_queue_active);
+}
+
+struct cmd_queue *cmd_queue_new(void)
+{
+	struct cmd_queue *queue = calloc(1, sizeof(*queue));
+	if (!queue) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+
+	queue->next_command_pointer = &queue->head;
+	return queue;
+}
+
+void cmd_queue_delete(struct cmd_queue *queue)
+{
+	if (!queue)
+		return;
+
+	assert(queue != cmd_queue_active);
+	assert(queue != &cmd_queue_default);
+
+	cmd_queue_free_pages(queue);
+	free(queue);
+}
+
+struct cmd_queue *cmd_queue_select(struct cmd_queue *queue)
+{
+	struct cmd_queue *previous = cmd_queue_active;
+
+	cmd_queue_active = queue ? queue : &cmd_queue_default;
+	return previous;
+}
+
+struct jtag_command *cmd_queue_commands(const struct cmd_queue *queue)
+{
+	return (queue ? queue : cmd_queue_active)->head;
+}
+
+void cmd_queue_get_stats(struct cmd_queue_stats *stats)
+{
+	*stats = cmd_queue_stats;
 }
 
 /**
@@ -149,13 +149,60 @@ struct jtag_command {
 	struct jtag_command *next;
 };
 
-/** The current queue of jtag_command_s structures. */
+/**
+ * The queue of jtag_command_s structures the driver is executing. It is
+ * only valid within the execute_queue() callback of the driver.
+ */
 extern struct jtag_command *jtag_command_queue;
 
 void *cmd_queue_alloc(size_t size);
 
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
+/** Reset the queue and release the memory kept for later queues. */
+void jtag_command_queue_free(void);
+
+/** Statistics of the allocator behind cmd_queue_alloc(). */
+struct cmd_queue_stats {
+	/** Number of cmd_queue_alloc() calls. */
+	uint64_t allocs;
+	/** Bytes returned by cmd_queue_alloc(), after rounding. */
+	uint64_t alloc_bytes;
+	/** Number of queue resets, i.e. flushes. */
+	uint64_t resets;
+	/** Number of pages obtained from malloc(). */
+	uint64_t page_mallocs;
+	/** Largest number of bytes used by a single queue. */
+	size_t peak_bytes;
+	/** Memory currently kept by the allocator. */
+	size_t retained_bytes;
+};
+
+void cmd_queue_get_stats(struct cmd_queue_stats *stats);
+
+/**
+ * A JTAG command queue, with the memory of its commands.
+ *
+ * A default queue always exists. Additional queues let the owner of an
+ * adapter, or of a batch of commands, build a queue while another one is
+ * executed. Exactly one queue is active: the commands are added to it.
+ */
+struct cmd_queue;
+
+/** @returns A new, empty and inactive queue, or NULL. */
+struct cmd_queue *cmd_queue_new(void);
+/** Release an inactive queue created by cmd_queue_new(). */
+void cmd_queue_delete(struct cmd_queue *queue);
+/**
+ * Make @a queue the active queue; NULL selects the default one.
+ * The commands of the queue previously active are kept with it.
+ * @returns The queue previously active.
+ */
+struct cmd_queue *cmd_queue_select(struct cmd_queue *queue);
+/** @returns The first command of @a queue; NULL selects the active queue. */
+struct jtag_command *cmd_queue_commands(const struct cmd_queue *queue);
+/** Drop the commands of @a queue, keeping its memory for the next ones. */
+void cmd_queue_reset(struct cmd_queue *queue);
 
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
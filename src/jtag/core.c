@@ -44,7 +44,7 @@ static int jtag_flush_queue_count;
 /* Sleep this # of ms after flushing the queue */
 static int jtag_flush_queue_sleep;
 
-static void jtag_add_scan_check(struct jtag_tap *active,
+static void jtag_add_scan_check(struct jtag_tap *active, bool ir_scan,
 		void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
 		const struct scan_field *in_fields,
@@ -383,7 +383,7 @@ void jtag_add_ir_scan(struct jtag_tap *active, struct scan_field *in_fields, tap
 		 */
 		in_fields->check_value = active->expected;
 		in_fields->check_mask = active->expected_mask;
-		jtag_add_scan_check(active, jtag_add_ir_scan_noverify_callback, 1, in_fields,
+		jtag_add_scan_check(active, true, jtag_add_ir_scan_noverify_callback, 1, in_fields,
 			state);
 	} else
 		jtag_add_ir_scan_noverify(active, in_fields, state);
@@ -402,22 +402,8 @@ void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 	jtag_set_error(retval);
 }
 
-static int jtag_check_value_inner(uint8_t *captured, uint8_t *in_check_value,
-				  uint8_t *in_check_mask, int num_bits);
-
-static int jtag_check_value_mask_callback(jtag_callback_data_t data0,
-	jtag_callback_data_t data1,
-	jtag_callback_data_t data2,
-	jtag_callback_data_t data3)
-{
-	return jtag_check_value_inner((uint8_t *)data0,
-		(uint8_t *)data1,
-		(uint8_t *)data2,
-		(int)data3);
-}
-
-static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
-		struct jtag_tap *active,
+static void jtag_add_scan_check(struct jtag_tap *active, bool ir_scan,
+	void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
 		const struct scan_field *in_fields,
 		tap_state_t state),
@@ -426,13 +412,8 @@ static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 	jtag_add_scan(active, in_num_fields, in_fields, state);
 
 	for (int i = 0; i < in_num_fields; i++) {
-		if ((in_fields[i].check_value) && (in_fields[i].in_value)) {
-			jtag_add_callback4(jtag_check_value_mask_callback,
-				(jtag_callback_data_t)in_fields[i].in_value,
-				(jtag_callback_data_t)in_fields[i].check_value,
-				(jtag_callback_data_t)in_fields[i].check_mask,
-				(jtag_callback_data_t)in_fields[i].num_bits);
-		}
+		if ((in_fields[i].check_value) && (in_fields[i].in_value))
+			jtag_set_error(interface_jtag_add_check(active, ir_scan, i, &in_fields[i]));
 	}
 }
 
@@ -442,7 +423,7 @@ void jtag_add_dr_scan_check(struct jtag_tap *active,
 	tap_state_t state)
 {
 	if (jtag_verify)
-		jtag_add_scan_check(active, jtag_add_dr_scan, in_num_fields, in_fields, state);
+		jtag_add_scan_check(active, false, jtag_add_dr_scan, in_num_fields, in_fields, state);
 	else
 		jtag_add_dr_scan(active, in_num_fields, in_fields, state);
 }
@@ -1029,6 +1010,22 @@ void jtag_execute_queue_noclear(void)
 	}
 }
 
+void jtag_submit_queue(void)
+{
+	jtag_flush_queue_count++;
+	jtag_set_error(interface_jtag_submit_queue());
+}
+
+int jtag_set_async_flush(bool enable)
+{
+	return interface_jtag_set_worker(enable);
+}
+
+bool jtag_get_async_flush(void)
+{
+	return interface_jtag_get_worker();
+}
+
 int jtag_get_flush_queue_count(void)
 {
 	return jtag_flush_queue_count;
@@ -488,6 +488,8 @@ static int am335xgpio_quit(void)
 
 	am335xgpio_munmap();
 
+	bitbang_quit();
+
 	return ERROR_OK;
 }
 
@@ -265,6 +265,7 @@ static int at91rm9200_init(void)
 
 static int at91rm9200_quit(void)
 {
+	bitbang_quit();
 
 	return ERROR_OK;
 }
@@ -199,6 +199,48 @@ static int bcm2835gpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+static int bcm2835gpio_shift(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits)
+{
+	const uint32_t tck_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TCK].gpio_num;
+	const uint32_t tms_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TMS].gpio_num;
+	const uint32_t tdi_mask = 1 << adapter_gpio_config[ADAPTER_GPIO_IDX_TDI].gpio_num;
+	const unsigned int tdo_shift = adapter_gpio_config[ADAPTER_GPIO_IDX_TDO].gpio_num;
+	const uint32_t tdo_invert = adapter_gpio_config[ADAPTER_GPIO_IDX_TDO].active_low ? 1 : 0;
+
+	for (unsigned int i = 0; i < num_bits; i += 8) {
+		unsigned int n = MIN(num_bits - i, 8u);
+		uint8_t tms_byte = tms ? tms[i / 8] : 0;
+		uint8_t tdi_byte = tdi ? tdi[i / 8] : 0;
+		uint8_t tdo_byte = 0;
+
+		for (unsigned int j = 0; j < n; j++) {
+			uint32_t set = (((tms_byte >> j) & 1) ? tms_mask : 0) |
+					(((tdi_byte >> j) & 1) ? tdi_mask : 0);
+			uint32_t clear = (tms_mask | tdi_mask) & ~set;
+
+			GPIO_SET = set;
+			GPIO_CLR = clear | tck_mask;
+			bcm2835_gpio_synchronize();
+			bcm2835_delay();
+
+			if (tdo)
+				tdo_byte |= (((GPIO_LEV >> tdo_shift) & 1) ^ tdo_invert) << j;
+
+			GPIO_SET = set | tck_mask;
+			bcm2835_gpio_synchronize();
+			bcm2835_delay();
+		}
+
+		if (tdo) {
+			uint8_t mask = 0xff >> (8 - n);
+			tdo[i / 8] = (tdo[i / 8] & ~mask) | (tdo_byte & mask);
+		}
+	}
+
+	return ERROR_OK;
+}
+
 /* Requires push-pull drive mode for swclk and swdio */
 static int bcm2835gpio_swd_write_fast(int swclk, int swdio)
 {
@@ -419,6 +461,7 @@ static int bcm2835gpio_blink(int on)
 static struct bitbang_interface bcm2835gpio_bitbang = {
 	.read = bcm2835gpio_read,
 	.write = bcm2835gpio_write,
+	.shift = bcm2835gpio_shift,
 	.swdio_read = bcm2835_swdio_read,
 	.swdio_drive = bcm2835_swdio_drive,
 	.swd_write = bcm2835gpio_swd_write_generic,
@@ -563,6 +606,8 @@ static int bcm2835gpio_quit(void)
 	bcm2835gpio_munmap();
 	free(bcm2835_peri_mem_dev);
 
+	bitbang_quit();
+
 	return ERROR_OK;
 }
 
@@ -53,6 +53,127 @@ struct bitbang_interface *bitbang_interface;
  */
 #define CLOCK_IDLE() 0
 
+/* read the TDO samples buffered by sample() into bits first..first+count-1 */
+static int bitbang_read_samples(uint8_t *tdo, unsigned int first, unsigned int count)
+{
+	for (unsigned int i = first; i < first + count; i++) {
+		switch (bitbang_interface->read_sample()) {
+			case BB_LOW:
+				tdo[i / 8] &= ~(1 << (i % 8));
+				break;
+			case BB_HIGH:
+				tdo[i / 8] |= 1 << (i % 8);
+				break;
+			default:
+				return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* load up to 32 bits, LSB first; nbytes is in 1..4 */
+static inline uint32_t bitbang_load_word(const uint8_t *buf, unsigned int nbytes)
+{
+	if (nbytes == 4)
+		return le_to_h_u32(buf);
+
+	uint32_t word = 0;
+	for (unsigned int i = 0; i < nbytes; i++)
+		word |= (uint32_t)buf[i] << (8 * i);
+	return word;
+}
+
+/* store the num_bits low bits of word, leaving the following bits alone */
+static inline void bitbang_store_word(uint8_t *buf, uint32_t word, unsigned int num_bits)
+{
+	if (num_bits == 32) {
+		h_u32_to_le(buf, word);
+		return;
+	}
+
+	for (unsigned int i = 0; num_bits; i++) {
+		unsigned int n = MIN(num_bits, 8u);
+		uint8_t mask = 0xff >> (8 - n);
+		buf[i] = (buf[i] & ~mask) | ((word >> (8 * i)) & mask);
+		num_bits -= n;
+	}
+}
+
+/*
+ * Implementation of the shift() callback on top of write() and read() or
+ * sample(). TMS and TDI are taken 32 bits at a time, so the per bit work is
+ * reduced to the two edges and the TDO sample.
+ */
+static int bitbang_shift_generic(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned int num_bits)
+{
+	size_t buf_size = bitbang_interface->buf_size;
+	unsigned int buffered = 0;
+
+	for (unsigned int pos = 0; pos < num_bits; pos += 32) {
+		unsigned int n = MIN(num_bits - pos, 32u);
+		unsigned int nbytes = DIV_ROUND_UP(n, 8);
+		uint32_t tms_word = tms ? bitbang_load_word(tms + pos / 8, nbytes) : 0;
+		uint32_t tdi_word = tdi ? bitbang_load_word(tdi + pos / 8, nbytes) : 0;
+		uint32_t tdo_word = 0;
+
+		for (unsigned int i = 0; i < n; i++) {
+			int tms_bit = tms_word & 1;
+			int tdi_bit = tdi_word & 1;
+			tms_word >>= 1;
+			tdi_word >>= 1;
+
+			if (bitbang_interface->write(0, tms_bit, tdi_bit) != ERROR_OK)
+				return ERROR_FAIL;
+
+			if (tdo) {
+				if (buf_size) {
+					if (bitbang_interface->sample() != ERROR_OK)
+						return ERROR_FAIL;
+					buffered++;
+				} else {
+					switch (bitbang_interface->read()) {
+						case BB_LOW:
+							break;
+						case BB_HIGH:
+							tdo_word |= 1u << i;
+							break;
+						default:
+							return ERROR_FAIL;
+					}
+				}
+			}
+
+			if (bitbang_interface->write(1, tms_bit, tdi_bit) != ERROR_OK)
+				return ERROR_FAIL;
+
+			if (buffered && (buffered == buf_size || pos + i == num_bits - 1)) {
+				if (bitbang_read_samples(tdo, pos + i + 1 - buffered, buffered) != ERROR_OK)
+					return ERROR_FAIL;
+				buffered = 0;
+			}
+		}
+
+		if (tdo && !buf_size)
+			bitbang_store_word(tdo + pos / 8, tdo_word, n);
+	}
+
+	return ERROR_OK;
+}
+
+static int bitbang_shift(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+		unsigned int num_bits)
+{
+	if (!num_bits)
+		return ERROR_OK;
+
+	if (bitbang_interface->shift)
+		return bitbang_interface->shift(tms, tdi, tdo, num_bits);
+
+	return bitbang_shift_generic(tms, tdi, tdo, num_bits);
+}
+
 /* The bitbang driver leaves the TCK 0 when in idle */
 static void bitbang_end_state(tap_state_t state)
 {
@@ -62,16 +183,15 @@ static void bitbang_end_state(tap_state_t state)
 
 static int bitbang_state_move(int skip)
 {
-	int i = 0, tms = 0;
+	int tms = 0;
 	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), tap_get_end_state());
 	int tms_count = tap_get_tms_path_len(tap_get_state(), tap_get_end_state());
 
-	for (i = skip; i < tms_count; i++) {
-		tms = (tms_scan >> i) & 1;
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
-			return ERROR_FAIL;
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+	if (skip < tms_count) {
+		uint8_t tms_bits = tms_scan >> skip;
+		if (bitbang_shift(&tms_bits, NULL, NULL, tms_count - skip) != ERROR_OK)
 			return ERROR_FAIL;
+		tms = (tms_scan >> (tms_count - 1)) & 1;
 	}
 	if (bitbang_interface->write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
 		return ERROR_FAIL;
@@ -92,12 +212,10 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 	LOG_DEBUG_IO("TMS: %d bits", num_bits);
 
 	int tms = 0;
-	for (unsigned i = 0; i < num_bits; i++) {
-		tms = ((bits[i/8] >> (i % 8)) & 1);
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
-			return ERROR_FAIL;
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+	if (num_bits) {
+		if (bitbang_shift(bits, NULL, NULL, num_bits) != ERROR_OK)
 			return ERROR_FAIL;
+		tms = (bits[(num_bits - 1) / 8] >> ((num_bits - 1) % 8)) & 1;
 	}
 	if (bitbang_interface->write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
 		return ERROR_FAIL;
@@ -143,8 +261,6 @@ static int bitbang_path_move(struct pathmove_command *cmd)
 
 static int bitbang_runtest(int num_cycles)
 {
-	int i;
-
 	tap_state_t saved_end_state = tap_get_end_state();
 
 	/* only do a state_move when we're not already in IDLE */
@@ -155,12 +271,8 @@ static int bitbang_runtest(int num_cycles)
 	}
 
 	/* execute num_cycles */
-	for (i = 0; i < num_cycles; i++) {
-		if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
-			return ERROR_FAIL;
-		if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
-			return ERROR_FAIL;
-	}
+	if (bitbang_shift(NULL, NULL, NULL, num_cycles) != ERROR_OK)
+		return ERROR_FAIL;
 	if (bitbang_interface->write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
 		return ERROR_FAIL;
 
@@ -189,11 +301,21 @@ static int bitbang_stableclocks(int num_cycles)
 	return ERROR_OK;
 }
 
+/* TMS pattern of the scans, all low; grown on demand and kept for the next scans */
+static uint8_t *bitbang_scan_tms;
+static unsigned int bitbang_scan_tms_size;
+
+void bitbang_quit(void)
+{
+	free(bitbang_scan_tms);
+	bitbang_scan_tms = NULL;
+	bitbang_scan_tms_size = 0;
+}
+
 static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		unsigned scan_size)
 {
 	tap_state_t saved_end_state = tap_get_end_state();
-	unsigned bit_cnt;
 
 	if (!((!ir_scan &&
 			(tap_get_state() == TAP_DRSHIFT)) ||
@@ -208,63 +330,33 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		bitbang_end_state(saved_end_state);
 	}
 
-	size_t buffered = 0;
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
-		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
-		int tdi;
-		int bytec = bit_cnt/8;
-		int bcval = 1 << (bit_cnt % 8);
-
-		/* if we're just reading the scan, but don't care about the output
-		 * default to outputting 'low', this also makes valgrind traces more readable,
-		 * as it removes the dependency on an uninitialised value
-		 */
-		tdi = 0;
-		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
-			tdi = 1;
-
-		if (bitbang_interface->write(0, tms, tdi) != ERROR_OK)
-			return ERROR_FAIL;
-
-		if (type != SCAN_OUT) {
-			if (bitbang_interface->buf_size) {
-				if (bitbang_interface->sample() != ERROR_OK)
-					return ERROR_FAIL;
-				buffered++;
-			} else {
-				switch (bitbang_interface->read()) {
-					case BB_LOW:
-						buffer[bytec] &= ~bcval;
-						break;
-					case BB_HIGH:
-						buffer[bytec] |= bcval;
-						break;
-					default:
-						return ERROR_FAIL;
-				}
+	/* if we're just reading the scan, but don't care about the output
+	 * default to outputting 'low', this also makes valgrind traces more readable,
+	 * as it removes the dependency on an uninitialised value
+	 */
+	const uint8_t *tdi = (type != SCAN_IN) ? buffer : NULL;
+	uint8_t *tdo = (type != SCAN_OUT) ? buffer : NULL;
+
+	if (scan_size) {
+		unsigned int size = DIV_ROUND_UP(scan_size, 8);
+		if (size > bitbang_scan_tms_size) {
+			size = MAX(size, 2 * bitbang_scan_tms_size);
+			uint8_t *tms = realloc(bitbang_scan_tms, size);
+			if (!tms) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
 			}
+			memset(tms + bitbang_scan_tms_size, 0, size - bitbang_scan_tms_size);
+			bitbang_scan_tms = tms;
+			bitbang_scan_tms_size = size;
 		}
 
-		if (bitbang_interface->write(1, tms, tdi) != ERROR_OK)
+		/* the last bit is clocked with TMS high, to leave the shift state */
+		buf_set_u32(bitbang_scan_tms, scan_size - 1, 1, 1);
+		int retval = bitbang_shift(bitbang_scan_tms, tdi, tdo, scan_size);
+		buf_set_u32(bitbang_scan_tms, scan_size - 1, 1, 0);
+		if (retval != ERROR_OK)
 			return ERROR_FAIL;
-
-		if (type != SCAN_OUT && bitbang_interface->buf_size &&
-				(buffered == bitbang_interface->buf_size ||
-				 bit_cnt == scan_size - 1)) {
-			for (unsigned i = bit_cnt + 1 - buffered; i <= bit_cnt; i++) {
-				switch (bitbang_interface->read_sample()) {
-					case BB_LOW:
-						buffer[i/8] &= ~(1 << (i % 8));
-						break;
-					case BB_HIGH:
-						buffer[i/8] |= 1 << (i % 8);
-						break;
-					default:
-						return ERROR_FAIL;
-				}
-			}
-			buffered = 0;
-		}
 	}
 
 	if (tap_get_state() != tap_get_end_state()) {
@@ -43,6 +43,18 @@ struct bitbang_interface {
 	/** Set TCK, TMS, and TDI to the given values. */
 	int (*write)(int tck, int tms, int tdi);
 
+	/** Clock a run of bits (optional).
+	 *
+	 * For each bit, set TCK low with the TMS and TDI values of that bit,
+	 * sample TDO if @a tdo is not NULL, then set TCK high. TCK is left high.
+	 * Bits are stored LSB first. A NULL @a tms or @a tdi keeps that line
+	 * low. @a tdo may be the same buffer as @a tdi; only the bits clocked
+	 * are modified in it.
+	 *
+	 * When not implemented, bitbang uses write() and read() or sample(). */
+	int (*shift)(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+			unsigned int num_bits);
+
 	/** Blink led (optional). */
 	int (*blink)(int on);
 
@@ -60,6 +72,9 @@ extern const struct swd_driver bitbang_swd;
 
 int bitbang_execute_queue(void);
 
+/** Free the buffers of bitbang_execute_queue(), from the quit() of the drivers. */
+void bitbang_quit(void);
+
 extern struct bitbang_interface *bitbang_interface;
 
 #endif /* OPENOCD_JTAG_DRIVERS_BITBANG_H */
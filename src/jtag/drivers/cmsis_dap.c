@@ -299,9 +299,11 @@ static void cmsis_dap_close(struct cmsis_dap *dap)
 
 	free(dap->packet_buffer);
 
-	for (unsigned int i = 0; i < MAX_PENDING_REQUESTS; i++) {
-		free(dap->pending_fifo[i].transfers);
-		dap->pending_fifo[i].transfers = NULL;
+	if (dap->pending_fifo) {
+		for (unsigned int i = 0; i < dap->packet_count; i++)
+			free(dap->pending_fifo[i].transfers);
+		free(dap->pending_fifo);
+		dap->pending_fifo = NULL;
 	}
 
 	free(cmsis_dap_handle);
@@ -930,10 +932,32 @@ skip:
 	dap->pending_fifo_block_count--;
 }
 
+/* Process the responses already received, without waiting */
+static void cmsis_dap_swd_poll_responses(struct cmsis_dap *dap)
+{
+	while (dap->pending_fifo_block_count) {
+		unsigned int block_count = dap->pending_fifo_block_count;
+		cmsis_dap_swd_read_process(dap, 0);
+		if (dap->pending_fifo_block_count == block_count)
+			break;
+	}
+}
+
+/* Send the packet being filled and start a new one. Waits for a response
+ * only if all the packets the adapter can buffer are in flight */
+static void cmsis_dap_swd_send_packet(struct cmsis_dap *dap)
+{
+	cmsis_dap_swd_poll_responses(dap);
+
+	cmsis_dap_swd_write_from_queue(dap);
+
+	if (dap->pending_fifo_block_count >= dap->packet_count)
+		cmsis_dap_swd_read_process(dap, LIBUSB_TIMEOUT_MS);
+}
+
 static int cmsis_dap_swd_run_queue(void)
 {
-	if (cmsis_dap_handle->pending_fifo_block_count)
-		cmsis_dap_swd_read_process(cmsis_dap_handle, 0);
+	cmsis_dap_swd_poll_responses(cmsis_dap_handle);
 
 	cmsis_dap_swd_write_from_queue(cmsis_dap_handle);
 
@@ -1009,14 +1033,8 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 			|| resp_size > tfer_max_response_size
 			|| targetsel_cmd
 			|| write_count + read_count > max_transfer_count) {
-		if (cmsis_dap_handle->pending_fifo_block_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, 0);
-
 		/* Not enough room in the queue. Run the queue. */
-		cmsis_dap_swd_write_from_queue(cmsis_dap_handle);
-
-		if (cmsis_dap_handle->pending_fifo_block_count >= cmsis_dap_handle->packet_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, LIBUSB_TIMEOUT_MS);
+		cmsis_dap_swd_send_packet(cmsis_dap_handle);
 	}
 
 	assert(cmsis_dap_handle->pending_fifo[cmsis_dap_handle->pending_fifo_put_idx].transfer_count < pending_queue_len);
@@ -1323,12 +1341,19 @@ static int cmsis_dap_init(void)
 	if (data[0] == 1) { /* byte */
 		unsigned int pkt_cnt = data[1];
 		if (pkt_cnt > 1)
-			cmsis_dap_handle->packet_count = MIN(MAX_PENDING_REQUESTS, pkt_cnt);
+			cmsis_dap_handle->packet_count = pkt_cnt;
 
 		LOG_DEBUG("CMSIS-DAP: Packet Count = %u", pkt_cnt);
 	}
 
 	LOG_DEBUG("Allocating FIFO for %u pending packets", cmsis_dap_handle->packet_count);
+	cmsis_dap_handle->pending_fifo = calloc(cmsis_dap_handle->packet_count,
+									sizeof(struct pending_request_block));
+	if (!cmsis_dap_handle->pending_fifo) {
+		LOG_ERROR("Unable to allocate memory for CMSIS-DAP queue");
+		retval = ERROR_FAIL;
+		goto init_err;
+	}
 	for (unsigned int i = 0; i < cmsis_dap_handle->packet_count; i++) {
 		cmsis_dap_handle->pending_fifo[i].transfers = malloc(pending_queue_len
 									 * sizeof(struct pending_transfer_result));
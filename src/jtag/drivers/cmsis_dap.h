@@ -14,10 +14,6 @@ struct pending_transfer_result {
 	void *buffer;
 };
 
-/* Up to MIN(packet_count, MAX_PENDING_REQUESTS) requests may be issued
- * until the first response arrives */
-#define MAX_PENDING_REQUESTS 4
-
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
 	unsigned int transfer_count;
@@ -45,8 +41,10 @@ struct cmsis_dap {
 	uint8_t common_swd_cmd;
 	bool swd_cmds_differ;
 
-	/* Pending requests are organized as a FIFO - circular buffer */
-	struct pending_request_block pending_fifo[MAX_PENDING_REQUESTS];
+	/* Pending requests are organized as a FIFO - circular buffer.
+	 * Up to packet_count requests, as reported by the adapter, may be
+	 * issued until the first response arrives */
+	struct pending_request_block *pending_fifo;
 	unsigned int packet_count;
 	unsigned int pending_fifo_put_idx, pending_fifo_get_idx;
 	unsigned int pending_fifo_block_count;
@@ -28,8 +28,28 @@
 #include <libusb.h>
 #include <helper/log.h>
 #include <helper/replacements.h>
+#include <helper/time_support.h>
 
 #include "cmsis_dap.h"
+#include "libusb_helper.h"
+
+/* Compatibility define for older libusb-1.0 */
+#ifndef LIBUSB_CALL
+#define LIBUSB_CALL
+#endif
+
+/* Maximal number of responses awaited at the same time: the adapter reports
+ * its packet count in a byte, plus one for a read without a command */
+#define MAX_PENDING_READS 256
+
+/* The response to a command is read by a bulk IN transfer submitted right
+ * after the command, so the host collects it as soon as the adapter has it,
+ * while the next commands are being built and sent */
+struct cmsis_dap_bulk_read {
+	struct libusb_transfer *transfer;
+	uint8_t *buffer;
+	int completed;
+};
 
 struct cmsis_dap_backend_data {
 	struct libusb_context *usb_ctx;
@@ -37,6 +57,11 @@ struct cmsis_dap_backend_data {
 	unsigned int ep_out;
 	unsigned int ep_in;
 	int interface;
+
+	/* Reads in flight - circular buffer, oldest first */
+	struct cmsis_dap_bulk_read reads[MAX_PENDING_READS];
+	unsigned int read_first;
+	unsigned int read_count;
 };
 
 static int cmsis_dap_usb_interface = -1;
@@ -343,7 +368,7 @@ static int cmsis_dap_usb_open(struct cmsis_dap *dap, uint16_t vids[], uint16_t p
 			if (err)
 				LOG_WARNING("could not claim interface: %s", libusb_strerror(err));
 
-			dap->bdata = malloc(sizeof(struct cmsis_dap_backend_data));
+			dap->bdata = calloc(1, sizeof(struct cmsis_dap_backend_data));
 			if (!dap->bdata) {
 				LOG_ERROR("unable to allocate memory");
 				libusb_release_interface(dev_handle, interface_num);
@@ -374,8 +399,108 @@ static int cmsis_dap_usb_open(struct cmsis_dap *dap, uint16_t vids[], uint16_t p
 	return ERROR_FAIL;
 }
 
+static void LIBUSB_CALL cmsis_dap_usb_read_cb(struct libusb_transfer *transfer)
+{
+	int *completed = transfer->user_data;
+	*completed = 1;
+}
+
+static int cmsis_dap_usb_submit_read(struct cmsis_dap *dap)
+{
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+
+	/* The response is then read by a transfer submitted when needed */
+	if (bdata->read_count == MAX_PENDING_READS)
+		return ERROR_OK;
+
+	struct cmsis_dap_bulk_read *read =
+		&bdata->reads[(bdata->read_first + bdata->read_count) % MAX_PENDING_READS];
+
+	if (!read->transfer) {
+		read->transfer = libusb_alloc_transfer(0);
+		if (!read->transfer) {
+			LOG_ERROR("unable to allocate USB transfer");
+			return ERROR_FAIL;
+		}
+	}
+	if (!read->buffer) {
+		read->buffer = malloc(dap->packet_buffer_size);
+		if (!read->buffer) {
+			LOG_ERROR("unable to allocate memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	read->completed = 0;
+	libusb_fill_bulk_transfer(read->transfer, bdata->dev_handle, bdata->ep_in,
+							read->buffer, dap->packet_size, cmsis_dap_usb_read_cb,
+							&read->completed, 0);
+	int err = libusb_submit_transfer(read->transfer);
+	if (err) {
+		LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
+		return ERROR_FAIL;
+	}
+
+	bdata->read_count++;
+	return ERROR_OK;
+}
+
+/* Wait until the transfer completes or timeout_ms elapses */
+static int cmsis_dap_usb_wait_read(struct cmsis_dap *dap, struct cmsis_dap_bulk_read *read,
+							int timeout_ms)
+{
+	int64_t start = timeval_ms();
+
+	while (!read->completed) {
+		int64_t remaining = MAX(timeout_ms - (timeval_ms() - start), 0);
+		struct timeval tv = {
+			.tv_sec = remaining / 1000,
+			.tv_usec = remaining % 1000 * 1000,
+		};
+		int err = libusb_handle_events_timeout_completed(dap->bdata->usb_ctx, &tv,
+							&read->completed);
+		if (err && err != LIBUSB_ERROR_INTERRUPTED) {
+			LOG_ERROR("error handling USB events: %s", libusb_strerror(err));
+			return ERROR_FAIL;
+		}
+		if (!read->completed && remaining == 0)
+			return ERROR_TIMEOUT_REACHED;
+	}
+
+	return ERROR_OK;
+}
+
+static void cmsis_dap_usb_cancel_reads(struct cmsis_dap *dap)
+{
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+
+	for (unsigned int i = 0; i < bdata->read_count; i++) {
+		struct cmsis_dap_bulk_read *read =
+			&bdata->reads[(bdata->read_first + i) % MAX_PENDING_READS];
+		libusb_cancel_transfer(read->transfer);
+		cmsis_dap_usb_wait_read(dap, read, LIBUSB_TIMEOUT_MS);
+	}
+
+	bdata->read_first = 0;
+	bdata->read_count = 0;
+}
+
+static void cmsis_dap_usb_free_reads(struct cmsis_dap *dap)
+{
+	cmsis_dap_usb_cancel_reads(dap);
+
+	for (unsigned int i = 0; i < MAX_PENDING_READS; i++) {
+		struct cmsis_dap_bulk_read *read = &dap->bdata->reads[i];
+		libusb_free_transfer(read->transfer);
+		read->transfer = NULL;
+		free(read->buffer);
+		read->buffer = NULL;
+	}
+}
+
 static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 {
+	cmsis_dap_usb_free_reads(dap);
 	libusb_release_interface(dap->bdata->dev_handle, dap->bdata->interface);
 	libusb_close(dap->bdata->dev_handle);
 	libusb_exit(dap->bdata->usb_ctx);
@@ -385,22 +510,50 @@ static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 	dap->packet_buffer = NULL;
 }
 
+/* Returns the oldest response. With timeout_ms 0 it does not wait and the
+ * response can be picked up later, otherwise it is given up on timeout */
 static int cmsis_dap_usb_read(struct cmsis_dap *dap, int timeout_ms)
 {
-	int transferred = 0;
-	int err;
+	struct cmsis_dap_backend_data *bdata = dap->bdata;
+	int retval;
 
-	err = libusb_bulk_transfer(dap->bdata->dev_handle, dap->bdata->ep_in,
-							dap->packet_buffer, dap->packet_size, &transferred, timeout_ms);
-	if (err) {
-		if (err == LIBUSB_ERROR_TIMEOUT) {
-			return ERROR_TIMEOUT_REACHED;
-		} else {
-			LOG_ERROR("error reading data: %s", libusb_strerror(err));
-			return ERROR_FAIL;
-		}
+	if (bdata->read_count == 0) {
+		retval = cmsis_dap_usb_submit_read(dap);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
+	struct cmsis_dap_bulk_read *read = &bdata->reads[bdata->read_first];
+	retval = cmsis_dap_usb_wait_read(dap, read, timeout_ms);
+	if (retval == ERROR_TIMEOUT_REACHED && timeout_ms == 0)
+		return retval;
+
+	if (retval == ERROR_TIMEOUT_REACHED) {
+		libusb_cancel_transfer(read->transfer);
+		cmsis_dap_usb_wait_read(dap, read, LIBUSB_TIMEOUT_MS);
+	}
+
+	bdata->read_first = (bdata->read_first + 1) % MAX_PENDING_READS;
+	bdata->read_count--;
+
+	if (retval == ERROR_FAIL)
+		return retval;
+
+	int transferred = read->transfer->actual_length;
+	switch (read->transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		break;
+	case LIBUSB_TRANSFER_CANCELLED:
+		/* It can have completed nevertheless */
+		if (transferred > 0)
+			break;
+		return ERROR_TIMEOUT_REACHED;
+	default:
+		LOG_ERROR("error reading data: transfer status %d", read->transfer->status);
+		return ERROR_FAIL;
+	}
+
+	memcpy(dap->packet_buffer, read->buffer, transferred);
 	memset(&dap->packet_buffer[transferred], 0, dap->packet_buffer_size - transferred);
 
 	return transferred;
@@ -423,11 +576,18 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 		}
 	}
 
+	int retval = cmsis_dap_usb_submit_read(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return transferred;
 }
 
 static int cmsis_dap_usb_alloc(struct cmsis_dap *dap, unsigned int pkt_sz)
 {
+	/* The buffers of the reads follow the packet size */
+	cmsis_dap_usb_free_reads(dap);
+
 	uint8_t *buf = malloc(pkt_sz);
 	if (!buf) {
 		LOG_ERROR("unable to allocate CMSIS-DAP packet buffer");
@@ -24,6 +24,11 @@
 #include <jtag/commands.h>
 #include <jtag/minidriver.h>
 #include <helper/command.h>
+#include <helper/time_support.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 struct jtag_callback_entry {
 	struct jtag_callback_entry *next;
@@ -44,6 +49,83 @@ static void jtag_callback_queue_reset(void)
 	jtag_callback_queue_tail = NULL;
 }
 
+/* comparison of a captured field, see interface_jtag_add_check() */
+struct jtag_check {
+	const uint8_t *captured;
+	const uint8_t *value;
+	const uint8_t *mask;
+	unsigned int num_bits;
+	/* where the field comes from, for the report */
+	struct jtag_tap *tap;
+	bool ir_scan;
+	unsigned int scan;
+	unsigned int field;
+};
+
+/*
+ * The checks of a queue, stored in one array which is kept across flushes
+ * and compared in a single pass once the queue has been executed, instead
+ * of a callback per checked field.
+ */
+struct jtag_check_table {
+	struct jtag_check *checks;
+	unsigned int count;
+	unsigned int size;
+	/* scans in the queue, to number them in the reports */
+	unsigned int scans;
+};
+
+static struct jtag_check_table jtag_check_table;
+
+static void jtag_check_table_reset(struct jtag_check_table *table)
+{
+	table->count = 0;
+	table->scans = 0;
+}
+
+static void jtag_check_report(const struct jtag_check *check)
+{
+	int bits = MIN(check->num_bits, DEBUG_JTAG_IOZ);
+	char *captured_str = buf_to_hex_str(check->captured, bits);
+	char *value_str = buf_to_hex_str(check->value, bits);
+
+	LOG_WARNING("Bad value '%s' captured during %s scan %u of the queue, field %u of TAP %s:",
+		captured_str, check->ir_scan ? "IR" : "DR", check->scan, check->field,
+		check->tap ? jtag_tap_name(check->tap) : "(none)");
+	LOG_WARNING(" check_value: 0x%s", value_str);
+
+	free(captured_str);
+	free(value_str);
+
+	if (check->mask) {
+		char *mask_str = buf_to_hex_str(check->mask, bits);
+		LOG_WARNING(" check_mask: 0x%s", mask_str);
+		free(mask_str);
+	}
+}
+
+/* compare all the checks of an executed queue, report each mismatch */
+static int jtag_check_table_run(const struct jtag_check_table *table)
+{
+	int retval = ERROR_OK;
+
+	for (const struct jtag_check *check = table->checks;
+			check < table->checks + table->count; check++) {
+		bool failed;
+		if (check->mask)
+			failed = buf_cmp_mask(check->captured, check->value, check->mask, check->num_bits);
+		else
+			failed = buf_cmp(check->captured, check->value, check->num_bits);
+
+		if (failed) {
+			jtag_check_report(check);
+			retval = ERROR_JTAG_QUEUE_FAILED;
+		}
+	}
+
+	return retval;
+}
+
 /**
  * see jtag_add_ir_scan()
  *
@@ -53,6 +135,8 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 {
 	size_t num_taps = jtag_tap_count_enabled();
 
+	jtag_check_table.scans++;
+
 	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
 	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
 	struct scan_field *out_fields = cmd_queue_alloc(num_taps  * sizeof(struct scan_field));
@@ -116,6 +200,8 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 			bypass_devices++;
 	}
 
+	jtag_check_table.scans++;
+
 	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
 	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
 	struct scan_field *out_fields = cmd_queue_alloc((in_num_fields + bypass_devices) * sizeof(struct scan_field));
@@ -171,6 +257,8 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
 		uint8_t *in_bits, tap_state_t state, bool ir_scan)
 {
+	jtag_check_table.scans++;
+
 	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
 	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
 	struct scan_field *out_fields = cmd_queue_alloc(sizeof(struct scan_field));
@@ -348,31 +436,316 @@ void interface_jtag_add_callback4(jtag_callback_t callback,
 	}
 }
 
-int interface_jtag_execute_queue(void)
+int interface_jtag_add_check(struct jtag_tap *tap, bool ir_scan,
+		unsigned int field_index, const struct scan_field *field)
 {
-	static int reentry;
+	struct jtag_check_table *table = &jtag_check_table;
+
+	if (table->count == table->size) {
+		unsigned int size = table->size ? 2 * table->size : 64;
+		struct jtag_check *checks = realloc(table->checks, size * sizeof(*checks));
+		if (!checks) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		table->checks = checks;
+		table->size = size;
+	}
 
-	assert(reentry == 0);
-	reentry++;
+	assert(table->scans);
+	table->checks[table->count++] = (struct jtag_check){
+		.captured = field->in_value,
+		.value = field->check_value,
+		.mask = field->check_mask,
+		.num_bits = field->num_bits,
+		.tap = tap,
+		.ir_scan = ir_scan,
+		.scan = table->scans - 1,
+		.field = field_index,
+	};
 
-	int retval = default_interface_jtag_execute_queue();
-	if (retval == ERROR_OK) {
-		struct jtag_callback_entry *entry;
-		for (entry = jtag_callback_queue_head; entry; entry = entry->next) {
-			retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
-			if (retval != ERROR_OK)
-				break;
+	return ERROR_OK;
+}
+
+static int jtag_execute_reentry;
+
+static int jtag_callback_queue_run(struct jtag_callback_entry *entry)
+{
+	for (; entry; entry = entry->next) {
+		int retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Check the captured values, then run the callbacks of an executed queue.
+ * A failed check does not skip the callbacks, other callers rely on the
+ * conversions they do; it is reported once they have all run.
+ */
+static int jtag_queue_results_run(const struct jtag_check_table *checks,
+		struct jtag_callback_entry *callbacks)
+{
+	int check_retval = jtag_check_table_run(checks);
+	int retval = jtag_callback_queue_run(callbacks);
+
+	return (check_retval != ERROR_OK) ? check_retval : retval;
+}
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * Optional I/O worker. jtag_submit_queue() hands the active command queue
+ * to a thread, which runs the execute_queue() of the driver, and selects a
+ * second queue where the next commands are built in the meantime.
+ *
+ * Only one batch is in flight. Its callbacks are run by the main thread
+ * once it has completed: when the next batch is submitted, or at the
+ * latest by jtag_execute_queue(), which stays the synchronization point.
+ */
+struct jtag_worker {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool running;
+	/* ask the thread to exit */
+	bool quit;
+	/* a batch has been handed to the thread and is not collected yet */
+	bool in_flight;
+	/* the batch in flight has been executed */
+	bool done;
+	/* the batch in flight, its checks and its callbacks */
+	struct cmd_queue *queue;
+	struct jtag_check_table checks;
+	struct jtag_callback_entry *callbacks;
+	int retval;
+	/* the queue created for the worker, and the one not in use */
+	struct cmd_queue *own_queue;
+	struct cmd_queue *spare_queue;
+};
+
+static struct jtag_worker jtag_worker = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+/* while waiting for the worker, keep GDB alive at this interval */
+#define JTAG_WORKER_KEEP_ALIVE_MS 100
+
+static void *jtag_worker_thread(void *arg)
+{
+	struct jtag_worker *worker = arg;
+
+	pthread_mutex_lock(&worker->lock);
+	while (true) {
+		while (!worker->quit && (!worker->in_flight || worker->done))
+			pthread_cond_wait(&worker->cond, &worker->lock);
+		if (worker->quit)
+			break;
+		pthread_mutex_unlock(&worker->lock);
+
+		/* the main thread does not touch jtag_command_queue meanwhile */
+		jtag_command_queue = cmd_queue_commands(worker->queue);
+		int retval = default_interface_jtag_execute_queue();
+		jtag_command_queue = NULL;
+
+		pthread_mutex_lock(&worker->lock);
+		worker->retval = retval;
+		worker->done = true;
+		pthread_cond_broadcast(&worker->cond);
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	return NULL;
+}
+
+/* wait for the batch in flight, then run its callbacks */
+static int jtag_worker_collect(void)
+{
+	struct jtag_worker *worker = &jtag_worker;
+
+	if (!worker->in_flight)
+		return ERROR_OK;
+
+	pthread_mutex_lock(&worker->lock);
+	while (!worker->done) {
+		int64_t deadline = timeval_ms() + JTAG_WORKER_KEEP_ALIVE_MS;
+		struct timespec ts = {
+			.tv_sec = deadline / 1000,
+			.tv_nsec = (deadline % 1000) * 1000000,
+		};
+		if (pthread_cond_timedwait(&worker->cond, &worker->lock, &ts) == ETIMEDOUT) {
+			pthread_mutex_unlock(&worker->lock);
+			keep_alive();
+			pthread_mutex_lock(&worker->lock);
 		}
 	}
+	int retval = worker->retval;
+	worker->in_flight = false;
+	worker->done = false;
+	pthread_mutex_unlock(&worker->lock);
+
+	/* output what the driver logged from the worker */
+	log_flush_deferred();
+
+	jtag_execute_reentry++;
+	if (retval == ERROR_OK)
+		retval = jtag_queue_results_run(&worker->checks, worker->callbacks);
+	jtag_execute_reentry--;
+
+	jtag_check_table_reset(&worker->checks);
+	cmd_queue_reset(worker->queue);
+	worker->spare_queue = worker->queue;
+	worker->queue = NULL;
+	worker->callbacks = NULL;
+
+	return retval;
+}
+
+int interface_jtag_submit_queue(void)
+{
+	struct jtag_worker *worker = &jtag_worker;
+
+	if (!worker->running || !cmd_queue_commands(NULL))
+		return interface_jtag_execute_queue();
+
+	assert(jtag_execute_reentry == 0);
+
+	int retval = jtag_worker_collect();
+
+	pthread_mutex_lock(&worker->lock);
+	worker->queue = cmd_queue_select(worker->spare_queue);
+	/* the table of the worker is empty, swap it with the one filled */
+	struct jtag_check_table checks = worker->checks;
+	worker->checks = jtag_check_table;
+	jtag_check_table = checks;
+	worker->callbacks = jtag_callback_queue_head;
+	worker->spare_queue = NULL;
+	worker->in_flight = true;
+	pthread_cond_broadcast(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
 
-	jtag_command_queue_reset();
 	jtag_callback_queue_reset();
 
-	reentry--;
+	return retval;
+}
+
+int interface_jtag_set_worker(bool enable)
+{
+	struct jtag_worker *worker = &jtag_worker;
+
+	if (enable == worker->running)
+		return ERROR_OK;
+
+	if (enable) {
+		worker->own_queue = cmd_queue_new();
+		if (!worker->own_queue)
+			return ERROR_FAIL;
+		worker->spare_queue = worker->own_queue;
+		worker->quit = false;
+
+		int retval = pthread_create(&worker->thread, NULL, jtag_worker_thread, worker);
+		if (retval != 0) {
+			LOG_ERROR("cannot create the JTAG worker thread: %s", strerror(retval));
+			cmd_queue_delete(worker->own_queue);
+			worker->own_queue = NULL;
+			worker->spare_queue = NULL;
+			return ERROR_FAIL;
+		}
+		worker->running = true;
+		return ERROR_OK;
+	}
+
+	/* execute what is queued, then go back to the default queue */
+	int retval = interface_jtag_execute_queue();
+
+	pthread_mutex_lock(&worker->lock);
+	worker->quit = true;
+	pthread_cond_broadcast(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+	pthread_join(worker->thread, NULL);
+	worker->running = false;
+
+	cmd_queue_select(NULL);
+	cmd_queue_delete(worker->own_queue);
+	worker->own_queue = NULL;
+	worker->spare_queue = NULL;
 
 	return retval;
 }
 
+bool interface_jtag_get_worker(void)
+{
+	return jtag_worker.running;
+}
+
+static void jtag_worker_free_checks(void)
+{
+	free(jtag_worker.checks.checks);
+	jtag_worker.checks = (struct jtag_check_table){ 0 };
+}
+#else
+static int jtag_worker_collect(void)
+{
+	return ERROR_OK;
+}
+
+int interface_jtag_submit_queue(void)
+{
+	return interface_jtag_execute_queue();
+}
+
+int interface_jtag_set_worker(bool enable)
+{
+	if (enable) {
+		LOG_ERROR("JTAG worker thread not supported on this host");
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	return ERROR_OK;
+}
+
+bool interface_jtag_get_worker(void)
+{
+	return false;
+}
+
+static void jtag_worker_free_checks(void)
+{
+}
+#endif /* HAVE_PTHREAD_H */
+
+int interface_jtag_execute_queue(void)
+{
+	assert(jtag_execute_reentry == 0);
+
+	/* report the error of a batch in flight before the one of this queue */
+	int collected = jtag_worker_collect();
+
+	jtag_execute_reentry++;
+
+	jtag_command_queue = cmd_queue_commands(NULL);
+	int retval = default_interface_jtag_execute_queue();
+	if (retval == ERROR_OK)
+		retval = jtag_queue_results_run(&jtag_check_table, jtag_callback_queue_head);
+
+	jtag_command_queue_reset();
+	jtag_callback_queue_reset();
+	jtag_check_table_reset(&jtag_check_table);
+
+	jtag_execute_reentry--;
+
+	return (collected != ERROR_OK) ? collected : retval;
+}
+
+void interface_jtag_free_checks(void)
+{
+	free(jtag_check_table.checks);
+	jtag_check_table = (struct jtag_check_table){ 0 };
+	jtag_worker_free_checks();
+}
+
 static int jtag_convert_to_callback4(jtag_callback_data_t data0,
 		jtag_callback_data_t data1, jtag_callback_data_t data2, jtag_callback_data_t data3)
 {
@@ -116,6 +116,8 @@ static int dummy_init(void)
 
 static int dummy_quit(void)
 {
+	bitbang_quit();
+
 	return ERROR_OK;
 }
 
@@ -202,6 +202,7 @@ static int ep93xx_init(void)
 
 static int ep93xx_quit(void)
 {
+	bitbang_quit();
 
 	return ERROR_OK;
 }
@@ -565,5 +565,7 @@ static int imx_gpio_quit(void)
 	if (srst_gpio != -1)
 		gpio_mode_set(srst_gpio, srst_gpio_mode);
 
+	bitbang_quit();
+
 	return ERROR_OK;
 }
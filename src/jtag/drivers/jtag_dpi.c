@@ -16,6 +16,7 @@
 #endif
 
 #include <jtag/interface.h>
+#include "sim_ring.h"
 #ifdef HAVE_ARPA_INET_H
 #include <arpa/inet.h>
 #endif
@@ -33,9 +34,25 @@ static char *server_address;
 static int sockfd;
 static struct sockaddr_in serv_addr;
 
+/* shared memory ring used instead of the socket, if configured */
+static char *shm_name;
+static struct sim_ring *ring;
+
 static uint8_t *last_ir_buf;
 static int last_ir_num_bits;
 
+/* scan answer not read yet; cmd is NULL when the answer is dropped */
+struct jtag_dpi_reply {
+	struct scan_command *cmd;
+	uint8_t *buf;
+	int bytes;
+};
+
+static struct jtag_dpi_reply *replies;
+static unsigned int replies_count;
+static unsigned int replies_size;
+static size_t replies_bytes;
+
 static int write_sock(char *buf, size_t len)
 {
 	if (!buf) {
@@ -43,6 +60,8 @@ static int write_sock(char *buf, size_t len)
 			__func__, __FILE__, __LINE__);
 		return ERROR_FAIL;
 	}
+	if (ring)
+		return sim_ring_write(ring, buf, len);
 	if (write(sockfd, buf, len) != (ssize_t)len) {
 		LOG_ERROR("%s: %s, file %s, line %d", __func__,
 			strerror(errno), __FILE__, __LINE__);
@@ -58,6 +77,8 @@ static int read_sock(char *buf, size_t len)
 			__func__, __FILE__, __LINE__);
 		return ERROR_FAIL;
 	}
+	if (ring)
+		return sim_ring_read(ring, buf, len);
 	if (read(sockfd, buf, len) != (ssize_t)len) {
 		LOG_ERROR("%s: %s, file %s, line %d", __func__,
 			strerror(errno), __FILE__, __LINE__);
@@ -66,6 +87,94 @@ static int read_sock(char *buf, size_t len)
 	return ERROR_OK;
 }
 
+/**
+ * jtag_dpi_read_replies - read the answers of the scans sent so far
+ *
+ * The answers are handed to their scan command, in order. After a scan
+ * check failure the remaining answers are still read, to keep the stream
+ * in sync.
+ */
+static int jtag_dpi_read_replies(void)
+{
+	int ret = ERROR_OK;
+	bool stream_ok = true;
+
+	for (unsigned int i = 0; i < replies_count; i++) {
+		struct jtag_dpi_reply *reply = &replies[i];
+
+		if (stream_ok) {
+			int retval = read_sock((char *)reply->buf, reply->bytes);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("read_sock() fail, file %s, line %d",
+					__FILE__, __LINE__);
+				stream_ok = false;
+				ret = retval;
+			} else if (reply->cmd) {
+				retval = jtag_read_buffer(reply->buf, reply->cmd);
+				if (retval != ERROR_OK && ret == ERROR_OK)
+					ret = retval;
+			}
+		}
+		free(reply->buf);
+	}
+
+	replies_count = 0;
+	replies_bytes = 0;
+	return ret;
+}
+
+/**
+ * jtag_dpi_reserve_reply - make room for the answer of the next scan
+ * @param bytes size of the answer
+ *
+ * Over the shared memory ring the scans are pipelined, as long as all
+ * pending answers fit in the ring; the simulator then never blocks on a
+ * full ring while OpenOCD is still writing. Over the socket each answer
+ * is read right after its scan.
+ */
+static int jtag_dpi_reserve_reply(int bytes)
+{
+	if (replies_count && (!ring || replies_bytes + bytes > sim_ring_size(ring)))
+		return jtag_dpi_read_replies();
+
+	return ERROR_OK;
+}
+
+/**
+ * jtag_dpi_queue_reply - record the answer expected for a scan just sent
+ * @param cmd scan command to hand the answer to, NULL to drop it
+ * @param buf buffer for the answer, freed once it is read
+ * @param bytes size of the answer
+ */
+static int jtag_dpi_queue_reply(struct scan_command *cmd, uint8_t *buf, int bytes)
+{
+	if (replies_count == replies_size) {
+		unsigned int new_size = replies_size ? 2 * replies_size : 64;
+		struct jtag_dpi_reply *new_replies = realloc(replies,
+				new_size * sizeof(*new_replies));
+		if (!new_replies) {
+			LOG_ERROR("%s: realloc fail, file %s, line %d",
+				__func__, __FILE__, __LINE__);
+			free(buf);
+			return ERROR_FAIL;
+		}
+		replies = new_replies;
+		replies_size = new_size;
+	}
+
+	replies[replies_count++] = (struct jtag_dpi_reply) {
+		.cmd = cmd,
+		.buf = buf,
+		.bytes = bytes,
+	};
+	replies_bytes += bytes;
+
+	if (!ring)
+		return jtag_dpi_read_replies();
+
+	return ERROR_OK;
+}
+
 /**
  * jtag_dpi_reset - ask to reset the JTAG device
  * @param trst 1 if TRST is to be asserted
@@ -84,6 +193,8 @@ static int jtag_dpi_reset(int trst, int srst)
 		if (ret != ERROR_OK) {
 			LOG_ERROR("write_sock() fail, file %s, line %d",
 				__FILE__, __LINE__);
+		} else if (ring) {
+			ret = sim_ring_flush(ring);
 		}
 	}
 
@@ -119,6 +230,10 @@ static int jtag_dpi_scan(struct scan_command *cmd)
 	}
 
 	bytes = DIV_ROUND_UP(num_bits, 8);
+	ret = jtag_dpi_reserve_reply(bytes);
+	if (ret != ERROR_OK)
+		goto out;
+
 	if (cmd->ir_scan) {
 		free(last_ir_buf);
 		last_ir_buf = (uint8_t *)malloc(bytes * sizeof(uint8_t));
@@ -144,19 +259,9 @@ static int jtag_dpi_scan(struct scan_command *cmd)
 			__FILE__, __LINE__);
 		goto out;
 	}
-	ret = read_sock((char *)data_buf, bytes);
-	if (ret != ERROR_OK) {
-		LOG_ERROR("read_sock() fail, file %s, line %d",
-			__FILE__, __LINE__);
-		goto out;
-	}
 
-	ret = jtag_read_buffer(data_buf, cmd);
-	if (ret != ERROR_OK) {
-		LOG_ERROR("jtag_read_buffer() fail, file %s, line %d",
-			__FILE__, __LINE__);
-		goto out;
-	}
+	/* data_buf now belongs to the reply */
+	return jtag_dpi_queue_reply(cmd, data_buf, bytes);
 
 out:
 	free(data_buf);
@@ -182,38 +287,38 @@ static int jtag_dpi_runtest(int cycles)
 	}
 
 	bytes = DIV_ROUND_UP(num_bits, 8);
-	read_scan = (uint8_t *)malloc(bytes * sizeof(uint8_t));
-	if (!read_scan) {
-		LOG_ERROR("%s: malloc fail, file %s, line %d",
-			__func__, __FILE__, __LINE__);
-		return ERROR_FAIL;
-	}
 	snprintf(buf, sizeof(buf), "ib %d\n", num_bits);
 	while (cycles > 0) {
+		ret = jtag_dpi_reserve_reply(bytes);
+		if (ret != ERROR_OK)
+			return ret;
 		ret = write_sock(buf, strlen(buf));
 		if (ret != ERROR_OK) {
 			LOG_ERROR("write_sock() fail, file %s, line %d",
 				__FILE__, __LINE__);
-			goto out;
+			return ret;
 		}
 		ret = write_sock((char *)data_buf, bytes);
 		if (ret != ERROR_OK) {
 			LOG_ERROR("write_sock() fail, file %s, line %d",
 				__FILE__, __LINE__);
-			goto out;
+			return ret;
 		}
-		ret = read_sock((char *)read_scan, bytes);
-		if (ret != ERROR_OK) {
-			LOG_ERROR("read_sock() fail, file %s, line %d",
-				__FILE__, __LINE__);
-			goto out;
+
+		/* the answer is read and dropped */
+		read_scan = (uint8_t *)malloc(bytes * sizeof(uint8_t));
+		if (!read_scan) {
+			LOG_ERROR("%s: malloc fail, file %s, line %d",
+				__func__, __FILE__, __LINE__);
+			return ERROR_FAIL;
 		}
+		ret = jtag_dpi_queue_reply(NULL, read_scan, bytes);
+		if (ret != ERROR_OK)
+			return ret;
 
 		cycles -= num_bits + 6;
 	}
 
-out:
-	free(read_scan);
 	return ret;
 }
 
@@ -248,6 +353,7 @@ static int jtag_dpi_execute_queue(void)
 			/* unsupported */
 			break;
 		case JTAG_SLEEP:
+			ret = jtag_dpi_read_replies();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -261,11 +367,24 @@ static int jtag_dpi_execute_queue(void)
 		}
 	}
 
+	int retval = jtag_dpi_read_replies();
+	if (ret == ERROR_OK)
+		ret = retval;
+
 	return ret;
 }
 
 static int jtag_dpi_init(void)
 {
+	if (shm_name) {
+		ring = sim_ring_open(shm_name);
+		if (!ring)
+			return ERROR_FAIL;
+
+		LOG_INFO("Connection to shared memory ring %s succeed", shm_name);
+		return ERROR_OK;
+	}
+
 	sockfd = socket(AF_INET, SOCK_STREAM, 0);
 	if (sockfd < 0) {
 		LOG_ERROR("socket: %s, function %s, file %s, line %d",
@@ -317,6 +436,19 @@ static int jtag_dpi_quit(void)
 	free(server_address);
 	server_address = NULL;
 
+	free(replies);
+	replies = NULL;
+	replies_size = 0;
+
+	free(shm_name);
+	shm_name = NULL;
+
+	if (ring) {
+		sim_ring_close(ring);
+		ring = NULL;
+		return ERROR_OK;
+	}
+
 	return close(sockfd);
 }
 
@@ -362,6 +494,29 @@ COMMAND_HANDLER(jtag_dpi_set_address)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jtag_dpi_set_shm_ring)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	else if (CMD_ARGC == 0) {
+		if (shm_name)
+			LOG_INFO("Using shared memory ring %s", shm_name);
+		else
+			LOG_INFO("Using the TCP/IP socket");
+	} else {
+		free(shm_name);
+		shm_name = strdup(CMD_ARGV[0]);
+		if (!shm_name) {
+			LOG_ERROR("%s: strdup fail, file %s, line %d",
+				__func__, __FILE__, __LINE__);
+			return ERROR_FAIL;
+		}
+		LOG_INFO("Set shared memory ring to %s", shm_name);
+	}
+
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_dpi_subcommand_handlers[] = {
 	{
 		.name = "set_port",
@@ -377,6 +532,13 @@ static const struct command_registration jtag_dpi_subcommand_handlers[] = {
 		.help = "set the address of the DPI server",
 		.usage = "[address]",
 	},
+	{
+		.name = "set_shm_ring",
+		.handler = &jtag_dpi_set_shm_ring,
+		.mode = COMMAND_CONFIG,
+		.help = "use a shared memory ring instead of the TCP/IP socket",
+		.usage = "[name]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
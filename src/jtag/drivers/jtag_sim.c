@@ -0,0 +1,653 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * JTAG driver for simulated targets, working at the scan level.
+ *
+ * Every execute_queue() is turned into a single request message holding
+ * whole scans, TMS sequences and clock runs, and the simulator answers with
+ * a single reply carrying the captured TDO bits of all scans. There is no
+ * round trip per scan or per chunk of scan, so throughput is bound by the
+ * simulation itself. The protocol is described in
+ * doc/manual/jtag/drivers/jtag_sim.txt.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _WIN32
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#endif
+#include "helper/system.h"
+#include "helper/replacements.h"
+#include <helper/time_support.h>
+#include <jtag/interface.h>
+#include <jtag/commands.h>
+
+#define JTAG_SIM_MAGIC			0x4d49534a	/* "JSIM" */
+#define JTAG_SIM_HEADER_SIZE	8
+#define JTAG_SIM_RECORD_SIZE	8
+
+/* requests are sent early once they grow past this size */
+#define JTAG_SIM_FLUSH_SIZE		(1024 * 1024)
+
+#define JTAG_SIM_OP_TMS			1
+#define JTAG_SIM_OP_SHIFT		2
+#define JTAG_SIM_OP_CLOCKS		3
+#define JTAG_SIM_OP_RESET		4
+#define JTAG_SIM_OP_STOP		5
+
+/* JTAG_SIM_OP_SHIFT flags */
+#define JTAG_SIM_SHIFT_TDI		0x1
+#define JTAG_SIM_SHIFT_TDO		0x2
+#define JTAG_SIM_SHIFT_EXIT		0x4
+
+/* JTAG_SIM_OP_CLOCKS flags */
+#define JTAG_SIM_CLOCKS_TMS		0x1
+
+/* JTAG_SIM_OP_RESET flags */
+#define JTAG_SIM_RESET_TRST		0x1
+#define JTAG_SIM_RESET_SRST		0x2
+
+/* scan waiting for the reply of the request it was sent in */
+struct jtag_sim_capture {
+	struct scan_command *cmd;
+	uint8_t *buffer;
+	unsigned int num_bits;
+};
+
+static char *jtag_sim_host;
+static char *jtag_sim_port;
+static bool jtag_sim_stop_on_exit;
+
+static int jtag_sim_fd = -1;
+
+static uint8_t *jtag_sim_req;
+static size_t jtag_sim_req_len;
+static size_t jtag_sim_req_size;
+
+static uint8_t *jtag_sim_reply;
+static size_t jtag_sim_reply_size;
+
+static struct jtag_sim_capture *jtag_sim_captures;
+static unsigned int jtag_sim_capture_count;
+static unsigned int jtag_sim_capture_size;
+/* sum of the TDO bytes expected for the request being built */
+static size_t jtag_sim_reply_len;
+
+static int jtag_sim_write(const uint8_t *buf, size_t size)
+{
+	while (size) {
+		ssize_t written = write_socket(jtag_sim_fd, buf, size);
+		if (written < 0) {
+			log_socket_error("jtag_sim");
+			return ERROR_FAIL;
+		}
+		buf += written;
+		size -= written;
+	}
+	return ERROR_OK;
+}
+
+static int jtag_sim_read(uint8_t *buf, size_t size)
+{
+	while (size) {
+		ssize_t count = read_socket(jtag_sim_fd, buf, size);
+		if (count == 0) {
+			LOG_ERROR("jtag_sim: connection closed by the simulator");
+			return ERROR_FAIL;
+		}
+		if (count < 0) {
+			log_socket_error("jtag_sim");
+			return ERROR_FAIL;
+		}
+		buf += count;
+		size -= count;
+	}
+	return ERROR_OK;
+}
+
+static void jtag_sim_req_start(void)
+{
+	jtag_sim_req_len = JTAG_SIM_HEADER_SIZE;
+	jtag_sim_reply_len = 0;
+	jtag_sim_capture_count = 0;
+}
+
+static uint8_t *jtag_sim_req_reserve(size_t size)
+{
+	if (jtag_sim_req_len + size > jtag_sim_req_size) {
+		size_t new_size = MAX(2 * jtag_sim_req_size, jtag_sim_req_len + size);
+		uint8_t *req = realloc(jtag_sim_req, new_size);
+		if (!req) {
+			LOG_ERROR("jtag_sim: out of memory");
+			return NULL;
+		}
+		jtag_sim_req = req;
+		jtag_sim_req_size = new_size;
+	}
+
+	uint8_t *p = jtag_sim_req + jtag_sim_req_len;
+	jtag_sim_req_len += size;
+	return p;
+}
+
+/**
+ * Append one record to the request.
+ * @param op The JTAG_SIM_OP_* code.
+ * @param flags The record flags, specific to @a op.
+ * @param num_bits The bit or clock count of the record.
+ * @param payload Packed bits to append after the record header, or NULL.
+ * @param payload_bits The number of bits in @a payload.
+ */
+static int jtag_sim_add_record(uint8_t op, uint8_t flags, uint32_t num_bits,
+		const uint8_t *payload, unsigned int payload_bits)
+{
+	size_t payload_size = payload ? DIV_ROUND_UP(payload_bits, 8) : 0;
+	uint8_t *p = jtag_sim_req_reserve(JTAG_SIM_RECORD_SIZE + payload_size);
+	if (!p)
+		return ERROR_FAIL;
+
+	p[0] = op;
+	p[1] = flags;
+	h_u16_to_le(p + 2, 0);
+	h_u32_to_le(p + 4, num_bits);
+	if (payload_size)
+		memcpy(p + JTAG_SIM_RECORD_SIZE, payload, payload_size);
+
+	return ERROR_OK;
+}
+
+/**
+ * Send the request built so far, wait for the reply and hand the captured
+ * TDO bits over to their scan commands. The next request is started.
+ */
+static int jtag_sim_flush(void)
+{
+	int retval = ERROR_OK;
+
+	if (jtag_sim_req_len == JTAG_SIM_HEADER_SIZE)
+		return ERROR_OK;
+
+	h_u32_to_le(jtag_sim_req, JTAG_SIM_MAGIC);
+	h_u32_to_le(jtag_sim_req + 4, jtag_sim_req_len - JTAG_SIM_HEADER_SIZE);
+
+	retval = jtag_sim_write(jtag_sim_req, jtag_sim_req_len);
+	if (retval != ERROR_OK)
+		goto out;
+
+	uint8_t header[JTAG_SIM_HEADER_SIZE];
+	retval = jtag_sim_read(header, sizeof(header));
+	if (retval != ERROR_OK)
+		goto out;
+
+	if (le_to_h_u32(header) != JTAG_SIM_MAGIC ||
+			le_to_h_u32(header + 4) != jtag_sim_reply_len) {
+		LOG_ERROR("jtag_sim: malformed reply (magic 0x%08" PRIx32 ", %" PRIu32
+				" bytes, %zu expected)", le_to_h_u32(header),
+				le_to_h_u32(header + 4), jtag_sim_reply_len);
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	if (jtag_sim_reply_len > jtag_sim_reply_size) {
+		uint8_t *reply = realloc(jtag_sim_reply, jtag_sim_reply_len);
+		if (!reply) {
+			LOG_ERROR("jtag_sim: out of memory");
+			retval = ERROR_FAIL;
+			goto out;
+		}
+		jtag_sim_reply = reply;
+		jtag_sim_reply_size = jtag_sim_reply_len;
+	}
+
+	retval = jtag_sim_read(jtag_sim_reply, jtag_sim_reply_len);
+	if (retval != ERROR_OK)
+		goto out;
+
+	const uint8_t *tdo = jtag_sim_reply;
+	for (unsigned int i = 0; i < jtag_sim_capture_count; i++) {
+		struct jtag_sim_capture *capture = &jtag_sim_captures[i];
+		size_t size = DIV_ROUND_UP(capture->num_bits, 8);
+
+		memcpy(capture->buffer, tdo, size);
+		tdo += size;
+
+		int retval2 = jtag_read_buffer(capture->buffer, capture->cmd);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+out:
+	for (unsigned int i = 0; i < jtag_sim_capture_count; i++)
+		free(jtag_sim_captures[i].buffer);
+	jtag_sim_req_start();
+	return retval;
+}
+
+static int jtag_sim_tms_seq(const uint8_t *bits, unsigned int num_bits)
+{
+	return jtag_sim_add_record(JTAG_SIM_OP_TMS, 0, num_bits, bits, num_bits);
+}
+
+static int jtag_sim_state_move(tap_state_t state)
+{
+	if (tap_get_state() == state)
+		return ERROR_OK;
+
+	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), state);
+	int tms_len = tap_get_tms_path_len(tap_get_state(), state);
+
+	int retval = jtag_sim_tms_seq(&tms_scan, tms_len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	tap_set_state(state);
+	return ERROR_OK;
+}
+
+static int jtag_sim_path_move(struct pathmove_command *cmd)
+{
+	uint8_t trans[DIV_ROUND_UP(cmd->num_states, 8)];
+
+	memset(trans, 0, sizeof(trans));
+
+	for (int i = 0; i < cmd->num_states; i++) {
+		if (tap_state_transition(tap_get_state(), true) == cmd->path[i])
+			buf_set_u32(trans, i, 1, 1);
+		tap_set_state(cmd->path[i]);
+	}
+
+	return jtag_sim_tms_seq(trans, cmd->num_states);
+}
+
+static int jtag_sim_clocks(unsigned int num_cycles, bool tms)
+{
+	if (!num_cycles)
+		return ERROR_OK;
+
+	return jtag_sim_add_record(JTAG_SIM_OP_CLOCKS, tms ? JTAG_SIM_CLOCKS_TMS : 0,
+			num_cycles, NULL, 0);
+}
+
+/*
+ * Clock TMS high whatever the tracked state, which can be wrong after a
+ * SRST also resetting the TAP: five clocks reach RESET from any state.
+ */
+static int jtag_sim_tlr_reset(tap_state_t end_state)
+{
+	int retval = jtag_sim_clocks(5, true);
+	if (retval != ERROR_OK)
+		return retval;
+
+	tap_set_state(TAP_RESET);
+	return jtag_sim_state_move(end_state);
+}
+
+static int jtag_sim_scan(struct scan_command *cmd)
+{
+	uint8_t *buf = NULL;
+	int scan_bits = jtag_build_buffer(cmd, &buf);
+	bool capture = jtag_scan_type(cmd) & SCAN_IN;
+	tap_state_t shift_state = cmd->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT;
+
+	int retval = jtag_sim_state_move(shift_state);
+	if (retval != ERROR_OK)
+		goto error;
+
+	uint8_t flags = JTAG_SIM_SHIFT_TDI;
+	if (capture)
+		flags |= JTAG_SIM_SHIFT_TDO;
+	if (cmd->end_state != shift_state)
+		flags |= JTAG_SIM_SHIFT_EXIT;
+
+	retval = jtag_sim_add_record(JTAG_SIM_OP_SHIFT, flags, scan_bits, buf, scan_bits);
+	if (retval != ERROR_OK)
+		goto error;
+
+	if (capture) {
+		if (jtag_sim_capture_count == jtag_sim_capture_size) {
+			unsigned int new_size = MAX(2 * jtag_sim_capture_size, 64);
+			struct jtag_sim_capture *captures = realloc(jtag_sim_captures,
+					new_size * sizeof(*captures));
+			if (!captures) {
+				LOG_ERROR("jtag_sim: out of memory");
+				retval = ERROR_FAIL;
+				goto error;
+			}
+			jtag_sim_captures = captures;
+			jtag_sim_capture_size = new_size;
+		}
+
+		jtag_sim_captures[jtag_sim_capture_count++] = (struct jtag_sim_capture) {
+			.cmd = cmd,
+			.buffer = buf,
+			.num_bits = scan_bits,
+		};
+		jtag_sim_reply_len += DIV_ROUND_UP(scan_bits, 8);
+	} else {
+		free(buf);
+	}
+
+	if (cmd->end_state != shift_state) {
+		/*
+		 * The shift left the TAP in IREXIT1 or DREXIT1, move it forward to
+		 * the stable IRPAUSE or DRPAUSE.
+		 */
+		retval = jtag_sim_clocks(1, false);
+		if (retval != ERROR_OK)
+			return retval;
+
+		tap_set_state(cmd->ir_scan ? TAP_IRPAUSE : TAP_DRPAUSE);
+		return jtag_sim_state_move(cmd->end_state);
+	}
+
+	return ERROR_OK;
+
+error:
+	free(buf);
+	return retval;
+}
+
+static int jtag_sim_runtest(unsigned int num_cycles, tap_state_t state)
+{
+	int retval = jtag_sim_state_move(TAP_IDLE);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_sim_clocks(num_cycles, false);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return jtag_sim_state_move(state);
+}
+
+static int jtag_sim_execute_queue(void)
+{
+	int retval = ERROR_OK;
+
+	jtag_sim_req_start();
+
+	for (struct jtag_command *cmd = jtag_command_queue; retval == ERROR_OK && cmd;
+			cmd = cmd->next) {
+		switch (cmd->type) {
+		case JTAG_RUNTEST:
+			retval = jtag_sim_runtest(cmd->cmd.runtest->num_cycles,
+					cmd->cmd.runtest->end_state);
+			break;
+		case JTAG_STABLECLOCKS:
+			/* TMS=1 in TAP RESET state, TMS=0 in all other stable states */
+			retval = jtag_sim_clocks(cmd->cmd.stableclocks->num_cycles,
+					tap_get_state() == TAP_RESET);
+			break;
+		case JTAG_TLR_RESET:
+			retval = jtag_sim_tlr_reset(cmd->cmd.statemove->end_state);
+			break;
+		case JTAG_PATHMOVE:
+			retval = jtag_sim_path_move(cmd->cmd.pathmove);
+			break;
+		case JTAG_TMS:
+			retval = jtag_sim_tms_seq(cmd->cmd.tms->bits, cmd->cmd.tms->num_bits);
+			break;
+		case JTAG_SLEEP:
+			/* the simulation has to catch up before the delay starts */
+			retval = jtag_sim_flush();
+			jtag_sleep(cmd->cmd.sleep->us);
+			break;
+		case JTAG_SCAN:
+			retval = jtag_sim_scan(cmd->cmd.scan);
+			break;
+		default:
+			LOG_ERROR("BUG: unknown JTAG command type 0x%X", cmd->type);
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		if (retval == ERROR_OK && jtag_sim_req_len >= JTAG_SIM_FLUSH_SIZE)
+			retval = jtag_sim_flush();
+	}
+
+	if (retval != ERROR_OK) {
+		/* drop the partial request, the simulator never sees it */
+		for (unsigned int i = 0; i < jtag_sim_capture_count; i++)
+			free(jtag_sim_captures[i].buffer);
+		jtag_sim_req_start();
+		return retval;
+	}
+
+	return jtag_sim_flush();
+}
+
+static int jtag_sim_reset(int trst, int srst)
+{
+	uint8_t flags = (trst ? JTAG_SIM_RESET_TRST : 0) |
+		(srst ? JTAG_SIM_RESET_SRST : 0);
+
+	jtag_sim_req_start();
+	int retval = jtag_sim_add_record(JTAG_SIM_OP_RESET, flags, 0, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return jtag_sim_flush();
+}
+
+static int jtag_sim_connect_tcp(void)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *result, *rp;
+	int fd = -1;
+
+	LOG_INFO("jtag_sim: connecting to %s:%s",
+			jtag_sim_host ? jtag_sim_host : "localhost", jtag_sim_port);
+
+	int s = getaddrinfo(jtag_sim_host, jtag_sim_port, &hints, &result);
+	if (s != 0) {
+		LOG_ERROR("jtag_sim: getaddrinfo: %s", gai_strerror(s));
+		return ERROR_FAIL;
+	}
+
+	for (rp = result; rp; rp = rp->ai_next) {
+		fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (fd == -1)
+			continue;
+
+		if (connect(fd, rp->ai_addr, rp->ai_addrlen) != -1)
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(result);
+
+	if (fd == -1) {
+		LOG_ERROR("jtag_sim: can't connect to %s:%s",
+				jtag_sim_host ? jtag_sim_host : "localhost", jtag_sim_port);
+		return ERROR_FAIL;
+	}
+
+	/* each request is written at once, and then waited for */
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+
+	return fd;
+}
+
+static int jtag_sim_connect_unix(void)
+{
+	if (!jtag_sim_host) {
+		LOG_ERROR("jtag_sim: neither a TCP port nor a unix socket is specified");
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("jtag_sim: connecting to unix socket %s", jtag_sim_host);
+	int fd = socket(PF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		log_socket_error("socket");
+		return ERROR_FAIL;
+	}
+
+	struct sockaddr_un addr;
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, jtag_sim_host, sizeof(addr.sun_path));
+	addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0) {
+		log_socket_error("connect");
+		close(fd);
+		return ERROR_FAIL;
+	}
+
+	return fd;
+}
+
+static int jtag_sim_init(void)
+{
+	if (jtag_sim_port)
+		jtag_sim_fd = jtag_sim_connect_tcp();
+	else
+		jtag_sim_fd = jtag_sim_connect_unix();
+
+	if (jtag_sim_fd < 0)
+		return ERROR_FAIL;
+
+	/* the TAP state is unknown, make sure the simulator knows it too */
+	tap_set_state(TAP_RESET);
+	jtag_sim_req_start();
+	uint8_t tms_reset = 0xff;
+	int retval = jtag_sim_tms_seq(&tms_reset, 8);
+	if (retval == ERROR_OK)
+		retval = jtag_sim_flush();
+	if (retval != ERROR_OK) {
+		LOG_ERROR("jtag_sim: the simulator does not answer");
+		close_socket(jtag_sim_fd);
+		jtag_sim_fd = -1;
+		return retval;
+	}
+
+	LOG_INFO("jtag_sim: connected");
+	return ERROR_OK;
+}
+
+static int jtag_sim_quit(void)
+{
+	if (jtag_sim_fd >= 0) {
+		if (jtag_sim_stop_on_exit) {
+			uint8_t stop[JTAG_SIM_HEADER_SIZE + JTAG_SIM_RECORD_SIZE] = { 0 };
+			h_u32_to_le(stop, JTAG_SIM_MAGIC);
+			h_u32_to_le(stop + 4, JTAG_SIM_RECORD_SIZE);
+			stop[JTAG_SIM_HEADER_SIZE] = JTAG_SIM_OP_STOP;
+			/* the simulator is not expected to reply */
+			if (jtag_sim_write(stop, sizeof(stop)) != ERROR_OK)
+				LOG_WARNING("jtag_sim: failed to send the stop request");
+		}
+		close_socket(jtag_sim_fd);
+		jtag_sim_fd = -1;
+	}
+
+	free(jtag_sim_req);
+	jtag_sim_req = NULL;
+	jtag_sim_req_size = 0;
+	free(jtag_sim_reply);
+	jtag_sim_reply = NULL;
+	jtag_sim_reply_size = 0;
+	free(jtag_sim_captures);
+	jtag_sim_captures = NULL;
+	jtag_sim_capture_size = 0;
+
+	free(jtag_sim_host);
+	jtag_sim_host = NULL;
+	free(jtag_sim_port);
+	jtag_sim_port = NULL;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(jtag_sim_handle_port_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint16_t port;
+	COMMAND_PARSE_NUMBER(u16, CMD_ARGV[0], port);
+	free(jtag_sim_port);
+	jtag_sim_port = port == 0 ? NULL : strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(jtag_sim_handle_host_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(jtag_sim_host);
+	jtag_sim_host = strdup(CMD_ARGV[0]);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(jtag_sim_handle_stop_sim_on_exit_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], jtag_sim_stop_on_exit);
+	return ERROR_OK;
+}
+
+static const struct command_registration jtag_sim_subcommand_handlers[] = {
+	{
+		.name = "port",
+		.handler = jtag_sim_handle_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the TCP port of the simulator. "
+			"0 selects a unix socket named by 'host'.",
+		.usage = "port_number",
+	},
+	{
+		.name = "host",
+		.handler = jtag_sim_handle_host_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the host name of the simulator, "
+			"or the unix socket path if no port is set.",
+		.usage = "host_name",
+	},
+	{
+		.name = "stop_sim_on_exit",
+		.handler = jtag_sim_handle_stop_sim_on_exit_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Configure if the simulation is stopped "
+			"when OpenOCD exits (default: off)",
+		.usage = "(on|off)",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration jtag_sim_command_handlers[] = {
+	{
+		.name = "jtag_sim",
+		.mode = COMMAND_ANY,
+		.help = "perform jtag_sim management",
+		.chain = jtag_sim_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static struct jtag_interface jtag_sim_interface = {
+	.supported = DEBUG_CAP_TMS_SEQ,
+	.execute_queue = jtag_sim_execute_queue,
+};
+
+struct adapter_driver jtag_sim_adapter_driver = {
+	.name = "jtag_sim",
+	.transports = jtag_only,
+	.commands = jtag_sim_command_handlers,
+
+	.init = jtag_sim_init,
+	.quit = jtag_sim_quit,
+	.reset = jtag_sim_reset,
+
+	.jtag_ops = &jtag_sim_interface,
+};
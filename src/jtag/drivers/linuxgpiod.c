@@ -272,6 +272,8 @@ static int linuxgpiod_quit(void)
 	for (int i = 0; i < ADAPTER_GPIO_IDX_NUM; ++i)
 		helper_release(i);
 
+	bitbang_quit();
+
 	return ERROR_OK;
 }
 
@@ -52,6 +52,29 @@
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+/* Number of batches of commands that can be in flight at the same time. While
+ * the chip executes a batch and returns its data, the next one is built and
+ * its write transfer is already queued behind it. */
+#define MPSSE_BATCHES 2
+
+struct mpsse_ctx;
+
+/* A batch of commands handed to the chip, with the data it returns */
+struct mpsse_batch {
+	struct mpsse_ctx *ctx;
+	uint8_t *write_buffer;
+	unsigned int write_count;
+	unsigned int write_transferred;
+	bool write_started;
+	bool write_done;
+	uint8_t *read_buffer;
+	unsigned int read_count;
+	unsigned int read_transferred;
+	/* copies from read_buffer to the caller's buffers, run on completion */
+	struct bit_copy_queue read_queue;
+	struct libusb_transfer *write_transfer;
+};
+
 struct mpsse_ctx {
 	struct libusb_context *usb_ctx;
 	struct libusb_device_handle *usb_dev;
@@ -72,9 +95,19 @@ struct mpsse_ctx {
 	uint8_t *read_chunk;
 	unsigned read_chunk_size;
 	struct bit_copy_queue read_queue;
+	/* batches in flight, oldest first, in a ring of MPSSE_BATCHES */
+	struct mpsse_batch batches[MPSSE_BATCHES];
+	unsigned int batch_first;
+	unsigned int batch_count;
+	/* the bulk IN transfer, shared by the batches in flight */
+	struct libusb_transfer *read_transfer;
+	bool read_active;
 	int retval;
 };
 
+static int mpsse_submit(struct mpsse_ctx *ctx);
+static void mpsse_cancel_batches(struct mpsse_ctx *ctx);
+
 /* Returns true if the string descriptor indexed by str_index in device matches string */
 static bool string_descriptor_equal(struct libusb_device_handle *device, uint8_t str_index,
 	const char *string)
@@ -331,6 +364,23 @@ struct mpsse_ctx *mpsse_open(const uint16_t vids[], const uint16_t pids[], const
 	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer)
 		goto error;
 
+	/* The batches swap their buffers with the ones being filled on submit */
+	for (unsigned int i = 0; i < MPSSE_BATCHES; i++) {
+		struct mpsse_batch *batch = &ctx->batches[i];
+
+		batch->ctx = ctx;
+		bit_copy_queue_init(&batch->read_queue);
+		batch->read_buffer = malloc(ctx->read_size);
+		batch->write_buffer = calloc(1, ctx->write_size);
+		batch->write_transfer = libusb_alloc_transfer(0);
+		if (!batch->read_buffer || !batch->write_buffer || !batch->write_transfer)
+			goto error;
+	}
+
+	ctx->read_transfer = libusb_alloc_transfer(0);
+	if (!ctx->read_transfer)
+		goto error;
+
 	ctx->interface = channel;
 	ctx->index = channel + 1;
 	ctx->usb_read_timeout = 5000;
@@ -383,11 +433,22 @@ error:
 
 void mpsse_close(struct mpsse_ctx *ctx)
 {
-	if (ctx->usb_dev)
+	if (ctx->usb_dev) {
+		mpsse_cancel_batches(ctx);
 		libusb_close(ctx->usb_dev);
+	}
+	for (unsigned int i = 0; i < MPSSE_BATCHES; i++) {
+		struct mpsse_batch *batch = &ctx->batches[i];
+
+		libusb_free_transfer(batch->write_transfer);
+		bit_copy_queue_free(&batch->read_queue);
+		free(batch->write_buffer);
+		free(batch->read_buffer);
+	}
+	libusb_free_transfer(ctx->read_transfer);
 	if (ctx->usb_ctx)
 		libusb_exit(ctx->usb_ctx);
-	bit_copy_discard(&ctx->read_queue);
+	bit_copy_queue_free(&ctx->read_queue);
 
 	free(ctx->write_buffer);
 	free(ctx->read_buffer);
@@ -404,6 +465,7 @@ void mpsse_purge(struct mpsse_ctx *ctx)
 {
 	int err;
 	LOG_DEBUG("-");
+	mpsse_cancel_batches(ctx);
 	ctx->write_count = 0;
 	ctx->read_count = 0;
 	ctx->retval = ERROR_OK;
@@ -495,7 +557,7 @@ void mpsse_clock_data(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_of
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) + (length < 8) < (out || (!out && !in) ? 4 : 3)
 				|| (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_submit(ctx);
 
 		if (length < 8) {
 			/* Transfer remaining bits in bit mode */
@@ -569,7 +631,7 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	while (length > 0) {
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) < 3 || (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_submit(ctx);
 
 		/* Byte transfer */
 		unsigned this_bits = length;
@@ -612,7 +674,7 @@ void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t d
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x80);
 	buffer_write_byte(ctx, data);
@@ -629,7 +691,7 @@ void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x82);
 	buffer_write_byte(ctx, data);
@@ -646,7 +708,7 @@ void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x81);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -662,7 +724,7 @@ void mpsse_read_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x83);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -677,7 +739,7 @@ static void single_byte_boolean_helper(struct mpsse_ctx *ctx, bool var, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, var ? val_if_true : val_if_false);
 }
@@ -698,7 +760,7 @@ void mpsse_set_divisor(struct mpsse_ctx *ctx, uint16_t divisor)
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_submit(ctx);
 
 	buffer_write_byte(ctx, 0x86);
 	buffer_write_byte(ctx, divisor & 0xff);
@@ -758,121 +820,169 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned transferred;
-};
+static struct mpsse_batch *mpsse_batch_in_flight(struct mpsse_ctx *ctx, unsigned int n)
+{
+	return &ctx->batches[(ctx->batch_first + n) % MPSSE_BATCHES];
+}
+
+/* Returns the oldest batch in flight still waiting for read data, or NULL */
+static struct mpsse_batch *mpsse_reading_batch(struct mpsse_ctx *ctx)
+{
+	for (unsigned int i = 0; i < ctx->batch_count; i++) {
+		struct mpsse_batch *batch = mpsse_batch_in_flight(ctx, i);
+		if (batch->read_transferred < batch->read_count)
+			return batch;
+	}
+	return NULL;
+}
+
+static bool mpsse_transfers_active(struct mpsse_ctx *ctx)
+{
+	if (ctx->read_active)
+		return true;
+	for (unsigned int i = 0; i < ctx->batch_count; i++)
+		if (!mpsse_batch_in_flight(ctx, i)->write_done)
+			return true;
+	return false;
+}
 
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_ctx *ctx = transfer->user_data;
 
 	unsigned packet_size = ctx->max_packet_size;
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
 	/* Strip the two status bytes sent at the beginning of each USB packet
-	 * while copying the chunk buffer to the read buffer */
+	 * while copying the chunk buffer to the read buffers of the batches in
+	 * flight, in order. A chunk can hold the end of the data of a batch and
+	 * the start of the data of the next one. */
 	unsigned num_packets = DIV_ROUND_UP(transfer->actual_length, packet_size);
 	unsigned chunk_remains = transfer->actual_length;
 	for (unsigned i = 0; i < num_packets && chunk_remains > 2; i++) {
 		unsigned this_size = packet_size - 2;
 		if (this_size > chunk_remains - 2)
 			this_size = chunk_remains - 2;
-		if (this_size > ctx->read_count - res->transferred)
-			this_size = ctx->read_count - res->transferred;
-		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
-			this_size);
-		res->transferred += this_size;
 		chunk_remains -= this_size + 2;
-		if (res->transferred == ctx->read_count) {
-			res->done = true;
-			break;
+
+		const uint8_t *data = ctx->read_chunk + packet_size * i + 2;
+		while (this_size > 0) {
+			struct mpsse_batch *batch = mpsse_reading_batch(ctx);
+			if (!batch) {
+				LOG_DEBUG_IO("dropping %d unexpected bytes", this_size);
+				break;
+			}
+			unsigned int n = MIN(this_size, batch->read_count - batch->read_transferred);
+			memcpy(batch->read_buffer + batch->read_transferred, data, n);
+			batch->read_transferred += n;
+			data += n;
+			this_size -= n;
 		}
 	}
 
-	LOG_DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
-		ctx->read_count);
+	LOG_DEBUG_IO("raw chunk %d", transfer->actual_length);
 
-	if (!res->done)
-		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+	ctx->read_active = false;
+	if (transfer->status != LIBUSB_TRANSFER_CANCELLED && mpsse_reading_batch(ctx))
+		ctx->read_active = libusb_submit_transfer(transfer) == LIBUSB_SUCCESS;
+}
+
+static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer);
+
+/* The write transfers are submitted one at a time, so that resubmitting the
+ * remainder of a short write cannot reorder the command stream */
+static void mpsse_start_write(struct mpsse_batch *batch)
+{
+	struct mpsse_ctx *ctx = batch->ctx;
+
+	libusb_fill_bulk_transfer(batch->write_transfer, ctx->usb_dev, ctx->out_ep, batch->write_buffer,
+		batch->write_count, write_cb, batch, ctx->usb_write_timeout);
+	int retval = libusb_submit_transfer(batch->write_transfer);
+	if (retval != LIBUSB_SUCCESS) {
+		LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+		batch->write_done = true;
+	}
+	batch->write_started = true;
 }
 
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_batch *batch = transfer->user_data;
 
-	res->transferred += transfer->actual_length;
+	batch->write_transferred += transfer->actual_length;
 
-	LOG_DEBUG_IO("transferred %d of %d", res->transferred, ctx->write_count);
+	LOG_DEBUG_IO("transferred %d of %d", batch->write_transferred, batch->write_count);
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
-	if (res->transferred == ctx->write_count)
-		res->done = true;
-	else {
-		transfer->length = ctx->write_count - res->transferred;
-		transfer->buffer = ctx->write_buffer + res->transferred;
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+		batch->write_done = true;
+	} else if (batch->write_transferred == batch->write_count) {
+		batch->write_done = true;
+
+		/* Send the next batch while the chip executes this one */
+		struct mpsse_ctx *ctx = batch->ctx;
+		for (unsigned int i = 0; i < ctx->batch_count; i++) {
+			struct mpsse_batch *next = mpsse_batch_in_flight(ctx, i);
+			if (!next->write_started) {
+				mpsse_start_write(next);
+				break;
+			}
+		}
+	} else {
+		transfer->length = batch->write_count - batch->write_transferred;
+		transfer->buffer = batch->write_buffer + batch->write_transferred;
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+			batch->write_done = true;
 	}
 }
 
-int mpsse_flush(struct mpsse_ctx *ctx)
+/* Cancel the transfers of the batches in flight and forget about them */
+static void mpsse_cancel_batches(struct mpsse_ctx *ctx)
 {
-	int retval = ctx->retval;
+	if (!ctx->batch_count && !ctx->read_active)
+		return;
 
-	if (retval != ERROR_OK) {
-		LOG_DEBUG_IO("Ignoring flush due to previous error");
-		assert(ctx->write_count == 0 && ctx->read_count == 0);
-		ctx->retval = ERROR_OK;
-		return retval;
+	LOG_DEBUG("dropping %d batches in flight", ctx->batch_count);
+
+	for (unsigned int i = 0; i < ctx->batch_count; i++) {
+		struct mpsse_batch *batch = mpsse_batch_in_flight(ctx, i);
+		if (!batch->write_started)
+			batch->write_done = true;
+		else if (!batch->write_done)
+			libusb_cancel_transfer(batch->write_transfer);
 	}
+	if (ctx->read_active)
+		libusb_cancel_transfer(ctx->read_transfer);
 
-	LOG_DEBUG_IO("write %d%s, read %d", ctx->write_count, ctx->read_count ? "+1" : "",
-			ctx->read_count);
-	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
+	while (mpsse_transfers_active(ctx)) {
+		struct timeval timeout_usb = { .tv_sec = 1, .tv_usec = 0 };
+		if (libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL) != LIBUSB_SUCCESS)
+			break;
+	}
 
-	if (ctx->write_count == 0)
-		return retval;
+	for (unsigned int i = 0; i < ctx->batch_count; i++)
+		bit_copy_discard(&mpsse_batch_in_flight(ctx, i)->read_queue);
+	ctx->batch_first = 0;
+	ctx->batch_count = 0;
+}
 
-	struct libusb_transfer *read_transfer = NULL;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
-	if (ctx->read_count) {
-		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
-		/* delay read transaction to ensure the FTDI chip can support us with data
-		   immediately after processing the MPSSE commands in the write transaction */
-	}
-
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
-	if (retval != LIBUSB_SUCCESS)
-		goto error_check;
-
-	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
-			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
-		if (retval != LIBUSB_SUCCESS)
-			goto error_check;
-	}
+/* Wait for the oldest batch in flight to complete and hand its read data to
+ * the caller's buffers. On error, all batches are dropped and the chip purged. */
+static int mpsse_complete_batch(struct mpsse_ctx *ctx)
+{
+	struct mpsse_batch *batch = mpsse_batch_in_flight(ctx, 0);
+	int retval = LIBUSB_SUCCESS;
+
+	assert(ctx->batch_count > 0);
 
 	/* Polling loop, more or less taken from libftdi */
 	int64_t start = timeval_ms();
 	int64_t warn_after = 2000;
-	while (!write_result.done || !read_result.done) {
+	while (!batch->write_done
+			|| (batch->write_transferred == batch->write_count
+				&& batch->read_transferred < batch->read_count && ctx->read_active)) {
 		struct timeval timeout_usb;
 
 		timeout_usb.tv_sec = 1;
@@ -880,21 +990,9 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 
 		retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
 		keep_alive();
-		if (retval == LIBUSB_ERROR_NO_DEVICE || retval == LIBUSB_ERROR_INTERRUPTED)
+		if (retval != LIBUSB_SUCCESS)
 			break;
 
-		if (retval != LIBUSB_SUCCESS) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
-			while (!write_result.done || !read_result.done) {
-				retval = libusb_handle_events_timeout_completed(ctx->usb_ctx,
-								&timeout_usb, NULL);
-				if (retval != LIBUSB_SUCCESS)
-					break;
-			}
-		}
-
 		int64_t now = timeval_ms();
 		if (now - start > warn_after) {
 			LOG_WARNING("Haven't made progress in mpsse_flush() for %" PRId64
@@ -903,37 +1001,116 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 		}
 	}
 
-error_check:
 	if (retval != LIBUSB_SUCCESS) {
 		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
 		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
+	} else if (batch->write_transferred < batch->write_count) {
 		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
-			ctx->write_count);
+			batch->write_transferred,
+			batch->write_count);
 		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
+	} else if (batch->read_transferred < batch->read_count) {
 		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
-			ctx->read_count);
+			batch->read_transferred,
+			batch->read_count);
 		retval = ERROR_FAIL;
-	} else if (ctx->read_count) {
-		ctx->write_count = 0;
-		ctx->read_count = 0;
-		bit_copy_execute(&ctx->read_queue);
-		retval = ERROR_OK;
 	} else {
-		ctx->write_count = 0;
-		bit_copy_discard(&ctx->read_queue);
+		bit_copy_execute(&batch->read_queue);
 		retval = ERROR_OK;
 	}
 
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
 		mpsse_purge(ctx);
+		return retval;
+	}
+
+	ctx->batch_first = (ctx->batch_first + 1) % MPSSE_BATCHES;
+	ctx->batch_count--;
+	return ERROR_OK;
+}
+
+/* Hand the commands queued so far to the chip as a new batch, without waiting
+ * for it. The oldest batch is completed first if all of them are in flight. */
+static int mpsse_submit(struct mpsse_ctx *ctx)
+{
+	int retval;
+
+	LOG_DEBUG_IO("write %d%s, read %d", ctx->write_count, ctx->read_count ? "+1" : "",
+			ctx->read_count);
+	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
+
+	if (ctx->write_count == 0)
+		return ERROR_OK;
+
+	if (ctx->batch_count == MPSSE_BATCHES) {
+		retval = mpsse_complete_batch(ctx);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (ctx->read_count)
+		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
+
+	/* The batch takes over the filled buffers and its read queue, whose
+	 * offsets point into them, and leaves its idle ones for the next batch */
+	struct mpsse_batch *batch = mpsse_batch_in_flight(ctx, ctx->batch_count);
+	uint8_t *write_buffer = batch->write_buffer;
+	uint8_t *read_buffer = batch->read_buffer;
+	struct bit_copy_queue read_queue = batch->read_queue;
+
+	batch->write_buffer = ctx->write_buffer;
+	batch->write_count = ctx->write_count;
+	batch->write_transferred = 0;
+	batch->write_started = false;
+	batch->write_done = false;
+	batch->read_buffer = ctx->read_buffer;
+	batch->read_count = ctx->read_count;
+	batch->read_transferred = 0;
+	batch->read_queue = ctx->read_queue;
+	ctx->write_buffer = write_buffer;
+	ctx->write_count = 0;
+	ctx->read_buffer = read_buffer;
+	ctx->read_count = 0;
+	ctx->read_queue = read_queue;
+	ctx->batch_count++;
+
+	/* Otherwise, the write is started when the previous one completes */
+	if (ctx->batch_count == 1 || mpsse_batch_in_flight(ctx, ctx->batch_count - 2)->write_done)
+		mpsse_start_write(batch);
+
+	/* The read transfer is submitted after the write one, to ensure the FTDI
+	 * chip can support us with data immediately after processing the MPSSE
+	 * commands. When it is already running for a previous batch, it carries
+	 * on with the data of this one. */
+	if (batch->read_count && !ctx->read_active) {
+		libusb_fill_bulk_transfer(ctx->read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
+			ctx->read_chunk_size, read_cb, ctx, ctx->usb_read_timeout);
+		retval = libusb_submit_transfer(ctx->read_transfer);
+		if (retval != LIBUSB_SUCCESS) {
+			LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+			mpsse_purge(ctx);
+			return ERROR_FAIL;
+		}
+		ctx->read_active = true;
+	}
+
+	return ERROR_OK;
+}
+
+int mpsse_flush(struct mpsse_ctx *ctx)
+{
+	int retval = ctx->retval;
+
+	if (retval != ERROR_OK) {
+		LOG_DEBUG_IO("Ignoring flush due to previous error");
+		assert(ctx->write_count == 0 && ctx->read_count == 0);
+		ctx->retval = ERROR_OK;
+		return retval;
+	}
 
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
+	retval = mpsse_submit(ctx);
+	while (retval == ERROR_OK && ctx->batch_count > 0)
+		retval = mpsse_complete_batch(ctx);
 
 	return retval;
 }
@@ -374,6 +374,8 @@ static int parport_init(void)
 
 static int parport_quit(void)
 {
+	bitbang_quit();
+
 	if (parport_led(0) != ERROR_OK)
 		return ERROR_FAIL;
 
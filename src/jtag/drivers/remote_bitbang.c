@@ -22,8 +22,18 @@
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* bits clocked by a single protocol v2 'X' command, a multiple of 8 */
+#define REMOTE_BITBANG_SHIFT_MAX_BITS 4096
+
+/* flags of the protocol v2 'X' and 'Y' commands */
+#define REMOTE_BITBANG_SHIFT_TMS	0x1
+#define REMOTE_BITBANG_SHIFT_TDI	0x2
+#define REMOTE_BITBANG_SHIFT_TDO	0x4
+
 static char *remote_bitbang_host;
 static char *remote_bitbang_port;
+/* ask the remote process whether it speaks protocol v2 */
+static bool remote_bitbang_probe_v2 = true;
 
 static int remote_bitbang_fd;
 static uint8_t remote_bitbang_send_buf[512];
@@ -148,8 +158,53 @@ static int remote_bitbang_queue(int c, flush_bool_t flush)
 	return ERROR_OK;
 }
 
+static int remote_bitbang_queue_buf(const uint8_t *buf, unsigned int size)
+{
+	while (size) {
+		unsigned int n = MIN(size, ARRAY_SIZE(remote_bitbang_send_buf) -
+				remote_bitbang_send_buf_used);
+		memcpy(remote_bitbang_send_buf + remote_bitbang_send_buf_used, buf, n);
+		remote_bitbang_send_buf_used += n;
+		buf += n;
+		size -= n;
+		if (remote_bitbang_send_buf_used == ARRAY_SIZE(remote_bitbang_send_buf) &&
+				remote_bitbang_flush() != ERROR_OK)
+			return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+/* Wait for and consume size bytes of replies. */
+static int remote_bitbang_recv(uint8_t *buf, unsigned int size)
+{
+	while (size) {
+		if (remote_bitbang_recv_buf_empty()) {
+			if (remote_bitbang_fill_buf(BLOCK) != ERROR_OK)
+				return ERROR_FAIL;
+			if (remote_bitbang_recv_buf_empty()) {
+				LOG_ERROR("remote_bitbang: connection closed");
+				return ERROR_FAIL;
+			}
+			continue;
+		}
+
+		unsigned int end = remote_bitbang_recv_buf_end;
+		if (end < remote_bitbang_recv_buf_start)
+			end = sizeof(remote_bitbang_recv_buf);
+		unsigned int n = MIN(size, end - remote_bitbang_recv_buf_start);
+		memcpy(buf, remote_bitbang_recv_buf + remote_bitbang_recv_buf_start, n);
+		remote_bitbang_recv_buf_start =
+			(remote_bitbang_recv_buf_start + n) % sizeof(remote_bitbang_recv_buf);
+		buf += n;
+		size -= n;
+	}
+	return ERROR_OK;
+}
+
 static int remote_bitbang_quit(void)
 {
+	bitbang_quit();
+
 	if (remote_bitbang_queue('Q', FLUSH_SEND_BUF) == ERROR_FAIL)
 		return ERROR_FAIL;
 
@@ -220,6 +275,60 @@ static int remote_bitbang_blink(int on)
 	return remote_bitbang_queue(c, FLUSH_SEND_BUF);
 }
 
+/*
+ * Protocol v2: the bits are sent packed, in 'X' commands, or as a run of
+ * identical clocks in a 'Y' command, and TDO comes back packed as well.
+ */
+static int remote_bitbang_shift(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned int num_bits)
+{
+	if (!tms && !tdi && !tdo) {
+		uint8_t cmd[6] = { 'Y', 0 };
+		h_u32_to_le(cmd + 2, num_bits);
+		return remote_bitbang_queue_buf(cmd, sizeof(cmd));
+	}
+
+	while (num_bits) {
+		unsigned int n = MIN(num_bits, (unsigned int)REMOTE_BITBANG_SHIFT_MAX_BITS);
+		unsigned int nbytes = DIV_ROUND_UP(n, 8);
+		uint8_t cmd[4] = { 'X', 0 };
+
+		if (tms)
+			cmd[1] |= REMOTE_BITBANG_SHIFT_TMS;
+		if (tdi)
+			cmd[1] |= REMOTE_BITBANG_SHIFT_TDI;
+		if (tdo)
+			cmd[1] |= REMOTE_BITBANG_SHIFT_TDO;
+		h_u16_to_le(cmd + 2, n);
+
+		if (remote_bitbang_queue_buf(cmd, sizeof(cmd)) != ERROR_OK)
+			return ERROR_FAIL;
+		if (tms && remote_bitbang_queue_buf(tms, nbytes) != ERROR_OK)
+			return ERROR_FAIL;
+		if (tdi && remote_bitbang_queue_buf(tdi, nbytes) != ERROR_OK)
+			return ERROR_FAIL;
+
+		if (tdo) {
+			uint8_t last = tdo[nbytes - 1];
+			if (remote_bitbang_recv(tdo, nbytes) != ERROR_OK)
+				return ERROR_FAIL;
+			if (n % 8) {
+				uint8_t mask = 0xff >> (8 - n % 8);
+				tdo[nbytes - 1] = (last & ~mask) | (tdo[nbytes - 1] & mask);
+			}
+			tdo += nbytes;
+		}
+
+		if (tms)
+			tms += nbytes;
+		if (tdi)
+			tdi += nbytes;
+		num_bits -= n;
+	}
+
+	return ERROR_OK;
+}
+
 static struct bitbang_interface remote_bitbang_bitbang = {
 	.buf_size = sizeof(remote_bitbang_recv_buf) - 1,
 	.sample = &remote_bitbang_sample,
@@ -305,6 +414,41 @@ static int remote_bitbang_init_unix(void)
 	return fd;
 }
 
+/*
+ * Send a version query followed by a read request. A remote process which
+ * only knows the character protocol ignores the query, so the first reply
+ * is the value read.
+ */
+static int remote_bitbang_negotiate(void)
+{
+	remote_bitbang_bitbang.shift = NULL;
+
+	if (!remote_bitbang_probe_v2)
+		return ERROR_OK;
+
+	if (remote_bitbang_queue('V', NO_FLUSH) != ERROR_OK ||
+			remote_bitbang_queue('R', FLUSH_SEND_BUF) != ERROR_OK)
+		return ERROR_FAIL;
+
+	uint8_t reply[2];
+	if (remote_bitbang_recv(reply, 1) != ERROR_OK)
+		return ERROR_FAIL;
+	if (reply[0] != 'V')
+		return char_to_int(reply[0]) == BB_ERROR ? ERROR_FAIL : ERROR_OK;
+
+	/* version, then the value read */
+	if (remote_bitbang_recv(reply, 2) != ERROR_OK)
+		return ERROR_FAIL;
+	if (char_to_int(reply[1]) == BB_ERROR)
+		return ERROR_FAIL;
+
+	if (reply[0] >= '2') {
+		LOG_INFO("remote_bitbang: using protocol v2");
+		remote_bitbang_bitbang.shift = remote_bitbang_shift;
+	}
+	return ERROR_OK;
+}
+
 static int remote_bitbang_init(void)
 {
 	bitbang_interface = &remote_bitbang_bitbang;
@@ -323,6 +467,9 @@ static int remote_bitbang_init(void)
 
 	socket_nonblock(remote_bitbang_fd);
 
+	if (remote_bitbang_negotiate() != ERROR_OK)
+		return ERROR_FAIL;
+
 	LOG_INFO("remote_bitbang driver initialized");
 	return ERROR_OK;
 }
@@ -349,6 +496,15 @@ COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_host_command)
 	return ERROR_COMMAND_SYNTAX_ERROR;
 }
 
+COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_protocol_v2_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], remote_bitbang_probe_v2);
+	return ERROR_OK;
+}
+
 static const struct command_registration remote_bitbang_subcommand_handlers[] = {
 	{
 		.name = "port",
@@ -366,6 +522,13 @@ static const struct command_registration remote_bitbang_subcommand_handlers[] =
 			"  if port is 0 or unset, this is the name of the unix socket to use.",
 		.usage = "host_name",
 	},
+	{
+		.name = "protocol_v2",
+		.handler = remote_bitbang_handle_remote_bitbang_protocol_v2_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set whether the remote process is asked to use the binary protocol v2.",
+		.usage = "(on|off)",
+	},
 	COMMAND_REGISTRATION_DONE,
 };
 
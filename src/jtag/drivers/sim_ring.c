@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Shared memory ring transport to a simulator on the same host, see
+ * sim_ring.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sim_ring.h"
+#include <helper/log.h>
+#include <helper/replacements.h>
+#include <helper/types.h>
+
+#if defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_SYS_MMAN_H)
+#define SIM_RING_SUPPORTED
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/* polls of the peer's index before going to sleep on the futex */
+#define SIM_RING_SPIN			2000
+/* sleeps are cut in slices to notice a simulator which went away */
+#define SIM_RING_WAIT_SLICE_MS	100
+
+struct sim_ring {
+	struct sim_ring_shm *shm;
+	size_t map_size;
+	uint32_t mask;
+	struct sim_ring_ctl *tx;
+	struct sim_ring_ctl *rx;
+	uint8_t *tx_data;
+	uint8_t *rx_data;
+	/* end of the bytes staged for the simulator, not published yet */
+	uint32_t tx_head;
+};
+
+#ifdef SIM_RING_SUPPORTED
+
+static uint32_t sim_ring_load(uint32_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static void sim_ring_store(uint32_t *p, uint32_t value)
+{
+	__atomic_store_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+static void sim_ring_futex_wake(uint32_t *word)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Wake the peer sleeping on @a word, if it announced it sleeps. */
+static void sim_ring_wake(uint32_t *word, uint32_t *waiting)
+{
+	if (sim_ring_load(waiting))
+		sim_ring_futex_wake(word);
+}
+
+static bool sim_ring_sim_alive(struct sim_ring *ring)
+{
+	if (sim_ring_load(&ring->shm->closed) & SIM_RING_CLOSED_SIM)
+		return false;
+
+	pid_t pid = sim_ring_load(&ring->shm->sim_pid);
+	return !pid || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+/*
+ * Wait until the peer changes @a word away from @a old. The waiting flag is
+ * raised before the last check of @a word, and the peer tests it after
+ * updating @a word, so a wake up can't be missed.
+ */
+static int sim_ring_wait(struct sim_ring *ring, uint32_t *word, uint32_t *waiting,
+		uint32_t old)
+{
+	for (unsigned int i = 0; i < SIM_RING_SPIN; i++)
+		if (sim_ring_load(word) != old)
+			return ERROR_OK;
+
+	int retval = ERROR_OK;
+	const struct timespec slice = {
+		.tv_sec = 0,
+		.tv_nsec = SIM_RING_WAIT_SLICE_MS * 1000000L,
+	};
+
+	sim_ring_store(waiting, 1);
+	while (sim_ring_load(word) == old) {
+		if (syscall(SYS_futex, word, FUTEX_WAIT, old, &slice, NULL, 0) == 0 ||
+				errno != ETIMEDOUT)
+			continue;
+
+		if (!sim_ring_sim_alive(ring)) {
+			LOG_ERROR("sim_ring: the simulator went away");
+			retval = ERROR_FAIL;
+			break;
+		}
+		keep_alive();
+	}
+	sim_ring_store(waiting, 0);
+
+	return retval;
+}
+
+struct sim_ring *sim_ring_open(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) {
+		LOG_ERROR("sim_ring: cannot open shared memory %s: %s", name, strerror(errno));
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct sim_ring_shm)) {
+		LOG_ERROR("sim_ring: shared memory %s is too small", name);
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		LOG_ERROR("sim_ring: cannot map shared memory %s: %s", name, strerror(errno));
+		return NULL;
+	}
+
+	struct sim_ring_shm *shm = map;
+	uint32_t size = shm->size;
+	if (sim_ring_load(&shm->magic) != SIM_RING_MAGIC ||
+			shm->version != SIM_RING_VERSION ||
+			!size || (size & (size - 1)) ||
+			sizeof(*shm) + 2 * (size_t)size > (size_t)st.st_size) {
+		LOG_ERROR("sim_ring: %s does not hold a ring of version %d", name, SIM_RING_VERSION);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	if (sim_ring_load(&shm->closed)) {
+		LOG_ERROR("sim_ring: the ring %s is closed, restart the simulator", name);
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	struct sim_ring *ring = calloc(1, sizeof(*ring));
+	if (!ring) {
+		LOG_ERROR("Out of memory");
+		munmap(map, st.st_size);
+		return NULL;
+	}
+
+	ring->shm = shm;
+	ring->map_size = st.st_size;
+	ring->mask = size - 1;
+	ring->tx = &shm->to_sim;
+	ring->rx = &shm->from_sim;
+	ring->tx_data = (uint8_t *)(shm + 1);
+	ring->rx_data = ring->tx_data + size;
+	ring->tx_head = sim_ring_load(&ring->tx->head);
+
+	LOG_DEBUG("sim_ring: attached to %s, %" PRIu32 " bytes per direction", name, size);
+	return ring;
+}
+
+void sim_ring_close(struct sim_ring *ring)
+{
+	if (!ring)
+		return;
+
+	__atomic_or_fetch(&ring->shm->closed, SIM_RING_CLOSED_CLIENT, __ATOMIC_SEQ_CST);
+	sim_ring_futex_wake(&ring->tx->head);
+	sim_ring_futex_wake(&ring->rx->tail);
+
+	munmap(ring->shm, ring->map_size);
+	free(ring);
+}
+
+int sim_ring_flush(struct sim_ring *ring)
+{
+	if (sim_ring_load(&ring->tx->head) == ring->tx_head)
+		return ERROR_OK;
+
+	sim_ring_store(&ring->tx->head, ring->tx_head);
+	sim_ring_wake(&ring->tx->head, &ring->tx->consumer_waiting);
+
+	return ERROR_OK;
+}
+
+int sim_ring_write(struct sim_ring *ring, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+
+	while (size) {
+		uint32_t tail = sim_ring_load(&ring->tx->tail);
+		uint32_t space = ring->mask + 1 - (ring->tx_head - tail);
+
+		if (!space) {
+			/* let the simulator consume what is staged to make room */
+			sim_ring_flush(ring);
+			int retval = sim_ring_wait(ring, &ring->tx->tail,
+					&ring->tx->producer_waiting, tail);
+			if (retval != ERROR_OK)
+				return retval;
+			continue;
+		}
+
+		uint32_t offset = ring->tx_head & ring->mask;
+		size_t n = MIN(size, MIN(space, ring->mask + 1 - offset));
+		memcpy(ring->tx_data + offset, p, n);
+		ring->tx_head += n;
+		p += n;
+		size -= n;
+	}
+
+	return ERROR_OK;
+}
+
+int sim_ring_read(struct sim_ring *ring, void *buf, size_t size)
+{
+	uint8_t *p = buf;
+
+	sim_ring_flush(ring);
+
+	while (size) {
+		uint32_t tail = sim_ring_load(&ring->rx->tail);
+		uint32_t head = sim_ring_load(&ring->rx->head);
+
+		if (head == tail) {
+			int retval = sim_ring_wait(ring, &ring->rx->head,
+					&ring->rx->consumer_waiting, head);
+			if (retval != ERROR_OK)
+				return retval;
+			continue;
+		}
+
+		uint32_t offset = tail & ring->mask;
+		size_t n = MIN(size, MIN(head - tail, ring->mask + 1 - offset));
+		memcpy(p, ring->rx_data + offset, n);
+		sim_ring_store(&ring->rx->tail, tail + n);
+		sim_ring_wake(&ring->rx->tail, &ring->rx->producer_waiting);
+		p += n;
+		size -= n;
+	}
+
+	return ERROR_OK;
+}
+
+#else /* SIM_RING_SUPPORTED */
+
+struct sim_ring *sim_ring_open(const char *name)
+{
+	LOG_ERROR("sim_ring: shared memory rings are not supported on this host");
+	return NULL;
+}
+
+void sim_ring_close(struct sim_ring *ring)
+{
+}
+
+int sim_ring_flush(struct sim_ring *ring)
+{
+	return ERROR_FAIL;
+}
+
+int sim_ring_write(struct sim_ring *ring, const void *buf, size_t size)
+{
+	return ERROR_FAIL;
+}
+
+int sim_ring_read(struct sim_ring *ring, void *buf, size_t size)
+{
+	return ERROR_FAIL;
+}
+
+#endif /* SIM_RING_SUPPORTED */
+
+size_t sim_ring_size(const struct sim_ring *ring)
+{
+	return (size_t)ring->mask + 1;
+}
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_JTAG_DRIVERS_SIM_RING_H
+#define OPENOCD_JTAG_DRIVERS_SIM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Shared memory transport to a simulator running on the same host.
+ *
+ * The simulator creates a POSIX shared memory object holding two byte
+ * rings, one per direction, and OpenOCD attaches to it. Writes are staged
+ * in the ring and only published, with a single futex wake up of the
+ * simulator, when flushed or when reading the answer; many transactions
+ * therefore cost one doorbell. The layout is described in
+ * doc/manual/jtag/drivers/sim_ring.txt.
+ *
+ * The rings carry the same byte stream as the driver's socket would, so a
+ * driver only swaps its send and receive calls.
+ */
+
+#define SIM_RING_MAGIC		0x474e5253	/* "SRNG" */
+#define SIM_RING_VERSION	1
+
+/* bits of sim_ring_shm::closed */
+#define SIM_RING_CLOSED_SIM		0x1
+#define SIM_RING_CLOSED_CLIENT	0x2
+
+/** Indexes of one direction, on their own cache line. */
+struct sim_ring_ctl {
+	/** Bytes produced, free running; written by the producer only. */
+	uint32_t head;
+	/** Bytes consumed, free running; written by the consumer only. */
+	uint32_t tail;
+	/** Non zero while the consumer sleeps on head. */
+	uint32_t consumer_waiting;
+	/** Non zero while the producer sleeps on tail. */
+	uint32_t producer_waiting;
+	uint32_t reserved[12];
+};
+
+/** Start of the shared memory object, followed by the two data areas. */
+struct sim_ring_shm {
+	/** SIM_RING_MAGIC, written last by the simulator once initialized. */
+	uint32_t magic;
+	uint32_t version;
+	/** Bytes of data per direction, a power of two. */
+	uint32_t size;
+	/** SIM_RING_CLOSED_* bits, set by the side going away. */
+	uint32_t closed;
+	/** Process id of the simulator, to notice it died. */
+	uint32_t sim_pid;
+	uint32_t reserved[11];
+	/** OpenOCD to simulator; its data area comes first. */
+	struct sim_ring_ctl to_sim;
+	/** Simulator to OpenOCD. */
+	struct sim_ring_ctl from_sim;
+};
+
+struct sim_ring;
+
+/**
+ * Attach to the shared memory object created by the simulator.
+ * @param name The name of the POSIX shared memory object, e.g. "/sim".
+ * @returns The ring, or NULL on error or if the host lacks support.
+ */
+struct sim_ring *sim_ring_open(const char *name);
+
+/** Tell the simulator the client is gone and detach from the ring. */
+void sim_ring_close(struct sim_ring *ring);
+
+/** @returns The capacity of one direction of the ring in bytes. */
+size_t sim_ring_size(const struct sim_ring *ring);
+
+/**
+ * Stage bytes for the simulator. They are published by sim_ring_flush(),
+ * sim_ring_read(), or earlier when the ring is full.
+ */
+int sim_ring_write(struct sim_ring *ring, const void *buf, size_t size);
+
+/** Publish the staged bytes and wake the simulator up if it sleeps. */
+int sim_ring_flush(struct sim_ring *ring);
+
+/** Flush, then wait for and read exactly @a size bytes from the simulator. */
+int sim_ring_read(struct sim_ring *ring, void *buf, size_t size);
+
+#endif /* OPENOCD_JTAG_DRIVERS_SIM_RING_H */
@@ -697,5 +697,6 @@ out_error:
 static int sysfsgpio_quit(void)
 {
 	cleanup_all_fds();
+	bitbang_quit();
 	return ERROR_OK;
 }
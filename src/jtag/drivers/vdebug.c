@@ -52,6 +52,7 @@
 #include "helper/replacements.h"
 #include "helper/log.h"
 #include "helper/list.h"
+#include "sim_ring.h"
 
 #define VD_VERSION 46
 #define VD_BUFFER_LEN 4024
@@ -204,6 +205,8 @@ struct vd_client {
 	uint32_t poll_max;
 	uint32_t targ_time;
 	int hsocket;
+	struct sim_ring *ring;
+	char shm_name[64];
 	char server_name[32];
 	char bfm_path[128];
 	char mem_path[VD_MAX_MEMORIES][128];
@@ -324,8 +327,25 @@ static int vdebug_socket_send(int hsock, struct vd_shm *pmem)
 	return rc;
 }
 
+static uint32_t vdebug_ring_wait_server(struct sim_ring *ring, struct vd_shm *pmem)
+{
+	if (sim_ring_write(ring, &pmem->cmd, VD_CHEADER_LEN + le_to_h_u16(pmem->wbytes)) != ERROR_OK)
+		return VD_ERR_SOC_SEND;
+
+	if (sim_ring_read(ring, pmem->rid, VD_SHEADER_LEN + le_to_h_u16(pmem->rbytes)) != ERROR_OK)
+		return VD_ERR_SOC_RECV;
+
+	int rc = le_to_h_u32(pmem->status);
+	LOG_DEBUG_IO("wait_server: cmd %02" PRIx8 " done over the ring, status %d", pmem->cmd, rc);
+
+	return rc;
+}
+
 static uint32_t vdebug_wait_server(int hsock, struct vd_shm *pmem)
 {
+	if (vdc.ring)
+		return vdebug_ring_wait_server(vdc.ring, pmem);
+
 	if (!hsock)
 		return VD_ERR_SOC_OPEN;
 
@@ -833,17 +853,35 @@ static void vdebug_mem_close(int hsock, struct vd_shm *pm, uint8_t ndx)
 }
 
 
+static void vdebug_disconnect(void)
+{
+	if (vdc.ring)
+		sim_ring_close(vdc.ring);
+	vdc.ring = NULL;
+	if (vdc.hsocket > 0)
+		close_socket(vdc.hsocket);
+	vdc.hsocket = 0;
+}
+
 static int vdebug_init(void)
 {
-	vdc.hsocket = vdebug_socket_open(vdc.server_name, vdc.server_port);
+	if (vdc.shm_name[0])
+		vdc.ring = sim_ring_open(vdc.shm_name);
+	else
+		vdc.hsocket = vdebug_socket_open(vdc.server_name, vdc.server_port);
 	pbuf = calloc(1, sizeof(struct vd_shm));
 	if (!pbuf) {
-		close_socket(vdc.hsocket);
-		vdc.hsocket = 0;
+		vdebug_disconnect();
 		LOG_ERROR("cannot allocate %zu bytes", sizeof(struct vd_shm));
 		return ERROR_FAIL;
 	}
-	if (vdc.hsocket <= 0) {
+	if (vdc.shm_name[0] && !vdc.ring) {
+		free(pbuf);
+		pbuf = NULL;
+		LOG_ERROR("0x%x cannot open vdebug ring %s", VD_ERR_SHM_OPEN, vdc.shm_name);
+		return ERROR_FAIL;
+	}
+	if (!vdc.ring && vdc.hsocket <= 0) {
 		free(pbuf);
 		pbuf = NULL;
 		LOG_ERROR("cannot connect to vdebug server %s:%" PRIu16,
@@ -859,8 +897,7 @@ static int vdebug_init(void)
 	int rc = vdebug_open(vdc.hsocket, pbuf, vdc.bfm_path, vdc.bfm_type, vdc.bfm_period, sig_mask);
 	if (rc != 0) {
 		LOG_ERROR("0x%x cannot connect to %s", rc, vdc.bfm_path);
-		close_socket(vdc.hsocket);
-		vdc.hsocket = 0;
+		vdebug_disconnect();
 		free(pbuf);
 		pbuf = NULL;
 	} else {
@@ -870,8 +907,12 @@ static int vdebug_init(void)
 				LOG_ERROR("0x%x cannot connect to %s", rc, vdc.mem_path[i]);
 		}
 
-		LOG_INFO("vdebug %d connected to %s through %s:%" PRIu16,
-				 VD_VERSION, vdc.bfm_path, vdc.server_name, vdc.server_port);
+		if (vdc.ring)
+			LOG_INFO("vdebug %d connected to %s through ring %s",
+					 VD_VERSION, vdc.bfm_path, vdc.shm_name);
+		else
+			LOG_INFO("vdebug %d connected to %s through %s:%" PRIu16,
+					 VD_VERSION, vdc.bfm_path, vdc.server_name, vdc.server_port);
 	}
 
 	return rc;
@@ -883,10 +924,13 @@ static int vdebug_quit(void)
 		if (vdc.mem_width[i])
 			vdebug_mem_close(vdc.hsocket, pbuf, i);
 	int rc = vdebug_close(vdc.hsocket, pbuf, vdc.bfm_type);
-	LOG_INFO("vdebug %d disconnected from %s through %s:%" PRIu16 " rc:%d", VD_VERSION,
-		vdc.bfm_path, vdc.server_name, vdc.server_port, rc);
-	if (vdc.hsocket)
-		close_socket(vdc.hsocket);
+	if (vdc.ring)
+		LOG_INFO("vdebug %d disconnected from %s through ring %s rc:%d", VD_VERSION,
+			vdc.bfm_path, vdc.shm_name, rc);
+	else
+		LOG_INFO("vdebug %d disconnected from %s through %s:%" PRIu16 " rc:%d", VD_VERSION,
+			vdc.bfm_path, vdc.server_name, vdc.server_port, rc);
+	vdebug_disconnect();
 	free(pbuf);
 	pbuf = NULL;
 
@@ -1150,6 +1194,21 @@ COMMAND_HANDLER(vdebug_set_server)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(vdebug_set_shm_ring)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strlen(CMD_ARGV[0]) >= sizeof(vdc.shm_name)) {
+		LOG_ERROR("shared memory name %s is too long", CMD_ARGV[0]);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	strcpy(vdc.shm_name, CMD_ARGV[0]);
+	LOG_DEBUG("shm_ring: %s", vdc.shm_name);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(vdebug_set_bfm)
 {
 	char prefix;
@@ -1236,6 +1295,13 @@ static const struct command_registration vdebug_command_handlers[] = {
 		.help = "set the vdebug server name or address",
 		.usage = "<host:port>",
 	},
+	{
+		.name = "shm_ring",
+		.handler = &vdebug_set_shm_ring,
+		.mode = COMMAND_CONFIG,
+		.help = "use a shared memory ring on the local host instead of the server socket",
+		.usage = "<name>",
+	},
 	{
 		.name = "bfm_path",
 		.handler = &vdebug_set_bfm,
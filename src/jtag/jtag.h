@@ -519,6 +519,25 @@ int jtag_execute_queue(void);
 /** same as jtag_execute_queue() but does not clear the error flag */
 void jtag_execute_queue_noclear(void);
 
+/**
+ * Start executing the queued commands and return without waiting for
+ * them, so that the next commands can be queued while the adapter is
+ * busy. This only differs from jtag_execute_queue_noclear() when the
+ * adapter worker thread is enabled, see jtag_set_async_flush().
+ *
+ * The in_value buffers of the submitted commands must not be used, and
+ * the adapter must not be accessed other than by queueing commands, until
+ * jtag_execute_queue() has returned. Errors are reported by that call.
+ */
+void jtag_submit_queue(void);
+
+/**
+ * Enable or disable the thread executing the queues passed to
+ * jtag_submit_queue(). Disabling it executes what is queued.
+ */
+int jtag_set_async_flush(bool enable);
+bool jtag_get_async_flush(void);
+
 /** @returns the number of times the scan queue has been flushed */
 int jtag_get_flush_queue_count(void);
 
@@ -57,6 +57,19 @@ int interface_jtag_add_runtest(int num_cycles, tap_state_t endstate);
 int interface_add_tms_seq(unsigned num_bits,
 		const uint8_t *bits, enum tap_state state);
 
+/**
+ * Queue the comparison of the value captured by @a field, of the last scan
+ * queued, with its check_value and check_mask. The checks of a queue are
+ * compared together once it is executed, before its callbacks run.
+ * @param tap The TAP the field belongs to, for the report.
+ * @param ir_scan Whether the last scan is an IR scan, for the report.
+ * @param field_index The position of @a field in the fields of @a tap.
+ */
+int interface_jtag_add_check(struct jtag_tap *tap, bool ir_scan,
+		unsigned int field_index, const struct scan_field *field);
+/** Release the memory kept for the checks of the queues. */
+void interface_jtag_free_checks(void);
+
 /**
  * This drives the actual srst and trst pins. srst will always be 0
  * if jtag_reset_config & RESET_SRST_PULLS_TRST != 0 and ditto for
@@ -69,6 +82,11 @@ int interface_jtag_add_reset(int trst, int srst);
 int interface_jtag_add_sleep(uint32_t us);
 int interface_jtag_add_clocks(int num_cycles);
 int interface_jtag_execute_queue(void);
+/** Start executing the queue, see jtag_submit_queue(). */
+int interface_jtag_submit_queue(void);
+/** Start or stop the thread executing the submitted queues. */
+int interface_jtag_set_worker(bool enable);
+bool interface_jtag_get_worker(void);
 
 /**
  * Calls the interface callback to execute the queue.  This routine
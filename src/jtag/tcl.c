@@ -215,6 +215,43 @@ COMMAND_HANDLER(handle_jtag_flush_count)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_jtag_queue_stats)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct cmd_queue_stats stats;
+	cmd_queue_get_stats(&stats);
+
+	command_print(CMD, "allocations: %" PRIu64 " (%" PRIu64 " bytes)",
+		stats.allocs, stats.alloc_bytes);
+	command_print(CMD, "queue resets: %" PRIu64, stats.resets);
+	command_print(CMD, "page allocations: %" PRIu64, stats.page_mallocs);
+	command_print(CMD, "peak queue size: %zu bytes", stats.peak_bytes);
+	command_print(CMD, "retained memory: %zu bytes", stats.retained_bytes);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_async_flush)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		int retval = jtag_set_async_flush(enable);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	const char *status = jtag_get_async_flush() ? "enabled" : "disabled";
+	command_print(CMD, "asynchronous queue flush is %s", status);
+
+	return ERROR_OK;
+}
+
 /* REVISIT Just what about these should "move" ... ?
  * These registrations, into the main JTAG table?
  *
@@ -801,6 +838,22 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.help = "Returns list of all JTAG tap names.",
 		.usage = "",
 	},
+	{
+		.name = "queue_stats",
+		.mode = COMMAND_EXEC,
+		.handler = handle_jtag_queue_stats,
+		.help = "Display statistics of the JTAG command queue "
+			"memory allocator.",
+		.usage = "",
+	},
+	{
+		.name = "async_flush",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_async_flush,
+		.help = "Execute the JTAG command queues submitted by "
+			"long operations in a separate thread.",
+		.usage = "['enable'|'disable']",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
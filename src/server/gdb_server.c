@@ -41,6 +41,10 @@
 #include "rtos/rtos.h"
 #include "target/smp.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /**
  * @file
  * GDB server implementation.
@@ -95,6 +99,17 @@ struct gdb_connection {
 	char *thread_list;
 	/* flag to mask the output from gdb_log_callback() */
 	enum gdb_output_flag output_flag;
+	/* incoming packet, packet_size bytes plus null-termination */
+	char *packet_buffer;
+	unsigned int packet_size;
+	/* contiguous binary memory writes not sent to the target yet,
+	 * see gdb_write_flush() */
+	uint8_t *write_buffer;
+	uint32_t write_buffer_size;
+	uint64_t write_address;
+	uint32_t write_count;
+	/* gdb_write_flush_timer_callback() is registered */
+	bool write_timer;
 };
 
 #if 0
@@ -135,6 +150,18 @@ static int gdb_report_data_abort;
  * default. */
 static int gdb_report_register_access_error;
 
+/* maximum packet size advertised to gdb by new connections,
+ * see gdb_packet_size command */
+static unsigned int gdb_packet_size = GDB_BUFFER_SIZE;
+#define GDB_PACKET_SIZE_MAX (16 * 1024 * 1024)
+
+/* size of the runs of 'X' packets coalesced before writing them to the
+ * target, zero when disabled. See gdb_write_coalesce command */
+static unsigned int gdb_write_coalesce_size;
+#define GDB_WRITE_COALESCE_SIZE_MAX (16 * 1024 * 1024)
+/* maximum time coalesced writes stay pending when gdb goes quiet */
+#define GDB_WRITE_FLUSH_PERIOD_MS 100
+
 /* set if we are sending target descriptions to gdb
  * via qXfer:features:read packet */
 /* enabled by default */
@@ -392,17 +419,62 @@ static void gdb_log_outgoing_packet(struct connection *connection, char *packet_
 			checksum);
 }
 
+/* modulo 256 sum of the packet data */
+static unsigned char gdb_checksum(const char *buffer, size_t len)
+{
+	unsigned char checksum = 0;
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128i sum = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(v, _mm_setzero_si128()));
+	}
+	checksum = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum));
+#endif
+
+	for (; i < len; i++)
+		checksum += buffer[i];
+
+	return checksum;
+}
+
+/* number of leading characters in @a buffer that need no special handling
+ * while receiving a packet, i.e. none of '#', '$' and the '}' escape */
+static size_t gdb_plain_span(const char *buffer, size_t len)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(buffer + i));
+		__m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('#')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('$'))),
+			_mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+		int mask = _mm_movemask_epi8(special);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+
+	for (; i < len; i++)
+		if (buffer[i] == '#' || buffer[i] == '$' || buffer[i] == '}')
+			break;
+
+	return i;
+}
+
 static int gdb_put_packet_inner(struct connection *connection,
 		char *buffer, int len)
 {
-	int i;
 	unsigned char my_checksum = 0;
 	int reply;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
+	my_checksum = gdb_checksum(buffer, len);
 
 #ifdef _DEBUG_GDB_IO_
 	/*
@@ -560,6 +632,16 @@ static inline int fetch_packet(struct connection *connection,
 			i = 0;
 			int done = 0;
 			while (i < run) {
+				/* copy the characters up to the next special one at once */
+				size_t plain = gdb_plain_span(buf, run - i);
+				my_checksum += gdb_checksum(buf, plain);
+				memcpy(buffer + count, buf, plain);
+				count += plain;
+				buf += plain;
+				i += plain;
+				if (i == run)
+					break;
+
 				character = *buf++;
 				i++;
 				if (character == '#') {
@@ -942,6 +1024,64 @@ static void gdb_frontend_halted(struct target *target, struct connection *connec
 	}
 }
 
+static int gdb_write_memory(struct target *target, uint64_t addr,
+		uint32_t len, const uint8_t *buffer)
+{
+	int retval = ERROR_NOT_IMPLEMENTED;
+	if (target->rtos)
+		retval = rtos_write_buffer(target, addr, len, buffer);
+	if (retval == ERROR_NOT_IMPLEMENTED)
+		retval = target_write_buffer(target, addr, len, buffer);
+
+	return retval;
+}
+
+/*
+ * Write the pending run of coalesced 'X' packets to the target. GDB was
+ * already told that they succeeded, so a failure is reported on the next
+ * memory write or step/continue, like for the packets replied before
+ * being written.
+ */
+static int gdb_write_flush(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+
+	if (!gdb_con->write_count)
+		return ERROR_OK;
+
+	/* clear it first, timer and event callbacks can run during the write */
+	uint32_t count = gdb_con->write_count;
+	gdb_con->write_count = 0;
+
+	LOG_DEBUG("flush addr: 0x%" PRIx64 ", len: 0x%8.8" PRIx32 "", gdb_con->write_address, count);
+
+	int retval = gdb_write_memory(target, gdb_con->write_address, count, gdb_con->write_buffer);
+	if (retval != ERROR_OK)
+		gdb_con->mem_write_error = true;
+
+	return retval;
+}
+
+static int gdb_write_flush_timer_callback(void *priv)
+{
+	struct connection *connection = priv;
+	struct gdb_connection *gdb_con = connection->priv;
+
+	if (gdb_con->busy)
+		return ERROR_OK;
+
+	gdb_write_flush(connection);
+
+	/* coalescing was disabled, no run can start until it is enabled again */
+	if (!gdb_write_coalesce_size) {
+		target_unregister_timer_callback(gdb_write_flush_timer_callback, connection);
+		gdb_con->write_timer = false;
+	}
+
+	return ERROR_OK;
+}
+
 static int gdb_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
 {
@@ -952,6 +1092,10 @@ static int gdb_target_callback_event_handler(struct target *target,
 		return ERROR_OK;
 
 	switch (event) {
+		case TARGET_EVENT_RESUME_START:
+		case TARGET_EVENT_STEP_START:
+			gdb_write_flush(connection);
+			break;
 		case TARGET_EVENT_GDB_HALT:
 			gdb_frontend_halted(target, connection);
 			break;
@@ -965,6 +1109,23 @@ static int gdb_target_callback_event_handler(struct target *target,
 	return ERROR_OK;
 }
 
+/*
+ * The reset events only reach the event scripts, the reset callbacks run
+ * before any of them: write the pending run while the target still holds
+ * the state GDB wrote it in.
+ */
+static int gdb_target_callback_reset_handler(struct target *target,
+		enum target_reset_mode reset_mode, void *priv)
+{
+	struct connection *connection = priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+
+	if (gdb_service->target == target)
+		gdb_write_flush(connection);
+
+	return ERROR_OK;
+}
+
 static int gdb_new_connection(struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = malloc(sizeof(struct gdb_connection));
@@ -972,6 +1133,19 @@ static int gdb_new_connection(struct connection *connection)
 	int retval;
 	int initial_ack;
 
+	if (!gdb_connection) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	gdb_connection->packet_size = gdb_packet_size;
+	gdb_connection->packet_buffer = malloc(gdb_packet_size + 1);
+	if (!gdb_connection->packet_buffer) {
+		LOG_ERROR("Out of memory");
+		free(gdb_connection);
+		return ERROR_FAIL;
+	}
+
 	target = get_target_from_connection(connection);
 	connection->priv = gdb_connection;
 	connection->cmd_ctx->current_target = target;
@@ -993,6 +1167,11 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
 	gdb_connection->output_flag = GDB_OUTPUT_NO;
+	gdb_connection->write_buffer = NULL;
+	gdb_connection->write_buffer_size = 0;
+	gdb_connection->write_address = 0;
+	gdb_connection->write_count = 0;
+	gdb_connection->write_timer = false;
 
 	/* send ACK to GDB for debug request */
 	gdb_write(connection, "+", 1);
@@ -1076,6 +1255,7 @@ static int gdb_new_connection(struct connection *connection)
 	 *
 	 * register callback to be informed about target events */
 	target_register_event_callback(gdb_target_callback_event_handler, connection);
+	target_register_reset_callback(gdb_target_callback_reset_handler, connection);
 
 	log_add_callback(gdb_log_callback, connection);
 
@@ -1100,6 +1280,11 @@ static int gdb_connection_closed(struct connection *connection)
 		target_state_name(target),
 		gdb_actual_connections);
 
+	/* the target still gets the memory GDB wrote */
+	gdb_write_flush(connection);
+	if (gdb_connection->write_timer)
+		target_unregister_timer_callback(gdb_write_flush_timer_callback, connection);
+
 	/* see if an image built with vFlash commands is left */
 	if (gdb_connection->vflash_image) {
 		image_close(gdb_connection->vflash_image);
@@ -1110,10 +1295,13 @@ static int gdb_connection_closed(struct connection *connection)
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	free(gdb_connection->packet_buffer);
+	free(gdb_connection->write_buffer);
 	free(connection->priv);
 	connection->priv = NULL;
 
 	target_unregister_event_callback(gdb_target_callback_event_handler, connection);
+	target_unregister_reset_callback(gdb_target_callback_reset_handler, connection);
 
 	target_call_event_callbacks(target, TARGET_EVENT_GDB_END);
 
@@ -1485,38 +1673,187 @@ static int gdb_error(struct connection *connection, int retval)
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
  */
-static int gdb_read_memory_packet(struct connection *connection,
-		char const *packet, int packet_size)
+/* cache of target memory read by gdb while the target is halted */
+#define GDB_MEM_CACHE_PAGE_SIZE	256
+#define GDB_MEM_CACHE_PAGES		256
+
+/* address spaces the cached pages belong to */
+enum gdb_mem_cache_space {
+	GDB_MEM_CACHE_PHYSICAL,
+	GDB_MEM_CACHE_VIRTUAL,
+};
+
+struct gdb_mem_cache_page {
+	bool valid;
+	enum gdb_mem_cache_space space;
+	target_addr_t address;
+	uint8_t data[GDB_MEM_CACHE_PAGE_SIZE];
+};
+
+struct gdb_mem_cache {
+	/* the cache is shared by all the targets of a gdb service (SMP) */
+	struct gdb_service *service;
+	/* value of target_memory_generation() the pages are valid for */
+	unsigned int generation;
+	uint64_t hits;
+	uint64_t misses;
+	struct gdb_mem_cache_page pages[GDB_MEM_CACHE_PAGES];
+	struct gdb_mem_cache *next;
+};
+
+/* memory range never cached, e.g. peripheral registers */
+struct gdb_mem_uncached {
+	target_addr_t address;
+	target_addr_t size;
+	struct gdb_mem_uncached *next;
+};
+
+/* disabled by default, see gdb_memory_cache command */
+static bool gdb_mem_cache_enabled;
+static struct gdb_mem_cache *gdb_mem_caches;
+static struct gdb_mem_uncached *gdb_mem_uncached_list;
+
+static struct gdb_mem_cache *gdb_mem_cache_get(struct target *target, bool create)
 {
-	struct target *target = get_target_from_connection(connection);
-	char *separator;
-	uint64_t addr = 0;
-	uint32_t len = 0;
+	struct gdb_mem_cache *cache;
 
-	uint8_t *buffer;
-	char *hex_buffer;
+	if (!target->gdb_service)
+		return NULL;
 
-	int retval = ERROR_OK;
+	for (cache = gdb_mem_caches; cache; cache = cache->next)
+		if (cache->service == target->gdb_service)
+			return cache;
 
-	/* skip command character */
-	packet++;
+	if (!create)
+		return NULL;
 
-	addr = strtoull(packet, &separator, 16);
+	cache = calloc(1, sizeof(*cache));
+	if (!cache) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+	cache->service = target->gdb_service;
+	cache->generation = target_memory_generation();
+	cache->next = gdb_mem_caches;
+	gdb_mem_caches = cache;
 
-	if (*separator != ',') {
-		LOG_ERROR("incomplete read memory packet received, dropping connection");
-		return ERROR_SERVER_REMOTE_CLOSED;
+	return cache;
+}
+
+static void gdb_mem_cache_flush(struct gdb_mem_cache *cache)
+{
+	for (unsigned int i = 0; i < GDB_MEM_CACHE_PAGES; i++)
+		cache->pages[i].valid = false;
+	cache->generation = target_memory_generation();
+}
+
+static bool gdb_mem_cache_uncached(target_addr_t address, target_addr_t size)
+{
+	for (struct gdb_mem_uncached *r = gdb_mem_uncached_list; r; r = r->next)
+		if (address <= r->address + r->size - 1 && r->address <= address + size - 1)
+			return true;
+
+	return false;
+}
+
+static bool gdb_mem_cache_in_range(target_addr_t address, target_addr_t base, target_addr_t size)
+{
+	return size >= GDB_MEM_CACHE_PAGE_SIZE && address >= base &&
+		address - base <= size - GDB_MEM_CACHE_PAGE_SIZE;
+}
+
+/*
+ * Whether the page at address can be read whole to answer a smaller read.
+ * Reading memory has side effects on peripheral registers, only the work
+ * area and the flash banks are known to be plain memory.
+ */
+static bool gdb_mem_cache_page_fillable(struct target *target, target_addr_t address,
+		enum gdb_mem_cache_space space)
+{
+	if (space == GDB_MEM_CACHE_VIRTUAL) {
+		if (target->working_area_virt_spec &&
+				gdb_mem_cache_in_range(address, target->working_area_virt, target->working_area_size))
+			return true;
+		/* the flash banks are at physical addresses */
+		return false;
 	}
 
-	len = strtoul(separator + 1, NULL, 16);
+	if (target->working_area_phys_spec &&
+			gdb_mem_cache_in_range(address, target->working_area_phys, target->working_area_size))
+		return true;
 
-	if (!len) {
-		LOG_WARNING("invalid read memory packet received (len == 0)");
-		gdb_put_packet(connection, "", 0);
-		return ERROR_OK;
+	struct flash_bank *bank;
+	if (get_flash_bank_by_addr(target, address, false, &bank) != ERROR_OK || !bank)
+		return false;
+
+	return gdb_mem_cache_in_range(address, bank->base, bank->size);
+}
+
+static int gdb_mem_cache_read(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	struct gdb_mem_cache *cache = NULL;
+	int mmu_enabled = 0;
+
+	if (gdb_mem_cache_enabled && target->state == TARGET_HALTED)
+		cache = gdb_mem_cache_get(target, true);
+
+	if (cache && target->type->mmu && target->type->mmu(target, &mmu_enabled) != ERROR_OK)
+		cache = NULL;
+
+	if (!cache)
+		return target_read_buffer(target, address, size, buffer);
+
+	if (cache->generation != target_memory_generation())
+		gdb_mem_cache_flush(cache);
+
+	enum gdb_mem_cache_space space = mmu_enabled ? GDB_MEM_CACHE_VIRTUAL : GDB_MEM_CACHE_PHYSICAL;
+
+	while (size > 0) {
+		target_addr_t page_address = address & ~(target_addr_t)(GDB_MEM_CACHE_PAGE_SIZE - 1);
+		uint32_t offset = address - page_address;
+		uint32_t chunk = MIN(size, GDB_MEM_CACHE_PAGE_SIZE - offset);
+		struct gdb_mem_cache_page *page =
+			&cache->pages[(page_address / GDB_MEM_CACHE_PAGE_SIZE) % GDB_MEM_CACHE_PAGES];
+
+		if (page->valid && page->address == page_address && page->space == space) {
+			cache->hits++;
+		} else {
+			cache->misses++;
+			page->valid = false;
+			/* a read of the whole page fills it, whatever the memory */
+			bool fill = chunk == GDB_MEM_CACHE_PAGE_SIZE ||
+				gdb_mem_cache_page_fillable(target, page_address, space);
+			if (!fill || gdb_mem_cache_uncached(page_address, GDB_MEM_CACHE_PAGE_SIZE) ||
+					target_read_buffer(target, page_address, GDB_MEM_CACHE_PAGE_SIZE,
+						page->data) != ERROR_OK) {
+				/* read only what was asked for, it can still succeed */
+				int retval = target_read_buffer(target, address, chunk, buffer);
+				if (retval != ERROR_OK)
+					return retval;
+				goto next;
+			}
+			page->valid = true;
+			page->address = page_address;
+			page->space = space;
+		}
+
+		memcpy(buffer, page->data + offset, chunk);
+next:
+		address += chunk;
+		buffer += chunk;
+		size -= chunk;
 	}
 
-	buffer = malloc(len);
+	return ERROR_OK;
+}
+
+/* Read target memory for the 'm' and 'x' packets */
+static int gdb_read_memory(struct connection *connection, uint64_t addr,
+		uint32_t len, uint8_t *buffer)
+{
+	struct target *target = get_target_from_connection(connection);
+	int retval;
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
@@ -1524,7 +1861,7 @@ static int gdb_read_memory_packet(struct connection *connection,
 	if (target->rtos)
 		retval = rtos_read_buffer(target, addr, len, buffer);
 	if (retval == ERROR_NOT_IMPLEMENTED)
-		retval = target_read_buffer(target, addr, len, buffer);
+		retval = gdb_mem_cache_read(target, addr, len, buffer);
 
 	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
 		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
@@ -1544,6 +1881,43 @@ static int gdb_read_memory_packet(struct connection *connection,
 		retval = ERROR_OK;
 	}
 
+	return retval;
+}
+
+static int gdb_read_memory_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	char *separator;
+	uint64_t addr = 0;
+	uint32_t len = 0;
+
+	uint8_t *buffer;
+	char *hex_buffer;
+
+	int retval = ERROR_OK;
+
+	/* skip command character */
+	packet++;
+
+	addr = strtoull(packet, &separator, 16);
+
+	if (*separator != ',') {
+		LOG_ERROR("incomplete read memory packet received, dropping connection");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	len = strtoul(separator + 1, NULL, 16);
+
+	if (!len) {
+		LOG_WARNING("invalid read memory packet received (len == 0)");
+		gdb_put_packet(connection, "", 0);
+		return ERROR_OK;
+	}
+
+	buffer = malloc(len);
+
+	retval = gdb_read_memory(connection, addr, len, buffer);
+
 	if (retval == ERROR_OK) {
 		hex_buffer = malloc(len * 2 + 1);
 
@@ -1560,6 +1934,71 @@ static int gdb_read_memory_packet(struct connection *connection,
 	return retval;
 }
 
+/* 'x addr,length': same as 'm', but the reply is 'b' followed by the data
+ * in binary form, escaped like the payload of 'X' packets */
+static int gdb_read_memory_binary_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	char *separator;
+	uint64_t addr = 0;
+	uint32_t len = 0;
+	int retval;
+
+	/* skip command character */
+	packet++;
+
+	addr = strtoull(packet, &separator, 16);
+
+	if (*separator != ',') {
+		LOG_ERROR("incomplete read memory binary packet received, dropping connection");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	len = strtoul(separator + 1, NULL, 16);
+
+	/* gdb sizes the request after the unescaped data, do not
+	 * allocate more than a reply to 'm' would need */
+	if (len > gdb_con->packet_size) {
+		LOG_WARNING("read memory binary packet too large (len == 0x%" PRIx32 ")", len);
+		return gdb_error(connection, ERROR_FAIL);
+	}
+
+	uint8_t *buffer = malloc(len);
+	/* every byte may need to be escaped */
+	char *reply = malloc(1 + len * 2);
+	if ((len && !buffer) || !reply) {
+		LOG_ERROR("Out of memory");
+		free(buffer);
+		free(reply);
+		return gdb_error(connection, ERROR_FAIL);
+	}
+
+	retval = ERROR_OK;
+	if (len)
+		retval = gdb_read_memory(connection, addr, len, buffer);
+
+	if (retval == ERROR_OK) {
+		size_t pkt_len = 0;
+		reply[pkt_len++] = 'b';
+		for (uint32_t i = 0; i < len; i++) {
+			char c = buffer[i];
+			if (c == '#' || c == '$' || c == '}' || c == '*') {
+				reply[pkt_len++] = '}';
+				c ^= 0x20;
+			}
+			reply[pkt_len++] = c;
+		}
+		gdb_put_packet(connection, reply, pkt_len);
+	} else
+		retval = gdb_error(connection, retval);
+
+	free(reply);
+	free(buffer);
+
+	return retval;
+}
+
 static int gdb_write_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1644,6 +2083,30 @@ static int gdb_write_memory_binary_packet(struct connection *connection,
 
 	struct gdb_connection *gdb_connection = connection->priv;
 
+	/* Contiguous writes, e.g. from GDB load, are accumulated and written
+	 * to the target in large runs once the run is interrupted. */
+	bool coalesce = len >= fast_limit && len <= gdb_write_coalesce_size;
+	if (gdb_connection->write_count && (!coalesce ||
+			addr != gdb_connection->write_address + gdb_connection->write_count ||
+			gdb_connection->write_count + len > gdb_connection->write_buffer_size))
+		gdb_write_flush(connection);
+
+	if (coalesce && gdb_connection->write_buffer_size != gdb_write_coalesce_size) {
+		/* the size changed during a run, do not lose its data */
+		gdb_write_flush(connection);
+		free(gdb_connection->write_buffer);
+		gdb_connection->write_buffer = malloc(gdb_write_coalesce_size);
+		gdb_connection->write_buffer_size = gdb_connection->write_buffer ? gdb_write_coalesce_size : 0;
+		coalesce = gdb_connection->write_buffer;
+	}
+
+	/* a run left pending must be flushed even if GDB goes quiet */
+	if (coalesce && !gdb_connection->write_timer) {
+		target_register_timer_callback(gdb_write_flush_timer_callback, GDB_WRITE_FLUSH_PERIOD_MS,
+			TARGET_TIMER_TYPE_PERIODIC, connection);
+		gdb_connection->write_timer = true;
+	}
+
 	if (gdb_connection->mem_write_error)
 		retval = ERROR_FAIL;
 
@@ -1665,15 +2128,18 @@ static int gdb_write_memory_binary_packet(struct connection *connection,
 			return retval;
 	}
 
+	if (coalesce) {
+		if (!gdb_connection->write_count)
+			gdb_connection->write_address = addr;
+		memcpy(gdb_connection->write_buffer + gdb_connection->write_count, separator, len);
+		gdb_connection->write_count += len;
+		return ERROR_OK;
+	}
+
 	if (len) {
 		LOG_DEBUG("addr: 0x%" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-		retval = ERROR_NOT_IMPLEMENTED;
-		if (target->rtos)
-			retval = rtos_write_buffer(target, addr, len, (uint8_t *)separator);
-		if (retval == ERROR_NOT_IMPLEMENTED)
-			retval = target_write_buffer(target, addr, len, (uint8_t *)separator);
-
+		retval = gdb_write_memory(target, addr, len, (uint8_t *)separator);
 		if (retval != ERROR_OK)
 			gdb_connection->mem_write_error = true;
 	}
@@ -2880,8 +3346,8 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
-			GDB_BUFFER_SIZE,
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+",
+			gdb_connection->packet_size,
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
 
@@ -3486,14 +3952,12 @@ static void gdb_sig_halted(struct connection *connection)
 
 static int gdb_input_inner(struct connection *connection)
 {
-	/* Do not allocate this on the stack */
-	static char gdb_packet_buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
-
 	struct target *target;
+	struct gdb_connection *gdb_con = connection->priv;
+	char *gdb_packet_buffer = gdb_con->packet_buffer;
 	char const *packet = gdb_packet_buffer;
 	int packet_size;
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 	static bool warn_use_ext;
 
 	target = get_target_from_connection(connection);
@@ -3510,7 +3974,7 @@ static int gdb_input_inner(struct connection *connection)
 	 * drain the rest of the buffer.
 	 */
 	do {
-		packet_size = GDB_BUFFER_SIZE;
+		packet_size = gdb_con->packet_size;
 		retval = gdb_get_packet(connection, gdb_packet_buffer, &packet_size);
 		if (retval != ERROR_OK)
 			return retval;
@@ -3522,6 +3986,11 @@ static int gdb_input_inner(struct connection *connection)
 
 			gdb_log_incoming_packet(connection, gdb_packet_buffer);
 
+			/* coalesced memory writes must reach the target before
+			 * any other packet can observe or change its state */
+			if (packet[0] != 'X')
+				gdb_write_flush(connection);
+
 			retval = ERROR_OK;
 			switch (packet[0]) {
 				case 'T':	/* Is thread alive? */
@@ -3555,6 +4024,9 @@ static int gdb_input_inner(struct connection *connection)
 				case 'M':
 					retval = gdb_write_memory_packet(connection, packet, packet_size);
 					break;
+				case 'x':
+					retval = gdb_read_memory_binary_packet(connection, packet, packet_size);
+					break;
 				case 'z':
 				case 'Z':
 					retval = gdb_breakpoint_watchpoint_packet(connection, packet, packet_size);
@@ -3919,6 +4391,45 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_packet_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size < GDB_BUFFER_SIZE || size > GDB_PACKET_SIZE_MAX) {
+			command_print(CMD, "packet size must be between %u and %u",
+				GDB_BUFFER_SIZE, GDB_PACKET_SIZE_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_packet_size = size;
+	}
+
+	command_print(CMD, "%u", gdb_packet_size);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_write_coalesce_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size > GDB_WRITE_COALESCE_SIZE_MAX) {
+			command_print(CMD, "size must not exceed %u", GDB_WRITE_COALESCE_SIZE_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_write_coalesce_size = size;
+	}
+
+	command_print(CMD, "%u", gdb_write_coalesce_size);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -3937,6 +4448,86 @@ COMMAND_HANDLER(handle_gdb_report_register_access_error)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_memory_cache_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		if (enable != gdb_mem_cache_enabled) {
+			/* contents are not tracked while disabled */
+			for (struct gdb_mem_cache *cache = gdb_mem_caches; cache; cache = cache->next)
+				gdb_mem_cache_flush(cache);
+			gdb_mem_cache_enabled = enable;
+		}
+	}
+
+	command_print(CMD, "gdb memory cache %s",
+		gdb_mem_cache_enabled ? "enabled" : "disabled");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_memory_cache_uncached_command)
+{
+	if (CMD_ARGC != 0 && CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 2) {
+		target_addr_t address, size;
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], size);
+		if (!size || address + size - 1 < address) {
+			command_print(CMD, "invalid memory range");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		struct gdb_mem_uncached *r = malloc(sizeof(*r));
+		if (!r) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		r->address = address;
+		r->size = size;
+		r->next = gdb_mem_uncached_list;
+		gdb_mem_uncached_list = r;
+
+		/* drop the pages that are now part of an uncached range */
+		for (struct gdb_mem_cache *cache = gdb_mem_caches; cache; cache = cache->next)
+			gdb_mem_cache_flush(cache);
+		return ERROR_OK;
+	}
+
+	for (struct gdb_mem_uncached *r = gdb_mem_uncached_list; r; r = r->next)
+		command_print(CMD, TARGET_ADDR_FMT " " TARGET_ADDR_FMT, r->address, r->size);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_memory_cache_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target *target = get_current_target(CMD_CTX);
+	struct gdb_mem_cache *cache = gdb_mem_cache_get(target, false);
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		if (cache) {
+			cache->hits = 0;
+			cache->misses = 0;
+		}
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "hits %" PRIu64 ", misses %" PRIu64,
+		cache ? cache->hits : 0, cache ? cache->misses : 0);
+	return ERROR_OK;
+}
+
 /* gdb_breakpoint_override */
 COMMAND_HANDLER(handle_gdb_breakpoint_override_command)
 {
@@ -4051,6 +4642,23 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_packet_size",
+		.handler = handle_gdb_packet_size_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the maximum packet size advertised to "
+			"gdb. The new size applies to the next gdb connections.",
+		.usage = "[size]"
+	},
+	{
+		.name = "gdb_write_coalesce",
+		.handler = handle_gdb_write_coalesce_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the size of the runs contiguous gdb "
+			"binary memory writes are gathered in before being written "
+			"to the target. Zero disables it.",
+		.usage = "[size]"
+	},
 	{
 		.name = "gdb_report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -4065,6 +4673,30 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable reporting register access errors",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_memory_cache",
+		.handler = handle_gdb_memory_cache_command,
+		.mode = COMMAND_ANY,
+		.help = "enable or disable caching the target memory read by gdb "
+			"while the target is halted",
+		.usage = "['enable'|'disable']"
+	},
+	{
+		.name = "gdb_memory_cache_uncached",
+		.handler = handle_gdb_memory_cache_uncached_command,
+		.mode = COMMAND_ANY,
+		.help = "add a memory range that gdb memory reads always access, "
+			"or list these ranges",
+		.usage = "[address size]"
+	},
+	{
+		.name = "gdb_memory_cache_stats",
+		.handler = handle_gdb_memory_cache_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "display or reset the gdb memory cache hit and miss "
+			"counters of the current target",
+		.usage = "['reset']"
+	},
 	{
 		.name = "gdb_breakpoint_override",
 		.handler = handle_gdb_breakpoint_override_command,
@@ -4101,6 +4733,18 @@ void gdb_service_free(void)
 {
 	free(gdb_port);
 	free(gdb_port_next);
+
+	while (gdb_mem_caches) {
+		struct gdb_mem_cache *cache = gdb_mem_caches;
+		gdb_mem_caches = cache->next;
+		free(cache);
+	}
+
+	while (gdb_mem_uncached_list) {
+		struct gdb_mem_uncached *r = gdb_mem_uncached_list;
+		gdb_mem_uncached_list = r->next;
+		free(r);
+	}
 }
 
 int gdb_get_actual_connections(void)
@@ -16,6 +16,7 @@
 #endif
 
 #include "server.h"
+#include "server_event.h"
 #include <helper/time_support.h>
 #include <target/target.h>
 #include <target/target_request.h>
@@ -67,6 +68,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = false;
+	c->fd_readable = false;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -87,9 +89,17 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 			(char *)&flag,			/* the cast is historical cruft */
 			sizeof(int));			/* length of option value */
 
+		if (server_event_add(c->fd, &c->fd_readable) != ERROR_OK) {
+			close_socket(c->fd);
+			command_done(c->cmd_ctx);
+			free(c);
+			return ERROR_FAIL;
+		}
+
 		LOG_INFO("accepting '%s' connection on tcp/%s", service->name, service->port);
 		retval = service->new_connection(c);
 		if (retval != ERROR_OK) {
+			server_event_remove(c->fd);
 			close_socket(c->fd);
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
@@ -106,11 +116,14 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 #endif
 
 		/* do not check for new connections again on stdin */
+		server_event_remove(service->fd);
 		service->fd = -1;
+		server_event_add(c->fd, &c->fd_readable);
 
 		LOG_INFO("accepting '%s' connection from pipe", service->name);
 		retval = service->new_connection(c);
 		if (retval != ERROR_OK) {
+			server_event_remove(c->fd);
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
 			free(c);
@@ -119,6 +132,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	} else if (service->type == CONNECTION_PIPE) {
 		c->fd = service->fd;
 		/* do not check for new connections again on stdin */
+		server_event_remove(service->fd);
 		service->fd = -1;
 
 		char *out_file = alloc_printf("%so", service->port);
@@ -131,9 +145,12 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 			return ERROR_FAIL;
 		}
 
+		server_event_add(c->fd, &c->fd_readable);
+
 		LOG_INFO("accepting '%s' connection from pipe %s", service->name, service->port);
 		retval = service->new_connection(c);
 		if (retval != ERROR_OK) {
+			server_event_remove(c->fd);
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
 			free(c);
@@ -161,11 +178,14 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
+			server_event_remove(c->fd);
 			if (service->type == CONNECTION_TCP)
 				close_socket(c->fd);
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
+				c->service->fd_readable = false;
+				server_event_add(c->service->fd, &c->service->fd_readable);
 			}
 
 			command_done(c->cmd_ctx);
@@ -207,6 +227,7 @@ int add_service(const struct service_driver *driver, const char *port,
 	c->port = strdup(port);
 	c->max_connections = 1;	/* Only TCP/IP ports can support more than one connection */
 	c->fd = -1;
+	c->fd_readable = false;
 	c->connections = NULL;
 	c->new_connection_during_keep_alive = driver->new_connection_during_keep_alive_handler;
 	c->new_connection = driver->new_connection_handler;
@@ -328,6 +349,13 @@ int add_service(const struct service_driver *driver, const char *port,
 #endif
 	}
 
+	if (server_event_add(c->fd, &c->fd_readable) != ERROR_OK) {
+		if (c->type != CONNECTION_STDINOUT)
+			close_socket(c->fd);
+		free_service(c);
+		return ERROR_FAIL;
+	}
+
 	/* add to the end of linked list */
 	for (p = &services; *p; p = &(*p)->next)
 		;
@@ -367,6 +395,8 @@ int remove_service(const char *name, const char *port)
 			else
 				prev->next = tmp->next;
 
+			if (tmp->fd != -1)
+				server_event_remove(tmp->fd);
 			if (tmp->type != CONNECTION_STDINOUT)
 				close_socket(tmp->fd);
 
@@ -392,6 +422,8 @@ static int remove_services(void)
 
 		free(c->name);
 
+		if (c->fd != -1)
+			server_event_remove(c->fd);
 		if (c->type == CONNECTION_PIPE) {
 			if (c->fd != -1)
 				close(c->fd);
@@ -424,10 +456,6 @@ int server_loop(struct command_context *command_context)
 
 	bool poll_ok = true;
 
-	/* used in select() */
-	fd_set read_fds;
-	int fd_max;
-
 	/* used in accept() */
 	int retval;
 
@@ -439,85 +467,38 @@ int server_loop(struct command_context *command_context)
 #endif
 
 	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
-		/* monitor sockets for activity */
-		fd_max = 0;
-		FD_ZERO(&read_fds);
-
-		/* add service and connection fds to read_fds */
-		for (service = services; service; service = service->next) {
-			if (service->fd != -1) {
-				/* listen for new connections */
-				FD_SET(service->fd, &read_fds);
-
-				if (service->fd > fd_max)
-					fd_max = service->fd;
-			}
-
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; c = c->next) {
-					/* check for activity on the connection */
-					FD_SET(c->fd, &read_fds);
-					if (c->fd > fd_max)
-						fd_max = c->fd;
-				}
-			}
-		}
-
-		struct timeval tv;
-		tv.tv_sec = 0;
-		if (poll_ok) {
-			/* we're just polling this iteration, this is faster on embedded
-			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
-		} else {
-			/* Timeout socket_select() when a target timer expires or every polling_period */
-			int timeout_ms = next_event - timeval_ms();
-			if (timeout_ms < 0)
+		/* service and connection fds are registered with the event backend
+		 * when they are created, wait for activity on any of them */
+		int timeout_ms = 0;
+		if (!poll_ok) {
+			/* Timeout when a target timer expires or every polling_period */
+			int64_t delay = next_event - timeval_ms();
+			if (delay < 0)
 				timeout_ms = 0;
-			else if (timeout_ms > polling_period)
+			else if (delay > polling_period)
 				timeout_ms = polling_period;
-			tv.tv_usec = timeout_ms * 1000;
-			/* Only while we're sleeping we'll let others run */
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+			else
+				timeout_ms = delay;
 		}
+		/* we're just polling if poll_ok, this is faster on embedded hosts.
+		 * Only while we're sleeping we'll let others run */
+		retval = server_event_wait(timeout_ms);
 
-		if (retval == -1) {
-#ifdef _WIN32
-
-			errno = WSAGetLastError();
-
-			if (errno == WSAEINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
-				return ERROR_FAIL;
-			}
-#else
-
-			if (errno == EINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
-				return ERROR_FAIL;
-			}
-#endif
+		if (retval == -1 && errno != EINTR) {
+			LOG_ERROR("error during select: %s", strerror(errno));
+			return ERROR_FAIL;
 		}
 
 		if (retval == 0) {
 			/* Execute callbacks of expired timers when
 			 * - there was nothing to do if poll_ok was true
-			 * - socket_select() timed out if poll_ok was false, now one or more
-			 *   timers expired or the polling period elapsed
+			 * - server_event_wait() timed out if poll_ok was false, now one or
+			 *   more timers expired or the polling period elapsed
 			 */
 			target_call_timer_callbacks();
 			next_event = target_timer_next_event();
 			process_jim_events(command_context);
 
-			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
-
 			/* We timed out/there was nothing to do, timeout rather than poll next time
 			 **/
 			poll_ok = false;
@@ -535,8 +516,8 @@ int server_loop(struct command_context *command_context)
 
 		for (service = services; service; service = service->next) {
 			/* handle new connections on listeners */
-			if ((service->fd != -1)
-				&& (FD_ISSET(service->fd, &read_fds))) {
+			if ((service->fd != -1) && service->fd_readable) {
+				service->fd_readable = false;
 				if (service->max_connections != 0)
 					add_connection(service, command_context);
 				else {
@@ -560,7 +541,8 @@ int server_loop(struct command_context *command_context)
 				struct connection *c;
 
 				for (c = service->connections; c; ) {
-					if ((c->fd >= 0 && FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
+					if (c->fd_readable || c->input_pending) {
+						c->fd_readable = false;
 						retval = service->input(c);
 						if (retval != ERROR_OK) {
 							struct connection *next = c->next;
@@ -697,6 +679,7 @@ int server_init(struct command_context *cmd_ctx)
 int server_quit(void)
 {
 	remove_services();
+	server_event_quit();
 	target_quit();
 
 #ifdef _WIN32
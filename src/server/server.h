@@ -40,6 +40,7 @@ struct connection {
 	struct command_context *cmd_ctx;
 	struct service *service;
 	bool input_pending;
+	bool fd_readable;	/* set by the event backend when fd has input */
 	void *priv;
 	struct connection *next;
 };
@@ -70,6 +71,7 @@ struct service {
 	char *port;
 	unsigned short portnumber;
 	int fd;
+	bool fd_readable;	/* set by the event backend when fd has input */
 	struct sockaddr_in sin;
 	int max_connections;
 	struct connection *connections;
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "server_event.h"
+#include <helper/log.h>
+#include <helper/replacements.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/* maximum number of events fetched by a single epoll_wait() */
+#define SERVER_EVENT_BATCH	32
+
+struct server_event_reg {
+	int fd;
+	bool *ready;
+	/* fd cannot be watched by epoll (e.g. regular file), always readable */
+	bool always_ready;
+	struct server_event_reg *next;
+};
+
+static struct server_event_reg *registrations;
+
+/* select() backend state; used when epoll is not available */
+static fd_set select_fds;
+static int select_fd_max = -1;
+
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_fd = -1;
+static bool epoll_failed;
+#endif
+
+static bool backend_initialized;
+
+static void server_event_init(void)
+{
+	if (backend_initialized)
+		return;
+
+	FD_ZERO(&select_fds);
+	select_fd_max = -1;
+
+#ifdef HAVE_SYS_EPOLL_H
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		LOG_DEBUG("epoll_create1() failed (%s), using select()", strerror(errno));
+		epoll_failed = true;
+	}
+#endif
+
+	backend_initialized = true;
+	LOG_DEBUG("server event backend: %s", server_event_backend_name());
+}
+
+static bool use_epoll(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	return !epoll_failed;
+#else
+	return false;
+#endif
+}
+
+const char *server_event_backend_name(void)
+{
+	return use_epoll() ? "epoll" : "select";
+}
+
+int server_event_add(int fd, bool *ready)
+{
+	if (fd < 0)
+		return ERROR_FAIL;
+
+	server_event_init();
+
+	struct server_event_reg *reg = calloc(1, sizeof(*reg));
+	if (!reg) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	reg->fd = fd;
+	reg->ready = ready;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (use_epoll()) {
+		struct epoll_event ev = {
+			.events = EPOLLIN,
+			.data.ptr = reg,
+		};
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+			if (errno != EPERM) {
+				LOG_ERROR("epoll_ctl() failed on fd %d: %s", fd, strerror(errno));
+				free(reg);
+				return ERROR_FAIL;
+			}
+			/* select() reports regular files as always readable, do the same */
+			reg->always_ready = true;
+		}
+	}
+#endif
+
+	if (!use_epoll()) {
+		FD_SET(fd, &select_fds);
+		if (fd > select_fd_max)
+			select_fd_max = fd;
+	}
+
+	reg->next = registrations;
+	registrations = reg;
+
+	return ERROR_OK;
+}
+
+void server_event_remove(int fd)
+{
+	struct server_event_reg **p = &registrations;
+
+	while (*p) {
+		struct server_event_reg *reg = *p;
+		if (reg->fd != fd) {
+			p = &reg->next;
+			continue;
+		}
+
+		*p = reg->next;
+#ifdef HAVE_SYS_EPOLL_H
+		if (use_epoll() && !reg->always_ready)
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+		free(reg);
+		break;
+	}
+
+	if (!use_epoll()) {
+		FD_CLR(fd, &select_fds);
+		select_fd_max = -1;
+		for (struct server_event_reg *reg = registrations; reg; reg = reg->next)
+			if (reg->fd > select_fd_max)
+				select_fd_max = reg->fd;
+	}
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static int server_event_wait_epoll(int timeout_ms)
+{
+	struct epoll_event events[SERVER_EVENT_BATCH];
+	int count = 0;
+
+	for (struct server_event_reg *reg = registrations; reg; reg = reg->next) {
+		if (reg->always_ready) {
+			*reg->ready = true;
+			count++;
+		}
+	}
+	if (count)
+		timeout_ms = 0;
+
+	int retval = epoll_wait(epoll_fd, events, ARRAY_SIZE(events), timeout_ms);
+	if (retval == -1)
+		return count ? count : -1;
+
+	for (int i = 0; i < retval; i++) {
+		struct server_event_reg *reg = events[i].data.ptr;
+		/* errors and hang-ups are reported by the following read() */
+		*reg->ready = true;
+	}
+
+	return count + retval;
+}
+#endif
+
+static int server_event_wait_select(int timeout_ms)
+{
+	fd_set read_fds = select_fds;
+	struct timeval tv;
+
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	int retval = socket_select(select_fd_max + 1, &read_fds, NULL, NULL, &tv);
+	if (retval == -1) {
+#ifdef _WIN32
+		errno = WSAGetLastError();
+		if (errno == WSAEINTR)
+			errno = EINTR;
+#endif
+		return -1;
+	}
+
+	/* eCos leaves read_fds unchanged on timeout */
+	if (retval == 0)
+		return 0;
+
+	for (struct server_event_reg *reg = registrations; reg; reg = reg->next)
+		if (FD_ISSET(reg->fd, &read_fds))
+			*reg->ready = true;
+
+	return retval;
+}
+
+int server_event_wait(int timeout_ms)
+{
+	server_event_init();
+
+	if (timeout_ms < 0)
+		timeout_ms = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (use_epoll())
+		return server_event_wait_epoll(timeout_ms);
+#endif
+
+	return server_event_wait_select(timeout_ms);
+}
+
+void server_event_quit(void)
+{
+	while (registrations) {
+		struct server_event_reg *reg = registrations;
+		registrations = reg->next;
+		free(reg);
+	}
+
+	FD_ZERO(&select_fds);
+	select_fd_max = -1;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	epoll_fd = -1;
+	epoll_failed = false;
+#endif
+
+	backend_initialized = false;
+}
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_SERVER_EVENT_H
+#define OPENOCD_SERVER_SERVER_EVENT_H
+
+#include <stdbool.h>
+
+/**
+ * @file
+ * Readiness notification backend used by server_loop().
+ *
+ * File descriptors are registered once, when the service or connection
+ * owning them is created, instead of being collected again on every
+ * iteration of the main loop. On hosts providing epoll() it is used,
+ * otherwise the backend falls back to socket_select().
+ */
+
+/**
+ * Start watching @a fd for input.
+ * @param fd The file descriptor to watch.
+ * @param ready Flag set to true by server_event_wait() each time @a fd
+ * becomes readable. It is never cleared by the backend.
+ * @returns ERROR_OK on success, or ERROR_FAIL.
+ */
+int server_event_add(int fd, bool *ready);
+
+/** Stop watching @a fd; call it before the descriptor is closed. */
+void server_event_remove(int fd);
+
+/**
+ * Wait until at least one registered descriptor is readable or the
+ * timeout expires.
+ * @param timeout_ms Maximum time to wait, zero to just poll.
+ * @returns Number of readable descriptors, 0 on timeout, or -1 with
+ * errno set (EINTR when interrupted by a signal).
+ */
+int server_event_wait(int timeout_ms);
+
+/** Release every registration and the backend resources. */
+void server_event_quit(void);
+
+/** @returns The name of the backend in use, for diagnostics. */
+const char *server_event_backend_name(void);
+
+#endif /* OPENOCD_SERVER_SERVER_EVENT_H */
@@ -979,6 +979,27 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
+/*
+ * Like svf_execute_tap(), but when no TDO is to be checked the queue is only
+ * submitted: the file is parsed further while the adapter executes it. The
+ * scans copy their TDI data, so the buffers can be reused at once.
+ */
+static int svf_commit_tap(void)
+{
+	if (svf_nil)
+		return svf_execute_tap();
+
+	for (int i = 0; i < svf_check_tdo_para_index; i++)
+		if (svf_check_tdo_para[i].enabled)
+			return svf_execute_tap();
+
+	jtag_submit_queue();
+	svf_check_tdo_para_index = 0;
+	svf_buffer_index = 0;
+
+	return ERROR_OK;
+}
+
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
 	char *argus[256], command;
@@ -1623,7 +1644,7 @@ xxr_common:
 				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) &&
 				(((command != STATE) && (command != RUNTEST)) ||
 						((command == STATE) && (num_of_argu == 2))))
-			return svf_execute_tap();
+			return svf_commit_tap();
 	}
 
 	return ERROR_OK;
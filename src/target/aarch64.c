@@ -123,6 +123,7 @@ static int aarch64_mmu_modify(struct target *target, int enable)
 {
 	struct aarch64_common *aarch64 = target_to_aarch64(target);
 	struct armv8_common *armv8 = &aarch64->armv8_common;
+	uint32_t sctlr = aarch64->system_control_reg_curr;
 	int retval = ERROR_OK;
 	enum arm_mode target_mode = ARM_MODE_ANY;
 	uint32_t instr = 0;
@@ -188,6 +189,10 @@ static int aarch64_mmu_modify(struct target *target, int enable)
 	if (target_mode != ARM_MODE_ANY)
 		armv8_dpm_modeswitch(&armv8->dpm, ARM_MODE_ANY);
 
+	/* translations done with the MMU in the other state are stale */
+	if (aarch64->system_control_reg_curr != sctlr)
+		arm_tlb_flush(armv8->arm.tlb);
+
 	return retval;
 }
 
@@ -1065,6 +1070,9 @@ static int aarch64_post_debug_entry(struct target *target)
 	LOG_DEBUG("System_register: %8.8" PRIx32, aarch64->system_control_reg);
 	aarch64->system_control_reg_curr = aarch64->system_control_reg;
 
+	/* the core ran, forget what it had mapped */
+	arm_tlb_flush(armv8->arm.tlb);
+
 	if (armv8->armv8_mmu.armv8_cache.info == -1) {
 		armv8_identify_cache(armv8);
 		armv8_read_mpidr(armv8);
@@ -1217,6 +1225,9 @@ static int aarch64_restore_context(struct target *target, bool bpwp)
 		register_cache_invalidate(arm->core_cache->next);
 	}
 
+	/* the core is about to run and may remap its memory */
+	arm_tlb_flush(arm->tlb);
+
 	return retval;
 }
 
@@ -2480,6 +2491,207 @@ static int aarch64_read_cpu_memory(struct target *target,
 	return ERROR_OK;
 }
 
+/*
+ * Bulk memory transfers of a halted core can bypass the core and its DCC,
+ * through the system MEM-AP (AXI-AP or AHB-AP). The data cache is flushed to
+ * the point of coherency first, and virtual addresses are translated by the
+ * core a page at a time.
+ */
+#define AARCH64_MEMORY_AP_PAGE	0x1000
+
+static bool aarch64_memory_ap_usable(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, bool virt)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	struct adiv5_ap *ap = aarch64->memory_ap;
+	bool core_ns, ap_ns;
+
+	if (!ap || !aarch64->memory_ap_threshold || target->state != TARGET_HALTED)
+		return false;
+
+	if ((uint64_t)size * count < aarch64->memory_ap_threshold || (address & (size - 1)))
+		return false;
+
+	/* address translation uses the AArch64 AT instructions */
+	if (virt && !armv8->is_armv8r && armv8->arm.core_state != ARM_STATE_AARCH64)
+		return false;
+
+	/*
+	 * The cache is cleaned by VA, which reaches the caches of all the cores
+	 * of the shareability domain. A physical transfer has no VA to clean by,
+	 * and set/way operations only act on the caches of this core.
+	 */
+	if (!virt && armv8->armv8_mmu.armv8_cache.d_u_cache_enabled)
+		return false;
+
+	/* the MEM-AP must access the same physical address space as the core */
+	core_ns = armv8->dpm.dscr & DSCR_NON_SECURE;
+	switch (aarch64->memory_ap_type) {
+	case AP_TYPE_AXI_AP:
+	case AP_TYPE_AXI5_AP:
+		ap_ns = ap->csw_default & CSW_AXI_ARPROT1_NONSEC;
+		break;
+	case AP_TYPE_AHB5_AP:
+	case AP_TYPE_AHB5H_AP:
+		ap_ns = ap->csw_default & CSW_AHB_SPROT;
+		break;
+	default:
+		return true;
+	}
+
+	return core_ns == ap_ns;
+}
+
+/* Cleans and invalidates the data cache lines of the range to the point of coherency */
+static int aarch64_memory_ap_flush(struct target *target, target_addr_t va,
+	uint32_t nbytes, bool virt)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+
+	/* physical transfers are only done with the data cache off */
+	if (!virt || !armv8->armv8_mmu.armv8_cache.d_u_cache_enabled)
+		return ERROR_OK;
+
+	/* DC CIVAC is broadcast to the other cores of an SMP group */
+	return armv8_cache_d_inner_flush_virt(armv8, va, nbytes);
+}
+
+static int aarch64_memory_ap_translate(struct target *target, target_addr_t va,
+	target_addr_t *pa)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+
+	if (armv8->is_armv8r || (!armv8->armv8_mmu.mmu_enabled &&
+			armv8_curel_from_core_mode(armv8->arm.core_mode) >= SYSTEM_CUREL_EL2)) {
+		/* flat mapping, no stage 2 either */
+		*pa = va;
+		return ERROR_OK;
+	}
+
+	/* the translations are cached in the TLB of the arm */
+	return armv8_mmu_translate_va_pa(target, va, pa, 0);
+}
+
+/* Physical address and object count of the next transfer, up to the end of the page */
+static int aarch64_memory_ap_chunk(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, bool virt, target_addr_t *pa, uint32_t *n)
+{
+	if (!virt) {
+		*pa = address;
+		*n = count;
+		return ERROR_OK;
+	}
+
+	*n = MIN(count, (AARCH64_MEMORY_AP_PAGE - (address & (AARCH64_MEMORY_AP_PAGE - 1))) / size);
+	return aarch64_memory_ap_translate(target, address, pa);
+}
+
+static int aarch64_read_memory_ap(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint8_t *buffer, bool virt)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	target_addr_t pa;
+	uint32_t n;
+	int retval;
+
+	retval = aarch64_memory_ap_flush(target, address, size * count, virt);
+
+	while (retval == ERROR_OK && count) {
+		retval = aarch64_memory_ap_chunk(target, address, size, count, virt, &pa, &n);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_buf(aarch64->memory_ap, buffer, size, n, pa);
+		address += n * size;
+		buffer += n * size;
+		count -= n;
+	}
+
+	return retval;
+}
+
+static int aarch64_write_memory_ap(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, const uint8_t *buffer, bool virt)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	target_addr_t pa;
+	uint32_t n;
+	int retval;
+
+	/* no dirty line may be evicted over the new data later */
+	retval = aarch64_memory_ap_flush(target, address, size * count, virt);
+
+	while (retval == ERROR_OK && count) {
+		retval = aarch64_memory_ap_chunk(target, address, size, count, virt, &pa, &n);
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_buf(aarch64->memory_ap, buffer, size, n, pa);
+		address += n * size;
+		buffer += n * size;
+		count -= n;
+	}
+
+	return retval;
+}
+
+/*
+ * Look for a system MEM-AP on the DAP of the core, an AXI-AP if possible.
+ * As dap_find_get_ap(), each IDR is read in its own run and an AP failing
+ * the read is skipped.
+ */
+static void aarch64_find_memory_ap(struct target *target)
+{
+	static const enum ap_type types[] = {
+		AP_TYPE_AXI_AP, AP_TYPE_AXI5_AP, AP_TYPE_AHB5H_AP, AP_TYPE_AHB5_AP, AP_TYPE_AHB3_AP,
+	};
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct adiv5_dap *dap = aarch64->armv8_common.debug_ap->dap;
+	unsigned int best = ARRAY_SIZE(types);
+	uint64_t best_ap_num = DP_APSEL_INVALID;
+
+	/* ADIv6 APs are not enumerable without a ROM table walk */
+	if (is_adiv6(dap))
+		return;
+
+	/* stop at the first AP of the preferred type */
+	for (unsigned int ap_num = 0; ap_num <= DP_APSEL_MAX && best; ap_num++) {
+		struct adiv5_ap *ap = dap_get_ap(dap, ap_num);
+		if (!ap)
+			continue;
+
+		uint32_t idr = 0;
+		int retval = dap_queue_ap_read(ap, AP_REG_IDR(dap), &idr);
+		if (retval == ERROR_OK)
+			retval = dap_run(dap);
+		dap_put_ap(ap);
+		if (retval != ERROR_OK)
+			continue;
+
+		for (unsigned int i = 0; i < best; i++) {
+			if ((idr & AP_TYPE_MASK) == types[i]) {
+				best = i;
+				best_ap_num = ap_num;
+			}
+		}
+	}
+
+	if (best == ARRAY_SIZE(types)) {
+		LOG_TARGET_DEBUG(target, "no system MEM-AP found");
+		return;
+	}
+
+	struct adiv5_ap *ap = dap_get_ap(dap, best_ap_num);
+	if (!ap)
+		return;
+
+	if (mem_ap_init(ap) != ERROR_OK) {
+		dap_put_ap(ap);
+		return;
+	}
+
+	aarch64->memory_ap = ap;
+	aarch64->memory_ap_type = types[best];
+	LOG_TARGET_DEBUG(target, "bulk memory transfers through MEM-AP #0x%" PRIx64, best_ap_num);
+}
+
 static int aarch64_read_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, uint8_t *buffer)
@@ -2487,6 +2699,13 @@ static int aarch64_read_phys_memory(struct target *target,
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		if (aarch64_memory_ap_usable(target, address, size, count, false)) {
+			retval = aarch64_read_memory_ap(target, address, size, count, buffer, false);
+			if (retval == ERROR_OK)
+				return retval;
+			LOG_TARGET_DEBUG(target, "MEM-AP read failed, retrying through the core");
+		}
+
 		/* read memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2513,6 +2732,14 @@ static int aarch64_read_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
+
+	if (aarch64_memory_ap_usable(target, address, size, count, true)) {
+		retval = aarch64_read_memory_ap(target, address, size, count, buffer, true);
+		if (retval == ERROR_OK)
+			return retval;
+		LOG_TARGET_DEBUG(target, "MEM-AP read failed, retrying through the core");
+	}
+
 	return aarch64_read_cpu_memory(target, address, size, count, buffer);
 }
 
@@ -2523,6 +2750,13 @@ static int aarch64_write_phys_memory(struct target *target,
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		if (aarch64_memory_ap_usable(target, address, size, count, false)) {
+			retval = aarch64_write_memory_ap(target, address, size, count, buffer, false);
+			if (retval == ERROR_OK)
+				return retval;
+			LOG_TARGET_DEBUG(target, "MEM-AP write failed, retrying through the core");
+		}
+
 		/* write memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2550,6 +2784,14 @@ static int aarch64_write_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
+
+	if (aarch64_memory_ap_usable(target, address, size, count, true)) {
+		retval = aarch64_write_memory_ap(target, address, size, count, buffer, true);
+		if (retval == ERROR_OK)
+			return retval;
+		LOG_TARGET_DEBUG(target, "MEM-AP write failed, retrying through the core");
+	}
+
 	return aarch64_write_cpu_memory(target, address, size, count, buffer);
 }
 
@@ -2626,6 +2868,9 @@ static int aarch64_examine_first(struct target *target)
 
 	armv8->debug_ap->memaccess_tck = 10;
 
+	if (!aarch64->memory_ap)
+		aarch64_find_memory_ap(target);
+
 	if (!target->dbgbase_set) {
 		/* Lookup Processor DAP */
 		retval = dap_lookup_cs_component(armv8->debug_ap, ARM_CS_C9_DEVTYPE_CORE_DEBUG,
@@ -2770,6 +3015,7 @@ static int aarch64_init_arch_info(struct target *target,
 	/* Setup struct aarch64_common */
 	aarch64->common_magic = AARCH64_COMMON_MAGIC;
 	armv8->arm.dap = dap;
+	aarch64->memory_ap_threshold = AARCH64_MEMORY_AP_THRESHOLD;
 
 	/* register arch-specific functions */
 	armv8->examine_debug_reason = NULL;
@@ -2830,6 +3076,8 @@ static void aarch64_deinit_target(struct target *target)
 
 	if (armv8->debug_ap)
 		dap_put_ap(armv8->debug_ap);
+	if (aarch64->memory_ap)
+		dap_put_ap(aarch64->memory_ap);
 
 	armv8_free_reg_cache(target);
 	free(aarch64->brp_list);
@@ -3035,6 +3283,33 @@ COMMAND_HANDLER(aarch64_mask_interrupts_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(aarch64_memap_bulk_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "off"))
+			aarch64->memory_ap_threshold = 0;
+		else
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], aarch64->memory_ap_threshold);
+	}
+
+	if (!aarch64->memory_ap_threshold)
+		command_print(CMD, "aarch64 MEM-AP bulk transfers off");
+	else if (!aarch64->memory_ap)
+		command_print(CMD, "aarch64 MEM-AP bulk transfers from %" PRIu32 " bytes, no MEM-AP found",
+			aarch64->memory_ap_threshold);
+	else
+		command_print(CMD, "aarch64 MEM-AP bulk transfers from %" PRIu32 " bytes through AP #0x%" PRIx64,
+			aarch64->memory_ap_threshold, aarch64->memory_ap->ap_num);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(aarch64_mcrmrc_command)
 {
 	bool is_mcr = false;
@@ -3139,6 +3414,9 @@ COMMAND_HANDLER(aarch64_mcrmrc_command)
 }
 
 static const struct command_registration aarch64_exec_command_handlers[] = {
+	{
+		.chain = arm_tlb_command_handlers,
+	},
 	{
 		.name = "cache_info",
 		.handler = aarch64_handle_cache_info_command,
@@ -3167,6 +3445,14 @@ static const struct command_registration aarch64_exec_command_handlers[] = {
 		.help = "mask aarch64 interrupts during single-step",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "memap_bulk",
+		.handler = aarch64_memap_bulk_command,
+		.mode = COMMAND_ANY,
+		.help = "set the size from which memory transfers bypass the core "
+			"through the system MEM-AP",
+		.usage = "['off'|min_bytes]",
+	},
 	{
 		.name = "mcr",
 		.mode = COMMAND_EXEC,
@@ -24,6 +24,9 @@
 
 #define AARCH64_PADDRDBG_CPU_SHIFT 13
 
+/* default size from which memory transfers go through the system MEM-AP */
+#define AARCH64_MEMORY_AP_THRESHOLD 1024
+
 enum aarch64_isrmasking_mode {
 	AARCH64_ISRMASK_OFF,
 	AARCH64_ISRMASK_ON,
@@ -58,6 +61,12 @@ struct aarch64_common {
 	struct aarch64_brp *wp_list;
 
 	enum aarch64_isrmasking_mode isrmasking_mode;
+
+	/* System MEM-AP used for bulk memory transfers, NULL if none */
+	struct adiv5_ap *memory_ap;
+	enum ap_type memory_ap_type;
+	/* transfers of at least this many bytes use the memory_ap, 0 never */
+	uint32_t memory_ap_threshold;
 };
 
 static inline struct aarch64_common *
@@ -210,6 +210,9 @@ struct arm {
 	/** Handle for the debug module, if one is present. */
 	struct arm_dpm *dpm;
 
+	/** Cache of VA to PA translations, if the core has an MMU. */
+	struct arm_tlb *tlb;
+
 	/** Handle for the Embedded Trace Module, if one is present. */
 	struct etm_context *etm;
 
@@ -102,6 +102,8 @@ static int mem_ap_setup_csw(struct adiv5_ap *ap, uint32_t csw)
 			return retval;
 		}
 		ap->csw_value = csw;
+	} else {
+		ap->dap->stats.csw_elided++;
 	}
 	return ERROR_OK;
 }
@@ -115,6 +117,8 @@ static int mem_ap_setup_tar(struct adiv5_ap *ap, target_addr_t tar)
 			/* See if bits 63:32 of tar is different from last setting */
 			if (!ap->tar_valid || (ap->tar_value >> 32) != (tar >> 32))
 				retval = dap_queue_ap_write(ap, MEM_AP_REG_TAR64(ap->dap), (uint32_t)(tar >> 32));
+			else
+				ap->dap->stats.tar_elided++;
 		}
 		if (retval != ERROR_OK) {
 			ap->tar_valid = false;
@@ -122,6 +126,8 @@ static int mem_ap_setup_tar(struct adiv5_ap *ap, target_addr_t tar)
 		}
 		ap->tar_value = tar;
 		ap->tar_valid = true;
+	} else {
+		ap->dap->stats.tar_elided += is_64bit_ap(ap) ? 2 : 1;
 	}
 	return ERROR_OK;
 }
@@ -187,6 +193,21 @@ static void mem_ap_update_tar_cache(struct adiv5_ap *ap)
 		ap->tar_value += inc;
 }
 
+/**
+ * Check whether TAR already holds the address of a word which is not the
+ * first of its 16 byte block, e.g. after an auto-incremented access to the
+ * previous word. The banked data registers would need a TAR write to the
+ * start of the block, while DRW reaches the word as it is.
+ */
+static bool mem_ap_tar_at_word(struct adiv5_ap *ap, target_addr_t address)
+{
+	if (!ap->tar_valid || ap->tar_value != address || !(address & 0xC))
+		return false;
+
+	ap->dap->stats.tar_elided += is_64bit_ap(ap) ? 2 : 1;
+	return true;
+}
+
 /**
  * Queue transactions setting up transfer parameters for the
  * currently selected MEM-AP.
@@ -232,6 +253,17 @@ int mem_ap_read_u32(struct adiv5_ap *ap, target_addr_t address,
 {
 	int retval;
 
+	if (mem_ap_tar_at_word(ap, address)) {
+		retval = mem_ap_setup_csw(ap, CSW_32BIT | (ap->csw_value & CSW_ADDRINC_MASK));
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(ap->dap), value);
+		if (retval == ERROR_OK)
+			mem_ap_update_tar_cache(ap);
+		return retval;
+	}
+
 	/* Use banked addressing (REG_BDx) to avoid some link traffic
 	 * (updating TAR) when reading several consecutive addresses.
 	 */
@@ -284,6 +316,17 @@ int mem_ap_write_u32(struct adiv5_ap *ap, target_addr_t address,
 {
 	int retval;
 
+	if (mem_ap_tar_at_word(ap, address)) {
+		retval = mem_ap_setup_csw(ap, CSW_32BIT | (ap->csw_value & CSW_ADDRINC_MASK));
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW(ap->dap), value);
+		if (retval == ERROR_OK)
+			mem_ap_update_tar_cache(ap);
+		return retval;
+	}
+
 	/* Use banked addressing (REG_BDx) to avoid some link traffic
 	 * (updating TAR) when writing several consecutive addresses.
 	 */
@@ -320,7 +363,7 @@ int mem_ap_write_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
 }
 
 /**
- * Synchronous write of a block of memory, using a specific access size.
+ * Queue the transfers writing a block of memory, using a specific access size.
  *
  * @param ap The MEM-AP to access.
  * @param buffer The data buffer to write. No particular alignment is assumed.
@@ -329,9 +372,9 @@ int mem_ap_write_atomic_u32(struct adiv5_ap *ap, target_addr_t address,
  * @param address Address to be written; it must be writable by the currently selected MEM-AP.
  * @param addrinc Whether the target address should be increased for each write or not. This
  *  should normally be true, except when writing to e.g. a FIFO.
- * @return ERROR_OK on success, otherwise an error code.
+ * @return ERROR_OK if the transfers were queued, otherwise an error code.
  */
-static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+static int mem_ap_queue_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
 		target_addr_t address, bool addrinc)
 {
 	struct adiv5_dap *dap = ap->dap;
@@ -454,41 +497,70 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 			address += this_size;
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
+	return retval;
+}
+
+/* Log where a failed block write stopped */
+static void mem_ap_write_failed(struct adiv5_ap *ap)
+{
+	target_addr_t tar;
+	if (mem_ap_read_tar(ap, &tar) == ERROR_OK)
+		LOG_ERROR("Failed to write memory at " TARGET_ADDR_FMT, tar);
+	else
+		LOG_ERROR("Failed to write memory and, additionally, failed to find out where");
+}
+
+/**
+ * Synchronous write of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of writes to do (in size units, not bytes).
+ * @param address Where to start writing; it must be writable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased for each write or not. This
+ *  should normally be true, except when writing to e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
+{
+	int retval = mem_ap_queue_write(ap, buffer, size, count, address, addrinc);
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS)
+		return retval;
+
 	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+		retval = dap_run(ap->dap);
 
-	if (retval != ERROR_OK) {
-		target_addr_t tar;
-		if (mem_ap_read_tar(ap, &tar) == ERROR_OK)
-			LOG_ERROR("Failed to write memory at " TARGET_ADDR_FMT, tar);
-		else
-			LOG_ERROR("Failed to write memory and, additionally, failed to find out where");
-	}
+	if (retval != ERROR_OK)
+		mem_ap_write_failed(ap);
 
 	return retval;
 }
 
 /**
- * Synchronous read of a block of memory, using a specific access size.
+ * Queue the transfers reading a block of memory, using a specific access size.
+ * Each transfer stores the entire DRW word in the read buffer. How many useful
+ * bytes it contains, and their location in the word, depends on the type of
+ * transfer and alignment, see mem_ap_unpack_read().
  *
  * @param ap The MEM-AP to access.
- * @param buffer The data buffer to receive the data. No particular alignment is assumed.
+ * @param read_buf Where the DRW words are stored, room for count words.
  * @param size Which access size to use, in bytes. 1, 2 or 4.
  * @param count The number of reads to do (in size units, not bytes).
- * @param adr Address to be read; it must be readable by the currently selected MEM-AP.
+ * @param address Where to start reading; it must be readable by the currently selected MEM-AP.
  * @param addrinc Whether the target address should be increased after each read or not. This
  *  should normally be true, except when reading from e.g. a FIFO.
- * @return ERROR_OK on success, otherwise an error code.
+ * @return ERROR_OK if the transfers were queued, otherwise an error code.
  */
-static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
-		target_addr_t adr, bool addrinc)
+static int mem_ap_queue_read(struct adiv5_ap *ap, uint32_t *read_buf, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
 {
 	struct adiv5_dap *dap = ap->dap;
 	size_t nbytes = size * count;
 	const uint32_t csw_addrincr = addrinc ? CSW_ADDRINC_SINGLE : CSW_ADDRINC_OFF;
 	uint32_t csw_size;
-	target_addr_t address = adr;
+	uint32_t *read_ptr = read_buf;
 	int retval = ERROR_OK;
 
 	/* TI BE-32 Quirks mode:
@@ -507,23 +579,9 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	else
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	if (ap->unaligned_access_bad && (adr % size != 0))
+	if (ap->unaligned_access_bad && (address % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
-	 * over-allocation if packed transfers are going to be used, but determining the real need at
-	 * this point would be messy. */
-	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
-	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
-	if (!read_buf) {
-		LOG_ERROR("Failed to allocate read buffer");
-		return ERROR_FAIL;
-	}
-
-	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
-	 * useful bytes it contains, and their location in the word, depends on the type of transfer
-	 * and alignment. */
 	while (nbytes > 0) {
 		uint32_t this_size = size;
 
@@ -553,30 +611,22 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		mem_ap_update_tar_cache(ap);
 	}
 
-	if (retval == ERROR_OK)
-		retval = dap_run(dap);
-
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
+	return retval;
+}
 
-	/* If something failed, read TAR to find out how much data was successfully read, so we can
-	 * at least give the caller what we have. */
-	if (retval != ERROR_OK) {
-		target_addr_t tar;
-		if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
-			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
-			LOG_ERROR("Failed to read memory at " TARGET_ADDR_FMT, tar);
-			if (nbytes > tar - address)
-				nbytes = tar - address;
-		} else {
-			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
-			nbytes = 0;
-		}
-	}
+/**
+ * Populate the caller's buffer from the DRW words of a block read queued by
+ * mem_ap_queue_read() with the same parameters, taking each byte from the
+ * correct word and byte lane.
+ *
+ * @param nbytes How many bytes to copy, less than size * count if the
+ *  transfer stopped early.
+ */
+static void mem_ap_unpack_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, size_t nbytes,
+		target_addr_t address, bool addrinc, const uint32_t *read_ptr)
+{
+	struct adiv5_dap *dap = ap->dap;
 
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
 	while (nbytes > 0) {
 		uint32_t this_size = size;
 
@@ -614,6 +664,69 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		read_ptr++;
 		nbytes -= this_size;
 	}
+}
+
+/**
+ * After a failed block read, read TAR to find out how much data was
+ * successfully read, so we can at least give the caller what we have.
+ *
+ * @return the number of bytes from address which were read, at most nbytes.
+ */
+static size_t mem_ap_read_failed(struct adiv5_ap *ap, target_addr_t address, size_t nbytes)
+{
+	target_addr_t tar;
+	if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
+		/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
+		LOG_ERROR("Failed to read memory at " TARGET_ADDR_FMT, tar);
+		if (nbytes > tar - address)
+			nbytes = tar - address;
+	} else {
+		LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
+		nbytes = 0;
+	}
+	return nbytes;
+}
+
+/**
+ * Synchronous read of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to receive the data. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of reads to do (in size units, not bytes).
+ * @param adr Address to be read; it must be readable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased after each read or not. This
+ *  should normally be true, except when reading from e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t adr, bool addrinc)
+{
+	size_t nbytes = size * count;
+
+	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
+	 * over-allocation if packed transfers are going to be used, but determining the real need at
+	 * this point would be messy. */
+	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
+	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
+	if (!read_buf) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	int retval = mem_ap_queue_read(ap, read_buf, size, count, adr, addrinc);
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS) {
+		free(read_buf);
+		return retval;
+	}
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	if (retval != ERROR_OK)
+		nbytes = mem_ap_read_failed(ap, adr, nbytes);
+
+	mem_ap_unpack_read(ap, buffer, size, nbytes, adr, addrinc, read_buf);
 
 	free(read_buf);
 	return retval;
@@ -643,6 +756,177 @@ int mem_ap_write_buf_noincr(struct adiv5_ap *ap,
 	return mem_ap_write(ap, buffer, size, count, address, false);
 }
 
+/* A run of transfers of one size, part of a byte range transfer */
+struct mem_ap_chunk {
+	uint32_t size;
+	uint32_t count;
+};
+
+#define MEM_AP_MAX_CHUNKS 5
+
+/**
+ * Split a byte range into runs of transfers of one size, as few DAP
+ * transactions as possible. Every run costs a CSW write and one DRW
+ * access per word.
+ *
+ * The natural split uses 32-bit transfers for the aligned bulk of the
+ * range and up to two 8 and 16-bit runs for each unaligned end. If the
+ * MEM-AP supports packed transfers, an unaligned range can also be
+ * streamed with 8 or 16-bit packed transfers, four bytes per DRW access
+ * whatever the alignment, which saves the CSW writes of the ends. It only
+ * loses some transfers at each TAR auto-increment boundary.
+ *
+ * @return the number of chunks, at most MEM_AP_MAX_CHUNKS.
+ */
+static unsigned int mem_ap_plan_bytes(struct adiv5_ap *ap, target_addr_t address, uint32_t count,
+		struct mem_ap_chunk *chunks)
+{
+	target_addr_t start = address;
+	uint32_t total = count;
+	unsigned int n = 0;
+	uint32_t size;
+	uint64_t cost = 0;
+
+	/* Align up to 4 bytes. The loop condition makes sure the next pass
+	 * will have something to do with the size we leave to it. */
+	for (size = 1; size < 4 && count >= size * 2 + (address & size); size *= 2) {
+		if (address & size) {
+			chunks[n++] = (struct mem_ap_chunk){ .size = size, .count = 1 };
+			address += size;
+			count -= size;
+		}
+	}
+
+	for (; size > 0; size /= 2) {
+		uint32_t aligned = count - count % size;
+		if (aligned > 0) {
+			chunks[n++] = (struct mem_ap_chunk){ .size = size, .count = aligned / size };
+			count -= aligned;
+		}
+	}
+
+	for (unsigned int i = 0; i < n; i++)
+		cost += 1 + chunks[i].count;
+
+	if (!ap->packed_transfers || !(start & 3) || total < 4)
+		return n;
+
+	/* One packed run, with single transfers for the last bytes
+	 * and around each TAR block boundary */
+	uint32_t packed_size = (start & 1) ? 1 : 2;
+	uint32_t packed = total - total % packed_size;
+	uint64_t boundaries = ((start + total - 1) / ap->tar_autoincr_block)
+		- (start / ap->tar_autoincr_block);
+	uint64_t packed_cost = 1 + total / 4 + boundaries * (2 + 4 / packed_size);
+	if (packed % 4)
+		packed_cost += 1 + (packed % 4) / packed_size;
+	if (packed != total)
+		packed_cost += 2;
+
+	if (packed_cost >= cost)
+		return n;
+
+	n = 0;
+	chunks[n++] = (struct mem_ap_chunk){ .size = packed_size, .count = packed / packed_size };
+	if (packed != total)
+		chunks[n++] = (struct mem_ap_chunk){ .size = 1, .count = 1 };
+	return n;
+}
+
+/**
+ * Synchronous read of a range of bytes, with the access sizes left to the
+ * MEM-AP layer. All transfers are queued at once, see mem_ap_plan_bytes().
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to receive the data. No particular alignment is assumed.
+ * @param count The number of bytes to read.
+ * @param address Where to start reading; it must be readable by the currently selected MEM-AP.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+int mem_ap_read_bytes(struct adiv5_ap *ap, uint8_t *buffer, uint32_t count, target_addr_t address)
+{
+	struct mem_ap_chunk chunks[MEM_AP_MAX_CHUNKS];
+	unsigned int n = mem_ap_plan_bytes(ap, address, count, chunks);
+	uint32_t words = 0;
+
+	for (unsigned int i = 0; i < n; i++)
+		words += chunks[i].count;
+
+	uint32_t *read_buf = calloc(words, sizeof(uint32_t));
+	if (!read_buf) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	int retval = ERROR_OK;
+	uint32_t *read_ptr = read_buf;
+	target_addr_t chunk_address = address;
+	for (unsigned int i = 0; i < n && retval == ERROR_OK; i++) {
+		retval = mem_ap_queue_read(ap, read_ptr, chunks[i].size, chunks[i].count,
+				chunk_address, true);
+		read_ptr += chunks[i].count;
+		chunk_address += chunks[i].size * chunks[i].count;
+	}
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS) {
+		free(read_buf);
+		return retval;
+	}
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	size_t nbytes = count;
+	if (retval != ERROR_OK)
+		nbytes = mem_ap_read_failed(ap, address, nbytes);
+
+	read_ptr = read_buf;
+	for (unsigned int i = 0; i < n && nbytes > 0; i++) {
+		size_t chunk_bytes = MIN(nbytes, (size_t)chunks[i].size * chunks[i].count);
+		mem_ap_unpack_read(ap, buffer, chunks[i].size, chunk_bytes, address, true, read_ptr);
+		read_ptr += chunks[i].count;
+		buffer += chunk_bytes;
+		address += chunk_bytes;
+		nbytes -= chunk_bytes;
+	}
+
+	free(read_buf);
+	return retval;
+}
+
+/**
+ * Synchronous write of a range of bytes, with the access sizes left to the
+ * MEM-AP layer. All transfers are queued at once, see mem_ap_plan_bytes().
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param count The number of bytes to write.
+ * @param address Where to start writing; it must be writable by the currently selected MEM-AP.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+int mem_ap_write_bytes(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t count, target_addr_t address)
+{
+	struct mem_ap_chunk chunks[MEM_AP_MAX_CHUNKS];
+	unsigned int n = mem_ap_plan_bytes(ap, address, count, chunks);
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < n && retval == ERROR_OK; i++) {
+		uint32_t chunk_bytes = chunks[i].size * chunks[i].count;
+		retval = mem_ap_queue_write(ap, buffer, chunks[i].size, chunks[i].count, address, true);
+		buffer += chunk_bytes;
+		address += chunk_bytes;
+	}
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS)
+		return retval;
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	if (retval != ERROR_OK)
+		mem_ap_write_failed(ap);
+
+	return retval;
+}
+
 /*--------------------------------------------------------------------------*/
 
 
@@ -657,6 +941,7 @@ void dap_invalidate_cache(struct adiv5_dap *dap)
 {
 	dap->select = DP_SELECT_INVALID;
 	dap->last_read = NULL;
+	dap->queue_empty = false;
 
 	int i;
 	for (i = 0; i <= DP_APSEL_MAX; i++) {
@@ -773,6 +1058,69 @@ int dap_dp_init_or_reconnect(struct adiv5_dap *dap)
 	}
 }
 
+/**
+ * Find out where TAR auto-increment wraps on this MEM-AP. The ARM ADI spec
+ * only guarantees the ten low bits of TAR to increment, and the rest is
+ * implementation defined. The probe reads the last word of the CoreSight
+ * component at the MEM-AP base address, CIDR3, which has no side effects,
+ * with auto-increment and reads back TAR. A component is 4 kB aligned, so
+ * TAR either carried into bit 12 or wrapped back by the block size.
+ * The configured block size is kept if the MEM-AP has no such component or
+ * the result makes no sense.
+ */
+static int mem_ap_probe_tar_autoincr_block(struct adiv5_ap *ap)
+{
+	struct adiv5_dap *dap = ap->dap;
+	uint32_t base_lower, base_upper = 0, cidr3;
+	target_addr_t base, tar;
+	int retval;
+
+	/* 32-bit reads are byte swapped too */
+	if (dap->ti_be_32_quirks)
+		return ERROR_OK;
+
+	retval = dap_queue_ap_read(ap, MEM_AP_REG_BASE(dap), &base_lower);
+	if (retval == ERROR_OK && is_64bit_ap(ap))
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_BASE64(dap), &base_upper);
+	if (retval == ERROR_OK)
+		retval = dap_run(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Entry present, ADIv5 format */
+	if ((base_lower & 0x3) != 0x3 || base_lower == 0xFFFFFFFF)
+		return ERROR_OK;
+	base = ((((target_addr_t)base_upper) << 32) | base_lower) & 0xFFFFFFFFFFFFF000ull;
+
+	retval = mem_ap_setup_transfer(ap, CSW_32BIT | CSW_ADDRINC_SINGLE, base + ARM_CS_CIDR3);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), &cidr3);
+	if (retval != ERROR_OK)
+		return retval;
+	ap->tar_valid = false;
+	retval = mem_ap_read_tar(ap, &tar);
+	if (retval != ERROR_OK) {
+		/* Not a reason to give up on the MEM-AP */
+		LOG_DEBUG("MEM_AP TAR auto-increment probe failed");
+		return ERROR_OK;
+	}
+
+	if (cidr3 != 0xB1)
+		return ERROR_OK;
+
+	target_addr_t block = base + 0x1000 - tar;
+	if (tar == base + 0x1000)
+		/* Carried beyond the component; not worth a second probe */
+		block = 0x1000;
+	else if (tar > base + 0x1000 || block < 0x400 || block > 0x1000 || !IS_PWR_OF_2(block))
+		return ERROR_OK;
+
+	ap->tar_autoincr_block = block;
+	LOG_DEBUG("MEM_AP TAR auto-increment block: %" PRIu32 " bytes", ap->tar_autoincr_block);
+	return ERROR_OK;
+}
+
 /**
  * Initialize a DAP.  This sets up the power domains, prepares the DP
  * for further use, and arranges to use AP #0 for all AP operations
@@ -825,6 +1173,10 @@ int mem_ap_init(struct adiv5_ap *ap)
 	LOG_DEBUG("MEM_AP Packed Transfers: %s",
 			ap->packed_transfers ? "enabled" : "disabled");
 
+	retval = mem_ap_probe_tar_autoincr_block(ap);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* The ARM ADI spec leaves implementation-defined whether unaligned
 	 * memory accesses work, only work partially, or cause a sticky error.
 	 * On TI BE-32 processors, reads seem to return garbage in some bytes
@@ -2782,6 +3134,33 @@ COMMAND_HANDLER(dap_nu_npcx_quirks_command)
 								"Nuvoton NPCX quirks mode");
 }
 
+COMMAND_HANDLER(dap_stats_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	struct adiv5_dap_stats *stats = &dap->stats;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(stats, 0, sizeof(*stats));
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "DP reads: %" PRIu64 ", writes: %" PRIu64,
+		stats->dp_reads, stats->dp_writes);
+	command_print(CMD, "AP reads: %" PRIu64 ", writes: %" PRIu64,
+		stats->ap_reads, stats->ap_writes);
+	command_print(CMD, "queue runs: %" PRIu64 ", empty runs skipped: %" PRIu64,
+		stats->runs, stats->runs_elided);
+	command_print(CMD, "CSW writes skipped: %" PRIu64 ", TAR writes skipped: %" PRIu64,
+		stats->csw_elided, stats->tar_elided);
+
+	return ERROR_OK;
+}
+
 const struct command_registration dap_instance_commands[] = {
 	{
 		.name = "info",
@@ -2861,5 +3240,13 @@ const struct command_registration dap_instance_commands[] = {
 		.help = "set/get quirks mode for Nuvoton NPCX controllers",
 		.usage = "[enable]",
 	},
+	{
+		.name = "stats",
+		.handler = dap_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "display the number of queued DAP transactions "
+			"and of the ones found unnecessary",
+		.usage = "['reset']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -300,6 +300,24 @@ struct adiv5_ap {
 	bool config_ap_never_release;
 };
 
+/**
+ * Counters of the DAP transactions queued and of the ones which were not
+ * needed, displayed by the "dap stats" command.
+ */
+struct adiv5_dap_stats {
+	uint64_t dp_reads;
+	uint64_t dp_writes;
+	uint64_t ap_reads;
+	uint64_t ap_writes;
+	uint64_t runs;
+
+	/* dap_run() calls with nothing queued since the last successful run */
+	uint64_t runs_elided;
+
+	/* CSW and TAR writes skipped as the register already holds the value */
+	uint64_t csw_elided;
+	uint64_t tar_elided;
+};
 
 /**
  * This represents an ARM Debug Interface (v5) Debug Access Port (DAP).
@@ -396,6 +414,14 @@ struct adiv5_dap {
 
 	/* ADIv6 only field indicating ROM Table address size */
 	unsigned int asize;
+
+	/**
+	 * Nothing has been queued since the last successful dap_run(), so
+	 * the next one has nothing to do on the wire.
+	 */
+	bool queue_empty;
+
+	struct adiv5_dap_stats stats;
 };
 
 /**
@@ -496,6 +522,7 @@ static inline int dap_send_sequence(struct adiv5_dap *dap,
 		enum swd_special_seq seq)
 {
 	assert(dap->ops);
+	dap->queue_empty = false;
 	return dap->ops->send_sequence(dap, seq);
 }
 
@@ -515,6 +542,8 @@ static inline int dap_queue_dp_read(struct adiv5_dap *dap,
 		unsigned reg, uint32_t *data)
 {
 	assert(dap->ops);
+	dap->queue_empty = false;
+	dap->stats.dp_reads++;
 	return dap->ops->queue_dp_read(dap, reg, data);
 }
 
@@ -533,6 +562,8 @@ static inline int dap_queue_dp_write(struct adiv5_dap *dap,
 		unsigned reg, uint32_t data)
 {
 	assert(dap->ops);
+	dap->queue_empty = false;
+	dap->stats.dp_writes++;
 	return dap->ops->queue_dp_write(dap, reg, data);
 }
 
@@ -554,6 +585,8 @@ static inline int dap_queue_ap_read(struct adiv5_ap *ap,
 		ap->refcount = 1;
 		LOG_ERROR("BUG: refcount AP#0x%" PRIx64 " used without get", ap->ap_num);
 	}
+	ap->dap->queue_empty = false;
+	ap->dap->stats.ap_reads++;
 	return ap->dap->ops->queue_ap_read(ap, reg, data);
 }
 
@@ -574,6 +607,8 @@ static inline int dap_queue_ap_write(struct adiv5_ap *ap,
 		ap->refcount = 1;
 		LOG_ERROR("BUG: refcount AP#0x%" PRIx64 " used without get", ap->ap_num);
 	}
+	ap->dap->queue_empty = false;
+	ap->dap->stats.ap_writes++;
 	return ap->dap->ops->queue_ap_write(ap, reg, data);
 }
 
@@ -591,6 +626,7 @@ static inline int dap_queue_ap_write(struct adiv5_ap *ap,
 static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 {
 	assert(dap->ops);
+	dap->queue_empty = false;
 	return dap->ops->queue_ap_abort(dap, ack);
 }
 
@@ -600,6 +636,10 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
  * operation will be queued, one of the first operations in the queue
  * should probably enable CORUNDETECT in the CTRL/STAT register.
  *
+ * If nothing was queued since the last successful run, there is neither
+ * a transaction to execute nor a new error to collect and the call does
+ * not reach the transport.
+ *
  * @param dap The DAP used.
  *
  * @return ERROR_OK for success, else a fault code.
@@ -607,7 +647,15 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops);
-	return dap->ops->run(dap);
+	if (dap->queue_empty && !dap->do_reconnect) {
+		dap->stats.runs_elided++;
+		return ERROR_OK;
+	}
+
+	dap->stats.runs++;
+	int retval = dap->ops->run(dap);
+	dap->queue_empty = (retval == ERROR_OK);
+	return retval;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
@@ -677,6 +725,12 @@ int mem_ap_read_buf(struct adiv5_ap *ap,
 int mem_ap_write_buf(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
 
+/* Synchronous MEM-AP byte range transfers, access sizes picked by the MEM-AP. */
+int mem_ap_read_bytes(struct adiv5_ap *ap,
+		uint8_t *buffer, uint32_t count, target_addr_t address);
+int mem_ap_write_bytes(struct adiv5_ap *ap,
+		const uint8_t *buffer, uint32_t count, target_addr_t address);
+
 /* Synchronous, non-incrementing buffer functions for accessing fifos. */
 int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
@@ -131,7 +131,7 @@ static int dap_init_all(void)
 		if (is_adiv6(dap)) {
 			uint32_t dpidr1;
 
-			retval = dap->ops->queue_dp_read(dap, DP_DPIDR1, &dpidr1);
+			retval = dap_queue_dp_read(dap, DP_DPIDR1, &dpidr1);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("DAP read of DPIDR1 failed...");
 				return retval;
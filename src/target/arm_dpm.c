@@ -10,6 +10,7 @@
 
 #include "arm.h"
 #include "arm_dpm.h"
+#include "arm_tlb.h"
 #include "armv8_dpm.h"
 #include <jtag/jtag.h>
 #include "register.h"
@@ -85,6 +86,10 @@ static int dpm_mcr(struct target *target, int cpnum,
 			value);
 
 	/* (void) */ dpm->finish(dpm);
+
+	if (cpnum == 15)
+		arm_tlb_cp15_write(arm->tlb, crn);
+
 	return retval;
 }
 
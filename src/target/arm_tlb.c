@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Host side cache of the VA to PA translations of an ARM core, see
+ * arm_tlb.h.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+
+#include "arm.h"
+#include "arm_tlb.h"
+
+static struct arm_tlb_entry *arm_tlb_slot(struct arm_tlb *tlb, target_addr_t va)
+{
+	return &tlb->entry[(va / ARM_TLB_PAGE_SIZE) % ARM_TLB_ENTRIES];
+}
+
+void arm_tlb_init(struct arm_tlb *tlb)
+{
+	memset(tlb, 0, sizeof(*tlb));
+	tlb->generation = 1;
+}
+
+/* Forgets all the translations and the ASID */
+void arm_tlb_flush(struct arm_tlb *tlb)
+{
+	if (!tlb)
+		return;
+
+	tlb->asid_valid = false;
+	tlb->flushes++;
+
+	if (++tlb->generation == 0) {
+		/* don't let a stale entry come back to life */
+		for (unsigned int i = 0; i < ARM_TLB_ENTRIES; i++)
+			tlb->entry[i].generation = 0;
+		tlb->generation = 1;
+	}
+}
+
+void arm_tlb_set_asid(struct arm_tlb *tlb, uint32_t asid)
+{
+	tlb->asid = asid;
+	tlb->asid_valid = true;
+}
+
+/* Called after a write to the CP15 registers c<crn>, c?, ? */
+void arm_tlb_cp15_write(struct arm_tlb *tlb, uint32_t crn)
+{
+	if (!tlb)
+		return;
+
+	switch (crn) {
+	case 1:		/* SCTLR, SCR, HCR */
+	case 2:		/* TTBR0, TTBR1, TTBCR, HTTBR, VTTBR */
+	case 8:		/* TLB maintenance */
+		arm_tlb_flush(tlb);
+		break;
+	case 13:	/* CONTEXTIDR */
+		tlb->asid_valid = false;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Looks up the translation of the page holding @a va, in the current ASID.
+ * @param tlb The TLB, its ASID must be valid.
+ * @param regime Translation regime of the lookup, e.g. the exception level.
+ * @param va The virtual address.
+ * @param pa Where to store the physical address of @a va.
+ * @param attr Where to store the attributes of the page, may be NULL.
+ * @returns true on a hit.
+ */
+bool arm_tlb_lookup(struct arm_tlb *tlb, uint32_t regime, target_addr_t va,
+		target_addr_t *pa, uint64_t *attr)
+{
+	struct arm_tlb_entry *entry = arm_tlb_slot(tlb, va);
+	target_addr_t offset = va & (ARM_TLB_PAGE_SIZE - 1);
+
+	if (entry->generation != tlb->generation || entry->regime != regime
+			|| entry->asid != tlb->asid || entry->va_page != va - offset) {
+		tlb->misses++;
+		return false;
+	}
+
+	tlb->hits++;
+	*pa = entry->pa_page | offset;
+	if (attr)
+		*attr = entry->attr;
+	return true;
+}
+
+/* Records the translation of @a va into @a pa, in the current ASID */
+void arm_tlb_insert(struct arm_tlb *tlb, uint32_t regime, target_addr_t va,
+		target_addr_t pa, uint64_t attr)
+{
+	struct arm_tlb_entry *entry = arm_tlb_slot(tlb, va);
+
+	entry->generation = tlb->generation;
+	entry->regime = regime;
+	entry->asid = tlb->asid;
+	entry->va_page = va & ~(target_addr_t)(ARM_TLB_PAGE_SIZE - 1);
+	entry->pa_page = pa & ~(target_addr_t)(ARM_TLB_PAGE_SIZE - 1);
+	entry->attr = attr;
+}
+
+COMMAND_HANDLER(arm_tlb_handle_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct arm *arm = target_to_arm(target);
+	struct arm_tlb *tlb = arm->tlb;
+	unsigned int valid = 0;
+
+	if (!is_arm(arm) || !tlb) {
+		command_print(CMD, "target %s has no TLB", target_name(target));
+		return ERROR_TARGET_INVALID;
+	}
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "flush")) {
+			arm_tlb_flush(tlb);
+		} else if (!strcmp(CMD_ARGV[0], "reset")) {
+			tlb->hits = 0;
+			tlb->misses = 0;
+			tlb->flushes = 0;
+		} else {
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+	}
+
+	for (unsigned int i = 0; i < ARM_TLB_ENTRIES; i++)
+		if (tlb->entry[i].generation == tlb->generation)
+			valid++;
+
+	uint64_t lookups = tlb->hits + tlb->misses;
+	command_print(CMD, "hits %" PRIu64 ", misses %" PRIu64 " (%" PRIu64 "%% hit rate)",
+		tlb->hits, tlb->misses, lookups ? 100 * tlb->hits / lookups : 0);
+	command_print(CMD, "flushes %" PRIu64 ", %u of %u entries valid",
+		tlb->flushes, valid, ARM_TLB_ENTRIES);
+
+	return ERROR_OK;
+}
+
+const struct command_registration arm_tlb_command_handlers[] = {
+	{
+		.name = "tlb",
+		.handler = arm_tlb_handle_command,
+		.mode = COMMAND_EXEC,
+		.help = "display the hit rate of the VA to PA translation cache, "
+			"flush the cache or reset its statistics",
+		.usage = "['flush'|'reset']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
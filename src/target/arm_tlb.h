@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_ARM_TLB_H
+#define OPENOCD_TARGET_ARM_TLB_H
+
+#include <helper/command.h>
+#include "target.h"
+
+/**
+ * @file
+ * Host side cache of the VA to PA translations of an ARM core with an MMU.
+ *
+ * Translating an address costs a few instructions executed by the halted
+ * core, or a table walk over the debug port. The translations are kept per
+ * 4 KB page, tagged with the translation regime and the ASID. They are
+ * thrown away whenever the core may have changed its mappings: when it
+ * runs, and when OpenOCD writes its SCTLR, TTBRs or TLB maintenance
+ * registers. A write to the context ID register only causes the ASID to be
+ * read again.
+ */
+
+#define ARM_TLB_PAGE_SIZE	0x1000
+#define ARM_TLB_ENTRIES		64
+
+struct arm_tlb_entry {
+	/* valid if equal to the generation of the TLB */
+	uint32_t generation;
+	uint32_t regime;
+	uint32_t asid;
+	target_addr_t va_page;
+	target_addr_t pa_page;
+	/* translation attributes, e.g. the PAR value */
+	uint64_t attr;
+};
+
+struct arm_tlb {
+	struct arm_tlb_entry entry[ARM_TLB_ENTRIES];
+	uint32_t generation;
+
+	/* ASID of the current context, to be read again if not valid */
+	bool asid_valid;
+	uint32_t asid;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t flushes;
+};
+
+void arm_tlb_init(struct arm_tlb *tlb);
+void arm_tlb_flush(struct arm_tlb *tlb);
+void arm_tlb_set_asid(struct arm_tlb *tlb, uint32_t asid);
+void arm_tlb_cp15_write(struct arm_tlb *tlb, uint32_t crn);
+
+bool arm_tlb_lookup(struct arm_tlb *tlb, uint32_t regime, target_addr_t va,
+		target_addr_t *pa, uint64_t *attr);
+void arm_tlb_insert(struct arm_tlb *tlb, uint32_t regime, target_addr_t va,
+		target_addr_t pa, uint64_t attr);
+
+extern const struct command_registration arm_tlb_command_handlers[];
+
+#endif /* OPENOCD_TARGET_ARM_TLB_H */
@@ -526,6 +526,8 @@ int armv7a_init_arch_info(struct target *target, struct armv7a_common *armv7a)
 	armv7a->armv7a_mmu.armv7a_cache.outer_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.flush_all_data_cache = NULL;
 	armv7a->armv7a_mmu.armv7a_cache.auto_cache_enabled = 1;
+	arm_tlb_init(&armv7a->armv7a_mmu.tlb);
+	arm->tlb = &armv7a->armv7a_mmu.tlb;
 	return ERROR_OK;
 }
 
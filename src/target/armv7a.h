@@ -13,6 +13,7 @@
 #include "armv4_5_mmu.h"
 #include "armv4_5_cache.h"
 #include "arm_dpm.h"
+#include "arm_tlb.h"
 
 enum {
 	ARM_PC  = 15,
@@ -84,6 +85,8 @@ struct armv7a_mmu_common {
 			uint32_t count, uint8_t *buffer);
 	struct armv7a_cache_common armv7a_cache;
 	uint32_t mmu_enabled;
+
+	struct arm_tlb tlb;
 };
 
 struct armv7a_common {
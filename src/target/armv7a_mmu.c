@@ -23,16 +23,36 @@
 
 #define SCTLR_BIT_AFE (1 << 29)
 
-/*  V7 method VA TO PA  */
-int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
-	target_addr_t *val, int meminfo)
+/* Reads the ASID tagging the TLB entries of the current context */
+static int armv7a_mmu_read_asid(struct armv7a_common *armv7a)
 {
-	int retval = ERROR_FAIL;
-	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct arm_dpm *dpm = armv7a->arm.dpm;
-	uint32_t virt = va & ~0xfff, value;
-	uint32_t NOS, NS, INNER, OUTER, SS;
-	*val = 0xdeadbeef;
+	uint32_t contextidr;
+	int retval;
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* MRC p15,0,<Rt>,c13,c0,1 ; Read CP15 Context ID Register */
+	retval = dpm->instr_read_data_r0(dpm,
+			ARMV4_5_MRC(15, 0, 0, 13, 0, 1),
+			&contextidr);
+	if (retval == ERROR_OK)
+		arm_tlb_set_asid(&armv7a->armv7a_mmu.tlb, contextidr & 0xff);
+
+	dpm->finish(dpm);
+	return retval;
+}
+
+/* Translates va with the core, for a privileged read; returns the PAR */
+static int armv7a_mmu_read_par(struct armv7a_common *armv7a, uint32_t va,
+	uint32_t *par)
+{
+	struct arm_dpm *dpm = armv7a->arm.dpm;
+	uint32_t virt = va & ~0xfff;
+	int retval;
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		goto done;
@@ -45,9 +65,56 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 		goto done;
 	retval = dpm->instr_read_data_r0(dpm,
 			ARMV4_5_MRC(15, 0, 0, 7, 4, 0),
-			&value);
-	if (retval != ERROR_OK)
-		goto done;
+			par);
+
+done:
+	dpm->finish(dpm);
+
+	return retval;
+}
+
+/*  V7 method VA TO PA  */
+int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
+	target_addr_t *val, int meminfo)
+{
+	int retval;
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	struct arm_tlb *tlb = &armv7a->armv7a_mmu.tlb;
+	/* the PL1&0 and PL2 stage 1 translations use different tables */
+	uint32_t regime = armv7a->arm.core_mode == ARM_MODE_HYP ? 2 : 1;
+	uint32_t value;
+	uint32_t NOS, NS, INNER, OUTER, SS;
+	uint64_t attr;
+	*val = 0xdeadbeef;
+
+	if (!tlb->asid_valid) {
+		retval = armv7a_mmu_read_asid(armv7a);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (arm_tlb_lookup(tlb, regime, va, val, &attr)) {
+		value = attr;
+	} else {
+		retval = armv7a_mmu_read_par(armv7a, va, &value);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if ((value >> 1) & 1) {
+			/* PAR[31:24] contains PA[31:24] */
+			*val = value & 0xff000000;
+			/* PAR [23:16] contains PA[39:32] */
+			*val |= (target_addr_t)(value & 0x00ff0000) << 16;
+			/* PA[23:12] is the same as VA[23:12] */
+			*val |= (va & 0xffffff);
+		} else {
+			*val = (value & ~0xfff)  +  (va & 0xfff);
+		}
+
+		/* PAR[0] set: the translation aborted */
+		if (!(value & 1))
+			arm_tlb_insert(tlb, regime, va, *val, value);
+	}
 
 	/* decode memory attribute */
 	SS = (value >> 1) & 1;
@@ -56,16 +123,6 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 	INNER = (value >> 4) &  0x7;
 	OUTER = (value >> 2) & 0x3;
 
-	if (SS) {
-		/* PAR[31:24] contains PA[31:24] */
-		*val = value & 0xff000000;
-		/* PAR [23:16] contains PA[39:32] */
-		*val |= (target_addr_t)(value & 0x00ff0000) << 16;
-		/* PA[23:12] is the same as VA[23:12] */
-		*val |= (va & 0xffffff);
-	} else {
-		*val = (value & ~0xfff)  +  (va & 0xfff);
-	}
 	if (meminfo) {
 		LOG_INFO("%" PRIx32 " : %" TARGET_PRIxADDR " %s outer shareable %s secured %s super section",
 			va, *val,
@@ -110,10 +167,7 @@ int armv7a_mmu_translate_va_pa(struct target *target, uint32_t va,
 		}
 	}
 
-done:
-	dpm->finish(dpm);
-
-	return retval;
+	return ERROR_OK;
 }
 
 static const char *desc_bits_to_string(bool c_bit, bool b_bit, bool s_bit, bool ap2, int ap10, bool afe)
@@ -356,6 +410,9 @@ static const struct command_registration armv7a_mmu_group_handlers[] = {
 		.help = "dump translation table 0, 1 or from <address>",
 		.usage = "(0|1|addr <address> [num_entries])",
 	},
+	{
+		.chain = arm_tlb_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -944,8 +944,45 @@ int armv8_mmu_translate_va(struct target *target,  target_addr_t va, target_addr
 }
 
 /*  V8 method VA TO PA  */
-int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
-	target_addr_t *val, int meminfo)
+/* Reads the ASID tagging the TLB entries of the current context */
+static int armv8_mmu_read_asid(struct armv8_common *armv8)
+{
+	struct arm *arm = &armv8->arm;
+	struct arm_dpm *dpm = &armv8->dpm;
+	uint64_t tcr = 0, ttbr = 0;
+	int retval;
+
+	/* only the EL1&0 regime of AArch64 has ASIDs we know of */
+	if (arm->core_state != ARM_STATE_AARCH64 ||
+			armv8_curel_from_core_mode(arm->core_mode) > SYSTEM_CUREL_EL1) {
+		arm_tlb_set_asid(&armv8->armv8_mmu.tlb, 0);
+		return ERROR_OK;
+	}
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (armv8_curel_from_core_mode(arm->core_mode) == SYSTEM_CUREL_EL0)
+		armv8_dpm_modeswitch(dpm, ARMV8_64_EL1H);
+
+	retval = dpm->instr_read_data_r0_64(dpm,
+			ARMV8_MRS(SYSTEM_TCR_EL1, 0), &tcr);
+	/* TCR_EL1.A1 selects the TTBR holding the ASID */
+	if (retval == ERROR_OK)
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS((tcr & (1 << 22)) ? SYSTEM_TTBR1_EL1 : SYSTEM_TTBR0_EL1, 0),
+				&ttbr);
+	if (retval == ERROR_OK)
+		arm_tlb_set_asid(&armv8->armv8_mmu.tlb, ttbr >> 48);
+
+	armv8_dpm_modeswitch(dpm, ARM_MODE_ANY);
+	dpm->finish(dpm);
+	return retval;
+}
+
+/* Translates va with the AT instruction of the current EL, returns the PAR */
+static int armv8_mmu_read_par(struct target *target, target_addr_t va, uint64_t *par)
 {
 	struct armv8_common *armv8 = target_to_armv8(target);
 	struct arm *arm = target_to_arm(target);
@@ -953,20 +990,6 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 	enum arm_mode target_mode = ARM_MODE_ANY;
 	uint32_t retval;
 	uint32_t instr = 0;
-	uint64_t par;
-
-	static const char * const shared_name[] = {
-			"Non-", "UNDEFINED ", "Outer ", "Inner "
-	};
-
-	static const char * const secure_name[] = {
-			"Secure", "Not Secure"
-	};
-
-	if (target->state != TARGET_HALTED) {
-		LOG_TARGET_ERROR(target, "not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
 
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
@@ -1001,7 +1024,7 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 	retval = dpm->instr_write_data_r0_64(dpm, instr, (uint64_t)va);
 	/* read result from PAR_EL1 */
 	if (retval == ERROR_OK)
-		retval = dpm->instr_read_data_r0_64(dpm, ARMV8_MRS(SYSTEM_PAR_EL1, 0), &par);
+		retval = dpm->instr_read_data_r0_64(dpm, ARMV8_MRS(SYSTEM_PAR_EL1, 0), par);
 
 	/* switch back to saved PE mode */
 	if (target_mode != ARM_MODE_ANY)
@@ -1009,31 +1032,71 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 
 	dpm->finish(dpm);
 
-	if (retval != ERROR_OK)
-		return retval;
+	return retval;
+}
 
-	if (par & 1) {
-		LOG_ERROR("Address translation failed at stage %i, FST=%x, PTW=%i",
-				((int)(par >> 9) & 1)+1, (int)(par >> 1) & 0x3f, (int)(par >> 8) & 1);
+int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
+	target_addr_t *val, int meminfo)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm *arm = target_to_arm(target);
+	struct arm_tlb *tlb = &armv8->armv8_mmu.tlb;
+	unsigned int el = armv8_curel_from_core_mode(arm->core_mode);
+	/* EL0 and EL1 share the EL1&0 regime; secure and non-secure differ */
+	uint32_t regime = MAX(el, SYSTEM_CUREL_EL1) |
+		((armv8->dpm.dscr & DSCR_NON_SECURE) ? 0x10 : 0);
+	int retval;
+	uint64_t par;
 
-		*val = 0;
-		retval = ERROR_FAIL;
-	} else {
-		*val = (par & 0xFFFFFFFFF000UL) | (va & 0xFFF);
-		if (meminfo) {
-			int SH = (par >> 7) & 3;
-			int NS = (par >> 9) & 1;
-			int ATTR = (par >> 56) & 0xFF;
+	static const char * const shared_name[] = {
+			"Non-", "UNDEFINED ", "Outer ", "Inner "
+	};
+
+	static const char * const secure_name[] = {
+			"Secure", "Not Secure"
+	};
+
+	if (target->state != TARGET_HALTED) {
+		LOG_TARGET_ERROR(target, "not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (!tlb->asid_valid) {
+		retval = armv8_mmu_read_asid(armv8);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (!arm_tlb_lookup(tlb, regime, va, val, &par)) {
+		retval = armv8_mmu_read_par(target, va, &par);
+		if (retval != ERROR_OK)
+			return retval;
 
-			char *memtype = (ATTR & 0xF0) == 0 ? "Device Memory" : "Normal Memory";
+		if (par & 1) {
+			LOG_ERROR("Address translation failed at stage %i, FST=%x, PTW=%i",
+					((int)(par >> 9) & 1)+1, (int)(par >> 1) & 0x3f, (int)(par >> 8) & 1);
 
-			LOG_USER("%sshareable, %s",
-					shared_name[SH], secure_name[NS]);
-			LOG_USER("%s", memtype);
+			*val = 0;
+			return ERROR_FAIL;
 		}
+
+		*val = (par & 0xFFFFFFFFF000UL) | (va & 0xFFF);
+		arm_tlb_insert(tlb, regime, va, *val, par);
 	}
 
-	return retval;
+	if (meminfo) {
+		int SH = (par >> 7) & 3;
+		int NS = (par >> 9) & 1;
+		int ATTR = (par >> 56) & 0xFF;
+
+		char *memtype = (ATTR & 0xF0) == 0 ? "Device Memory" : "Normal Memory";
+
+		LOG_USER("%sshareable, %s",
+				shared_name[SH], secure_name[NS]);
+		LOG_USER("%s", memtype);
+	}
+
+	return ERROR_OK;
 }
 
 COMMAND_HANDLER(armv8_handle_exception_catch_command)
@@ -1144,6 +1207,8 @@ int armv8_init_arch_info(struct target *target, struct armv8_common *armv8)
 	armv8->armv8_mmu.armv8_cache.info = -1;
 	armv8->armv8_mmu.armv8_cache.flush_all_data_cache = NULL;
 	armv8->armv8_mmu.armv8_cache.display_cache_info = NULL;
+	arm_tlb_init(&armv8->armv8_mmu.tlb);
+	arm->tlb = &armv8->armv8_mmu.tlb;
 	return ERROR_OK;
 }
 
@@ -13,6 +13,7 @@
 #include "armv4_5_cache.h"
 #include "armv8_dpm.h"
 #include "arm_cti.h"
+#include "arm_tlb.h"
 
 enum {
 	ARMV8_R0 = 0,
@@ -179,6 +180,8 @@ struct armv8_mmu_common {
 			uint32_t size, uint32_t count, uint8_t *buffer);
 	struct armv8_cache_common armv8_cache;
 	uint32_t mmu_enabled;
+
+	struct arm_tlb tlb;
 };
 
 struct armv8_common {
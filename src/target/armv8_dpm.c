@@ -527,6 +527,10 @@ static int dpmv8_mcr(struct target *target, int cpnum,
 			value);
 
 	/* (void) */ dpm->finish(dpm);
+
+	if (cpnum == 15)
+		arm_tlb_cp15_write(arm->tlb, crn);
+
 	return retval;
 }
 
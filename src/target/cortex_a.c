@@ -1081,6 +1081,9 @@ static int cortex_a_post_debug_entry(struct target *target)
 	LOG_DEBUG("cp15_control_reg: %8.8" PRIx32, cortex_a->cp15_control_reg);
 	cortex_a->cp15_control_reg_curr = cortex_a->cp15_control_reg;
 
+	/* the core ran, the translations may have changed */
+	arm_tlb_flush(armv7a->arm.tlb);
+
 	if (!armv7a->is_armv7r)
 		armv7a_read_ttbcr(target);
 
@@ -1236,6 +1239,9 @@ static int cortex_a_restore_context(struct target *target, bool bpwp)
 	if (armv7a->pre_restore_context)
 		armv7a->pre_restore_context(target);
 
+	/* the core is about to run and may remap its memory */
+	arm_tlb_flush(armv7a->arm.tlb);
+
 	return arm_dpm_write_dirty_registers(&armv7a->dpm, bpwp);
 }
 
@@ -2107,109 +2113,189 @@ static int cortex_a_dfsr_to_error_code(uint32_t dfsr)
 	}
 }
 
-static int cortex_a_write_cpu_memory_slow(struct target *target,
-	uint32_t size, uint32_t count, const uint8_t *buffer, uint32_t *dscr)
+/* A run of memory objects of one size, see cortex_a_plan_cpu_memory() */
+struct cortex_a_mem_run {
+	uint32_t size;
+	uint32_t count;
+};
+
+#define CORTEX_A_MAX_MEM_RUNS 5
+
+static unsigned int cortex_a_plan_cpu_memory(uint32_t address, uint32_t size,
+	uint32_t count, struct cortex_a_mem_run *runs)
 {
-	/* Writes count objects of size size from *buffer. Old value of DSCR must
-	 * be in *dscr; updated to new value. This is slow because it works for
-	 * non-word-sized objects. Avoid unaligned accesses as they do not work
-	 * on memory address space without "Normal" attribute. If size == 4 and
-	 * the address is aligned, cortex_a_write_cpu_memory_fast should be
-	 * preferred.
-	 * Preconditions:
-	 * - Address is in R0.
-	 * - R0 is marked dirty.
-	 */
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct arm *arm = &armv7a->arm;
-	int retval;
+	/* Splits an access into runs of aligned objects. Unaligned accesses do
+	 * not work on memory address space without "Normal" attribute, so words
+	 * at an unaligned address are accessed as the bytes and halfwords up to
+	 * the first word boundary, the words that follow and the remaining
+	 * halfword and byte. Halfwords at an odd address are accessed as bytes.
+	 * Returns the number of runs, at most CORTEX_A_MAX_MEM_RUNS. */
+	unsigned int n = 0;
 
-	/* Mark register R1 as dirty, to use for transferring data. */
-	arm_reg_current(arm, 1)->dirty = true;
+	if (size == 2 && (address & 1)) {
+		count *= 2;
+		size = 1;
+	}
 
-	/* Switch to non-blocking mode if not already in that mode. */
-	retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
-	if (retval != ERROR_OK)
-		return retval;
+	if (size != 4 || !(address & 3)) {
+		runs[n++] = (struct cortex_a_mem_run){ .size = size, .count = count };
+		return n;
+	}
 
-	/* Go through the objects. */
-	while (count) {
-		/* Write the value to store into DTRRX. */
-		uint32_t data, opcode;
-		if (size == 1)
-			data = *buffer;
-		else if (size == 2)
-			data = target_buffer_get_u16(target, buffer);
-		else
-			data = target_buffer_get_u32(target, buffer);
-		retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_DTRRX, data);
-		if (retval != ERROR_OK)
-			return retval;
+	uint32_t nbytes = 4 * count;
+	for (size = 1; size < 4; size *= 2) {
+		if (address & size) {
+			runs[n++] = (struct cortex_a_mem_run){ .size = size, .count = 1 };
+			address += size;
+			nbytes -= size;
+		}
+	}
+	if (nbytes >= 4)
+		runs[n++] = (struct cortex_a_mem_run){ .size = 4, .count = nbytes / 4 };
+	if (nbytes & 2)
+		runs[n++] = (struct cortex_a_mem_run){ .size = 2, .count = 1 };
+	if (nbytes & 1)
+		runs[n++] = (struct cortex_a_mem_run){ .size = 1, .count = 1 };
 
-		/* Transfer the value from DTRRX to R1. */
-		retval = cortex_a_exec_opcode(target, ARMV4_5_MRC(14, 0, 1, 0, 5, 0), dscr);
-		if (retval != ERROR_OK)
-			return retval;
+	return n;
+}
 
-		/* Write the value transferred to R1 into memory. */
-		if (size == 1)
-			opcode = ARMV4_5_STRB_IP(1, 0);
-		else if (size == 2)
-			opcode = ARMV4_5_STRH_IP(1, 0);
-		else
-			opcode = ARMV4_5_STRW_IP(1, 0);
-		retval = cortex_a_exec_opcode(target, opcode, dscr);
-		if (retval != ERROR_OK)
-			return retval;
+static int cortex_a_queue_dcc_mode(struct target *target, uint32_t mode, uint32_t *dscr)
+{
+	/* Same as cortex_a_set_dcc_mode(), but only queues the DSCR write. */
+	uint32_t new_dscr = (*dscr & ~DSCR_EXT_DCC_MASK) | mode;
+	if (new_dscr == *dscr)
+		return ERROR_OK;
 
-		/* Check for faults and return early. */
-		if (*dscr & (DSCR_STICKY_ABORT_PRECISE | DSCR_STICKY_ABORT_IMPRECISE))
-			return ERROR_OK; /* A data fault is not considered a system failure. */
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	int retval = mem_ap_write_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, new_dscr);
+	if (retval == ERROR_OK)
+		*dscr = new_dscr;
+	return retval;
+}
 
-		/* Wait until DTRRX is empty (according to ARMv7-A/-R architecture
-		 * manual section C8.4.3, checking InstrCmpl_l is not sufficient; one
-		 * must also check RXfull_l). Most of the time this will be free
-		 * because RXfull_l will be cleared immediately and cached in dscr. */
-		retval = cortex_a_wait_dscr_bits(target, DSCR_DTRRX_FULL_LATCHED, 0, dscr);
-		if (retval != ERROR_OK)
-			return retval;
+static int cortex_a_queue_itr(struct target *target, uint32_t opcode)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
 
-		/* Advance. */
-		buffer += size;
-		--count;
+	return mem_ap_write_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_ITR, opcode);
+}
+
+static int cortex_a_run_cpu_memory_queue(struct target *target, uint32_t *dscr)
+{
+	/* Runs the queued memory access, back in non-blocking mode. If it fails,
+	 * *dscr is read again as the queued mode changes may not have happened.
+	 * A data abort makes the stall mode DTR and ITR accesses queued after it
+	 * wait until the DAP gives up on them. The DAP is then recovered and
+	 * ERROR_OK returned, for the caller to report the fault from DFSR. */
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	struct adiv5_dap *dap = armv7a->debug_ap->dap;
+	int retval;
+
+	retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(dap);
+	if (retval == ERROR_OK)
+		return ERROR_OK;
+
+	int dscr_retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+			armv7a->debug_base + CPUDBG_DSCR, dscr);
+	if (dscr_retval != ERROR_OK) {
+		/* A transfer is still stalled, abort it. */
+		dap_queue_ap_abort(dap, NULL);
+		dap_run(dap);
+		dscr_retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DSCR, dscr);
+	}
+	if (dscr_retval == ERROR_OK &&
+			(*dscr & (DSCR_STICKY_ABORT_PRECISE | DSCR_STICKY_ABORT_IMPRECISE))) {
+		LOG_DEBUG("memory access aborted, dscr = 0x%08" PRIx32, *dscr);
+		return ERROR_OK;
 	}
 
-	return ERROR_OK;
+	return retval;
 }
 
-static int cortex_a_write_cpu_memory_fast(struct target *target,
-	uint32_t count, const uint8_t *buffer, uint32_t *dscr)
+static int cortex_a_write_cpu_memory_stream(struct target *target,
+	uint32_t address, uint32_t size, uint32_t count, const uint8_t *buffer,
+	uint32_t *dscr)
 {
-	/* Writes count objects of size 4 from *buffer. Old value of DSCR must be
-	 * in *dscr; updated to new value. This is fast but only works for
-	 * word-sized objects at aligned addresses.
+	/* Writes count objects of size size from *buffer. Old value of DSCR must
+	 * be in *dscr; updated to new value. All the transfers are queued and
+	 * run at once, faults are only found in DSCR by the caller afterwards.
+	 * Runs of words use fast mode, each write to DTRRX issuing the STC
+	 * latched in ITR. Other objects, e.g. the unaligned head and tail bytes,
+	 * go through DTRRX and R1 in stall mode, where the DTRRX and ITR writes
+	 * wait for the previous instruction instead of us polling DSCR.
 	 * Preconditions:
-	 * - Address is in R0 and must be a multiple of 4.
+	 * - Address is in R0.
 	 * - R0 is marked dirty.
 	 */
 	struct armv7a_common *armv7a = target_to_armv7a(target);
-	int retval;
+	struct arm *arm = &armv7a->arm;
+	struct cortex_a_mem_run runs[CORTEX_A_MAX_MEM_RUNS];
+	unsigned int n = cortex_a_plan_cpu_memory(address, size, count, runs);
+	const uint32_t dtrrx = armv7a->debug_base + CPUDBG_DTRRX;
+	bool stalled = false;
+	uint32_t dummy;
+	int retval = ERROR_OK;
 
-	/* Switch to fast mode if not already in that mode. */
-	retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_FAST_MODE, dscr);
-	if (retval != ERROR_OK)
-		return retval;
+	for (unsigned int i = 0; i < n && retval == ERROR_OK; i++) {
+		const uint32_t run_size = runs[i].size;
+
+		if (run_size == 4) {
+			if (stalled) {
+				/* Let the last store complete before the mode change:
+				 * a read of DTRTX only returns after the MCR behind it. */
+				retval = cortex_a_queue_itr(target, ARMV4_5_MCR(14, 0, 1, 0, 5, 0));
+				if (retval == ERROR_OK)
+					retval = mem_ap_read_u32(armv7a->debug_ap,
+							armv7a->debug_base + CPUDBG_DTRTX, &dummy);
+				stalled = false;
+			}
+			if (retval == ERROR_OK)
+				retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_FAST_MODE, dscr);
+			/* Latch STC instruction. */
+			if (retval == ERROR_OK)
+				retval = cortex_a_queue_itr(target, ARMV4_5_STC(0, 1, 0, 1, 14, 5, 0, 4));
+			for (uint32_t j = 0; j < runs[i].count && retval == ERROR_OK; j++) {
+				retval = mem_ap_write_u32(armv7a->debug_ap, dtrrx,
+						target_buffer_get_u32(target, buffer));
+				buffer += 4;
+			}
+			continue;
+		}
+
+		/* Mark register R1 as dirty, to use for transferring data. */
+		arm_reg_current(arm, 1)->dirty = true;
+		retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_STALL_MODE, dscr);
+		stalled = true;
+		for (uint32_t j = 0; j < runs[i].count && retval == ERROR_OK; j++) {
+			uint32_t data, opcode;
+			if (run_size == 1) {
+				data = *buffer;
+				opcode = ARMV4_5_STRB_IP(1, 0);
+			} else {
+				data = target_buffer_get_u16(target, buffer);
+				opcode = ARMV4_5_STRH_IP(1, 0);
+			}
+			buffer += run_size;
+
+			/* Write the value to DTRRX, transfer it to R1, store R1. */
+			retval = mem_ap_write_u32(armv7a->debug_ap, dtrrx, data);
+			if (retval == ERROR_OK)
+				retval = cortex_a_queue_itr(target, ARMV4_5_MRC(14, 0, 1, 0, 5, 0));
+			if (retval == ERROR_OK)
+				retval = cortex_a_queue_itr(target, opcode);
+		}
+	}
 
-	/* Latch STC instruction. */
-	retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_ITR, ARMV4_5_STC(0, 1, 0, 1, 14, 5, 0, 4));
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Transfer all the data and issue all the instructions. */
-	return mem_ap_write_buf_noincr(armv7a->debug_ap, buffer,
-			4, count, armv7a->debug_base + CPUDBG_DTRRX);
+	return cortex_a_run_cpu_memory_queue(target, dscr);
 }
 
 static int cortex_a_write_cpu_memory(struct target *target,
@@ -2266,28 +2352,7 @@ static int cortex_a_write_cpu_memory(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (size == 4 && (address % 4) == 0) {
-		/* We are doing a word-aligned transfer, so use fast mode. */
-		retval = cortex_a_write_cpu_memory_fast(target, count, buffer, &dscr);
-	} else {
-		/* Use slow path. Adjust size for aligned accesses */
-		switch (address % 4) {
-			case 1:
-			case 3:
-				count *= size;
-				size = 1;
-				break;
-			case 2:
-				if (size == 4) {
-					count *= 2;
-					size = 2;
-				}
-			case 0:
-			default:
-				break;
-		}
-		retval = cortex_a_write_cpu_memory_slow(target, size, count, buffer, &dscr);
-	}
+	retval = cortex_a_write_cpu_memory_stream(target, address, size, count, buffer, &dscr);
 
 	final_retval = retval;
 
@@ -2365,168 +2430,102 @@ static int cortex_a_write_cpu_memory(struct target *target,
 	return final_retval;
 }
 
-static int cortex_a_read_cpu_memory_slow(struct target *target,
-	uint32_t size, uint32_t count, uint8_t *buffer, uint32_t *dscr)
+static int cortex_a_read_cpu_memory_stream(struct target *target,
+	uint32_t address, uint32_t size, uint32_t count, uint8_t *buffer,
+	uint32_t *dscr)
 {
-	/* Reads count objects of size size into *buffer. Old value of DSCR must be
-	 * in *dscr; updated to new value. This is slow because it works for
-	 * non-word-sized objects. Avoid unaligned accesses as they do not work
-	 * on memory address space without "Normal" attribute. If size == 4 and
-	 * the address is aligned, cortex_a_read_cpu_memory_fast should be
-	 * preferred.
+	/* Reads count objects of size size into *buffer. Old value of DSCR must
+	 * be in *dscr; updated to new value. All the transfers are queued and
+	 * run at once, faults are only found in DSCR by the caller afterwards.
+	 * Runs of words use fast mode: after a first LDC, each read of DTRTX
+	 * returns a word and issues the LDC latched in ITR for the next one. The
+	 * last word and the other objects, e.g. the unaligned head and tail
+	 * bytes, are read in stall mode, where the reads of DTRTX and writes of
+	 * ITR wait for the previous instruction instead of us polling DSCR.
 	 * Preconditions:
 	 * - Address is in R0.
 	 * - R0 is marked dirty.
 	 */
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct arm *arm = &armv7a->arm;
-	int retval;
-
-	/* Mark register R1 as dirty, to use for transferring data. */
-	arm_reg_current(arm, 1)->dirty = true;
-
-	/* Switch to non-blocking mode if not already in that mode. */
-	retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Go through the objects. */
-	while (count) {
-		/* Issue a load of the appropriate size to R1. */
-		uint32_t opcode, data;
-		if (size == 1)
-			opcode = ARMV4_5_LDRB_IP(1, 0);
-		else if (size == 2)
-			opcode = ARMV4_5_LDRH_IP(1, 0);
-		else
-			opcode = ARMV4_5_LDRW_IP(1, 0);
-		retval = cortex_a_exec_opcode(target, opcode, dscr);
-		if (retval != ERROR_OK)
-			return retval;
-
-		/* Issue a write of R1 to DTRTX. */
-		retval = cortex_a_exec_opcode(target, ARMV4_5_MCR(14, 0, 1, 0, 5, 0), dscr);
-		if (retval != ERROR_OK)
-			return retval;
-
-		/* Check for faults and return early. */
-		if (*dscr & (DSCR_STICKY_ABORT_PRECISE | DSCR_STICKY_ABORT_IMPRECISE))
-			return ERROR_OK; /* A data fault is not considered a system failure. */
+	struct cortex_a_mem_run runs[CORTEX_A_MAX_MEM_RUNS];
+	unsigned int n = cortex_a_plan_cpu_memory(address, size, count, runs);
+	const uint32_t dtrtx = armv7a->debug_base + CPUDBG_DTRTX;
+	uint32_t objects = 0;
+	int retval = ERROR_OK;
 
-		/* Wait until DTRTX is full (according to ARMv7-A/-R architecture
-		 * manual section C8.4.3, checking InstrCmpl_l is not sufficient; one
-		 * must also check TXfull_l). Most of the time this will be free
-		 * because TXfull_l will be set immediately and cached in dscr. */
-		retval = cortex_a_wait_dscr_bits(target, DSCR_DTRTX_FULL_LATCHED,
-				DSCR_DTRTX_FULL_LATCHED, dscr);
-		if (retval != ERROR_OK)
-			return retval;
+	for (unsigned int i = 0; i < n; i++)
+		objects += runs[i].count;
 
-		/* Read the value transferred to DTRTX into the buffer. */
-		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_DTRTX, &data);
-		if (retval != ERROR_OK)
-			return retval;
-		if (size == 1)
-			*buffer = (uint8_t) data;
-		else if (size == 2)
-			target_buffer_set_u16(target, buffer, (uint16_t) data);
-		else
-			target_buffer_set_u32(target, buffer, data);
-
-		/* Advance. */
-		buffer += size;
-		--count;
+	uint32_t *data = calloc(objects, sizeof(uint32_t));
+	if (!data) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
 	}
 
-	return ERROR_OK;
-}
-
-static int cortex_a_read_cpu_memory_fast(struct target *target,
-	uint32_t count, uint8_t *buffer, uint32_t *dscr)
-{
-	/* Reads count objects of size 4 into *buffer. Old value of DSCR must be in
-	 * *dscr; updated to new value. This is fast but only works for word-sized
-	 * objects at aligned addresses.
-	 * Preconditions:
-	 * - Address is in R0 and must be a multiple of 4.
-	 * - R0 is marked dirty.
-	 */
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-	uint32_t u32;
-	int retval;
-
-	/* Switch to non-blocking mode if not already in that mode. */
-	retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Issue the LDC instruction via a write to ITR. */
-	retval = cortex_a_exec_opcode(target, ARMV4_5_LDC(0, 1, 0, 1, 14, 5, 0, 4), dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	count--;
+	uint32_t *data_ptr = data;
+	for (unsigned int i = 0; i < n && retval == ERROR_OK; i++) {
+		const uint32_t run_size = runs[i].size;
+		uint32_t run_count = runs[i].count;
 
-	if (count > 0) {
-		/* Switch to fast mode if not already in that mode. */
-		retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_FAST_MODE, dscr);
+		retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_STALL_MODE, dscr);
 		if (retval != ERROR_OK)
-			return retval;
-
-		/* Latch LDC instruction. */
-		retval = mem_ap_write_atomic_u32(armv7a->debug_ap,
-				armv7a->debug_base + CPUDBG_ITR, ARMV4_5_LDC(0, 1, 0, 1, 14, 5, 0, 4));
-		if (retval != ERROR_OK)
-			return retval;
+			break;
 
-		/* Read the value transferred to DTRTX into the buffer. Due to fast
-		 * mode rules, this blocks until the instruction finishes executing and
-		 * then reissues the read instruction to read the next word from
-		 * memory. The last read of DTRTX in this call reads the second-to-last
-		 * word from memory and issues the read instruction for the last word.
-		 */
-		retval = mem_ap_read_buf_noincr(armv7a->debug_ap, buffer,
-				4, count, armv7a->debug_base + CPUDBG_DTRTX);
-		if (retval != ERROR_OK)
-			return retval;
+		if (run_size == 4) {
+			/* Issue the first LDC instruction. */
+			retval = cortex_a_queue_itr(target, ARMV4_5_LDC(0, 1, 0, 1, 14, 5, 0, 4));
+			if (retval == ERROR_OK && run_count > 1) {
+				retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_FAST_MODE, dscr);
+				/* Latch LDC instruction. */
+				if (retval == ERROR_OK)
+					retval = cortex_a_queue_itr(target, ARMV4_5_LDC(0, 1, 0, 1, 14, 5, 0, 4));
+				/* All but the last word, each read issuing the next LDC. */
+				for (; run_count > 1 && retval == ERROR_OK; run_count--)
+					retval = mem_ap_read_u32(armv7a->debug_ap, dtrtx, data_ptr++);
+				if (retval == ERROR_OK)
+					retval = cortex_a_queue_dcc_mode(target, DSCR_EXT_DCC_STALL_MODE, dscr);
+			}
+			/* The last word, once its LDC has completed. */
+			if (retval == ERROR_OK)
+				retval = mem_ap_read_u32(armv7a->debug_ap, dtrtx, data_ptr++);
+			continue;
+		}
 
-		/* Advance. */
-		buffer += count * 4;
+		/* Mark register R1 as dirty, to use for transferring data. */
+		arm_reg_current(arm, 1)->dirty = true;
+		const uint32_t opcode = run_size == 1 ? ARMV4_5_LDRB_IP(1, 0) : ARMV4_5_LDRH_IP(1, 0);
+		for (uint32_t j = 0; j < run_count && retval == ERROR_OK; j++) {
+			/* Load R1, write it to DTRTX, read DTRTX. */
+			retval = cortex_a_queue_itr(target, opcode);
+			if (retval == ERROR_OK)
+				retval = cortex_a_queue_itr(target, ARMV4_5_MCR(14, 0, 1, 0, 5, 0));
+			if (retval == ERROR_OK)
+				retval = mem_ap_read_u32(armv7a->debug_ap, dtrtx, data_ptr++);
+		}
 	}
 
-	/* Wait for last issued instruction to complete. */
-	retval = cortex_a_wait_instrcmpl(target, dscr, false);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Switch to non-blocking mode if not already in that mode. */
-	retval = cortex_a_set_dcc_mode(target, DSCR_EXT_DCC_NON_BLOCKING, dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Check for faults and return early. */
-	if (*dscr & (DSCR_STICKY_ABORT_PRECISE | DSCR_STICKY_ABORT_IMPRECISE))
-		return ERROR_OK; /* A data fault is not considered a system failure. */
-
-	/* Wait until DTRTX is full (according to ARMv7-A/-R architecture manual
-	 * section C8.4.3, checking InstrCmpl_l is not sufficient; one must also
-	 * check TXfull_l). Most of the time this will be free because TXfull_l
-	 * will be set immediately and cached in dscr. */
-	retval = cortex_a_wait_dscr_bits(target, DSCR_DTRTX_FULL_LATCHED,
-			DSCR_DTRTX_FULL_LATCHED, dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* Read the value transferred to DTRTX into the buffer. This is the last
-	 * word. */
-	retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
-			armv7a->debug_base + CPUDBG_DTRTX, &u32);
-	if (retval != ERROR_OK)
-		return retval;
-	target_buffer_set_u32(target, buffer, u32);
+	if (retval == ERROR_OK)
+		retval = cortex_a_run_cpu_memory_queue(target, dscr);
+
+	if (retval == ERROR_OK) {
+		data_ptr = data;
+		for (unsigned int i = 0; i < n; i++) {
+			for (uint32_t j = 0; j < runs[i].count; j++) {
+				if (runs[i].size == 1)
+					*buffer = *data_ptr;
+				else if (runs[i].size == 2)
+					target_buffer_set_u16(target, buffer, *data_ptr);
+				else
+					target_buffer_set_u32(target, buffer, *data_ptr);
+				buffer += runs[i].size;
+				data_ptr++;
+			}
+		}
+	}
 
-	return ERROR_OK;
+	free(data);
+	return retval;
 }
 
 static int cortex_a_read_cpu_memory(struct target *target,
@@ -2583,29 +2582,7 @@ static int cortex_a_read_cpu_memory(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (size == 4 && (address % 4) == 0) {
-		/* We are doing a word-aligned transfer, so use fast mode. */
-		retval = cortex_a_read_cpu_memory_fast(target, count, buffer, &dscr);
-	} else {
-		/* Use slow path. Adjust size for aligned accesses */
-		switch (address % 4) {
-			case 1:
-			case 3:
-				count *= size;
-				size = 1;
-				break;
-			case 2:
-				if (size == 4) {
-					count *= 2;
-					size = 2;
-				}
-				break;
-			case 0:
-			default:
-				break;
-		}
-		retval = cortex_a_read_cpu_memory_slow(target, size, count, buffer, &dscr);
-	}
+	retval = cortex_a_read_cpu_memory_stream(target, address, size, count, buffer, &dscr);
 
 	final_retval = retval;
 
@@ -2758,6 +2735,18 @@ static int cortex_a_read_buffer(struct target *target, target_addr_t address,
 {
 	uint32_t size;
 
+	/* Words at any alignment: the unaligned ends are handled in the same
+	 * DCC stream, see cortex_a_plan_cpu_memory(). */
+	if (count >= 4) {
+		uint32_t words = count / 4;
+		int retval = target_read_memory(target, address, 4, words, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+		address += 4 * words;
+		count -= 4 * words;
+		buffer += 4 * words;
+	}
+
 	/* Align up to maximum 4 bytes. The loop condition makes sure the next pass
 	 * will have something to do with the size we leave to it. */
 	for (size = 1; size < 4 && count >= size * 2 + (address & size); size *= 2) {
@@ -2792,6 +2781,18 @@ static int cortex_a_write_buffer(struct target *target, target_addr_t address,
 {
 	uint32_t size;
 
+	/* Words at any alignment: the unaligned ends are handled in the same
+	 * DCC stream, see cortex_a_plan_cpu_memory(). */
+	if (count >= 4) {
+		uint32_t words = count / 4;
+		int retval = target_write_memory(target, address, 4, words, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+		address += 4 * words;
+		count -= 4 * words;
+		buffer += 4 * words;
+	}
+
 	/* Align up to maximum 4 bytes. The loop condition makes sure the next pass
 	 * will have something to do with the size we leave to it. */
 	for (size = 1; size < 4 && count >= size * 2 + (address & size); size *= 2) {
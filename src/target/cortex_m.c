@@ -2180,6 +2180,22 @@ static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+static int cortex_m_read_buffer(struct target *target, target_addr_t address,
+	uint32_t count, uint8_t *buffer)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	return mem_ap_read_bytes(armv7m->debug_ap, buffer, count, address);
+}
+
+static int cortex_m_write_buffer(struct target *target, target_addr_t address,
+	uint32_t count, const uint8_t *buffer)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	return mem_ap_write_bytes(armv7m->debug_ap, buffer, count, address);
+}
+
 static int cortex_m_init_target(struct command_context *cmd_ctx,
 	struct target *target)
 {
@@ -3090,6 +3106,8 @@ struct target_type cortexm_target = {
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
+	.read_buffer = cortex_m_read_buffer,
+	.write_buffer = cortex_m_write_buffer,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
 
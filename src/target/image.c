@@ -23,6 +23,8 @@
 
 #include "image.h"
 #include "target.h"
+#include <helper/binarybuffer.h>
+#include <helper/crc32.h>
 #include <helper/log.h>
 
 /* convert ELF header field to host endianness */
@@ -116,239 +118,168 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
-static int image_ihex_buffer_complete_inner(struct image *image,
-	char *lpsz_line,
-	struct imagesection *section)
-{
-	struct image_ihex *ihex = image->type_private;
-	struct fileio *fileio = ihex->fileio;
-	uint32_t full_address;
-	uint32_t cooked_bytes;
-	bool end_rec = false;
-
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
+/* a record holds a length byte, up to 255 bytes of payload, an address of
+ * up to 4 bytes (IHEX has 2 plus a record type) and a checksum */
+#define IMAGE_RECORD_MAX_SIZE	(1 + 255 + 4)
 
-	size_t filesize;
-	int retval;
-	retval = fileio_size(fileio, &filesize);
-	if (retval != ERROR_OK)
-		return retval;
+/* modulo 256 sum of the decoded record bytes */
+static uint8_t image_record_checksum(const uint8_t *record, size_t size)
+{
+	uint8_t sum = 0;
 
-	ihex->buffer = malloc(filesize >> 1);
-	cooked_bytes = 0x0;
-	image->num_sections = 0;
+	for (size_t i = 0; i < size; i++)
+		sum += record[i];
 
-	while (!fileio_feof(fileio)) {
-		full_address = 0x0;
-		section[image->num_sections].private = &ihex->buffer[cooked_bytes];
-		section[image->num_sections].base_address = 0x0;
-		section[image->num_sections].size = 0x0;
-		section[image->num_sections].flags = 0;
-
-		while (fileio_fgets(fileio, 1023, lpsz_line) == ERROR_OK) {
-			uint32_t count;
-			uint32_t address;
-			uint32_t record_type;
-			uint32_t checksum;
-			uint8_t cal_checksum = 0;
-			size_t bytes_read = 0;
-
-			/* skip comments and blank lines */
-			if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
-				continue;
-
-			if (sscanf(&lpsz_line[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32, &count,
-				&address, &record_type) != 3)
-				return ERROR_IMAGE_FORMAT_ERROR;
-			bytes_read += 9;
-
-			cal_checksum += (uint8_t)count;
-			cal_checksum += (uint8_t)(address >> 8);
-			cal_checksum += (uint8_t)address;
-			cal_checksum += (uint8_t)record_type;
-
-			if (record_type == 0) {	/* Data Record */
-				if ((full_address & 0xffff) != address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff0000) | address;
-					full_address = (full_address & 0xffff0000) | address;
-				}
+	return sum;
+}
 
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					ihex->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
-			} else if (record_type == 1) {	/* End of File Record */
-				/* finish the current section */
-				image->num_sections++;
-
-				/* copy section information */
-				image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-				for (unsigned int i = 0; i < image->num_sections; i++) {
-					image->sections[i].private = section[i].private;
-					image->sections[i].base_address = section[i].base_address;
-					image->sections[i].size = section[i].size;
-					image->sections[i].flags = section[i].flags;
-				}
+/* data of the IHEX and S19 records, gathered in contiguous runs */
+struct image_run_builder {
+	image_run_handler_t handler;
+	void *priv;
+	/* added to the addresses of the file */
+	target_addr_t offset;
+	uint32_t address;
+	uint32_t size;
+	uint8_t *data;		/* IMAGE_STREAM_RUN_SIZE bytes */
+};
 
-				end_rec = true;
-				break;
-			} else if (record_type == 2) {	/* Linear Address Record */
-				uint16_t upper_address;
-
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
-				bytes_read += 4;
-
-				if ((full_address >> 4) != upper_address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff) | (upper_address << 4);
-					full_address = (full_address & 0xffff) | (upper_address << 4);
-				}
-			} else if (record_type == 3) {	/* Start Segment Address Record */
-				uint32_t dummy;
-
-				/* "Start Segment Address Record" will not be supported
-				 * but we must consume it, and do not create an error.  */
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
-			} else if (record_type == 4) {	/* Extended Linear Address Record */
-				uint16_t upper_address;
-
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
-				bytes_read += 4;
-
-				if ((full_address >> 16) != upper_address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						if (image->num_sections >= IMAGE_MAX_SECTIONS) {
-							/* too many sections */
-							LOG_ERROR("Too many sections found in IHEX file");
-							return ERROR_IMAGE_FORMAT_ERROR;
-						}
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&ihex->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address =
-						(full_address & 0xffff) | (upper_address << 16);
-					full_address = (full_address & 0xffff) | (upper_address << 16);
-				}
-			} else if (record_type == 5) {	/* Start Linear Address Record */
-				uint32_t start_address;
-
-				sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &start_address);
-				cal_checksum += (uint8_t)(start_address >> 24);
-				cal_checksum += (uint8_t)(start_address >> 16);
-				cal_checksum += (uint8_t)(start_address >> 8);
-				cal_checksum += (uint8_t)start_address;
-				bytes_read += 8;
-
-				image->start_address_set = true;
-				image->start_address = be_to_h_u32((uint8_t *)&start_address);
-			} else {
-				LOG_ERROR("unhandled IHEX record type: %i", (int)record_type);
-				return ERROR_IMAGE_FORMAT_ERROR;
-			}
+static int image_run_flush(struct image_run_builder *run)
+{
+	if (!run->size)
+		return ERROR_OK;
 
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
+	int retval = run->handler(run->priv, run->offset + run->address, run->data, run->size);
+	run->address += run->size;
+	run->size = 0;
+	return retval;
+}
 
-			if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1)) {
-				/* checksum failed */
-				LOG_ERROR("incorrect record checksum found in IHEX file");
-				return ERROR_IMAGE_CHECKSUM;
-			}
+static int image_run_add(struct image_run_builder *run, uint32_t address,
+	const uint8_t *data, uint32_t count)
+{
+	int retval;
 
-			if (end_rec) {
-				end_rec = false;
-				LOG_WARNING("continuing after end-of-file record: %.40s", lpsz_line);
-			}
+	if (run->size && address != run->address + run->size) {
+		/* we encountered a nonconsecutive location, the run is complete */
+		retval = image_run_flush(run);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	if (!run->size)
+		run->address = address;
+
+	while (count) {
+		uint32_t chunk = MIN(count, IMAGE_STREAM_RUN_SIZE - run->size);
+		memcpy(run->data + run->size, data, chunk);
+		run->size += chunk;
+		data += chunk;
+		count -= chunk;
+
+		if (run->size == IMAGE_STREAM_RUN_SIZE) {
+			retval = image_run_flush(run);
+			if (retval != ERROR_OK)
+				return retval;
 		}
 	}
 
-	if (end_rec)
-		return ERROR_OK;
-	else {
-		LOG_ERROR("premature end of IHEX file, no matching end-of-file record found");
-		return ERROR_IMAGE_FORMAT_ERROR;
-	}
+	return ERROR_OK;
 }
 
-/**
- * Allocate memory dynamically instead of on the stack. This
- * is important w/embedded hosts.
+/*
+ * Parse an IHEX file record by record, each run of data is handed over as
+ * soon as it is complete.
  */
-static int image_ihex_buffer_complete(struct image *image)
+static int image_ihex_parse(struct image *image, struct fileio *fileio,
+	char *lpsz_line, struct image_run_builder *run)
 {
-	char *lpsz_line = malloc(1023);
-	if (!lpsz_line) {
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
-	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
-	if (!section) {
-		free(lpsz_line);
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
+	uint32_t full_address = 0x0;
+	bool end_rec = false;
 	int retval;
 
-	retval = image_ihex_buffer_complete_inner(image, lpsz_line, section);
+	while (fileio_fgets(fileio, 1023, lpsz_line) == ERROR_OK) {
+		uint8_t record[IMAGE_RECORD_MAX_SIZE];
+		uint32_t count;
+		uint32_t address;
+		uint32_t record_type;
+		const uint8_t *data;
+
+		/* skip comments and blank lines */
+		if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
+			continue;
+
+		if (end_rec) {
+			end_rec = false;
+			full_address = 0x0;
+			LOG_WARNING("continuing after end-of-file record: %.40s", lpsz_line);
+		}
 
-	free(section);
-	free(lpsz_line);
+		/* decode the whole record at once, it ends with the checksum byte */
+		if (lpsz_line[0] != ':')
+			return ERROR_IMAGE_FORMAT_ERROR;
+		size_t record_size = unhexify(record, &lpsz_line[1], sizeof(record));
+		if (record_size < 5 || record_size < record[0] + 5u)
+			return ERROR_IMAGE_FORMAT_ERROR;
+
+		count = record[0];
+		address = be_to_h_u16(&record[1]);
+		record_type = record[3];
+		data = &record[4];
+
+		if (record_type != 1 && image_record_checksum(record, count + 5) != 0) {
+			/* checksum failed */
+			LOG_ERROR("incorrect record checksum found in IHEX file");
+			return ERROR_IMAGE_CHECKSUM;
+		}
 
-	return retval;
+		if (record_type == 0) {	/* Data Record */
+			if ((full_address & 0xffff) != address)
+				full_address = (full_address & 0xffff0000) | address;
+
+			retval = image_run_add(run, full_address, data, count);
+			if (retval != ERROR_OK)
+				return retval;
+			full_address += count;
+		} else if (record_type == 1) {	/* End of File Record */
+			retval = image_run_flush(run);
+			if (retval != ERROR_OK)
+				return retval;
+			end_rec = true;
+		} else if (record_type == 2) {	/* Linear Address Record */
+			if (count < 2)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			uint16_t upper_address = be_to_h_u16(data);
+
+			if ((full_address >> 4) != upper_address)
+				full_address = (full_address & 0xffff) | (upper_address << 4);
+		} else if (record_type == 3) {	/* Start Segment Address Record */
+			/* "Start Segment Address Record" will not be supported
+			 * but we must consume it, and do not create an error.  */
+		} else if (record_type == 4) {	/* Extended Linear Address Record */
+			if (count < 2)
+				return ERROR_IMAGE_FORMAT_ERROR;
+			uint16_t upper_address = be_to_h_u16(data);
+
+			if ((full_address >> 16) != upper_address)
+				full_address = (full_address & 0xffff) | (upper_address << 16);
+		} else if (record_type == 5) {	/* Start Linear Address Record */
+			if (count < 4)
+				return ERROR_IMAGE_FORMAT_ERROR;
+
+			image->start_address_set = true;
+			image->start_address = be_to_h_u32(data);
+		} else {
+			LOG_ERROR("unhandled IHEX record type: %i", (int)record_type);
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+	}
+
+	if (!end_rec) {
+		LOG_ERROR("premature end of IHEX file, no matching end-of-file record found");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	return ERROR_OK;
 }
 
 static int image_elf32_read_headers(struct image *image)
@@ -748,205 +679,188 @@ static int image_elf_read_section(struct image *image,
 		return image_elf32_read_section(image, section, offset, size, buffer, size_read);
 }
 
-static int image_mot_buffer_complete_inner(struct image *image,
-	char *lpsz_line,
-	struct imagesection *section)
+/*
+ * Parse a S19 file record by record, each run of data is handed over as
+ * soon as it is complete.
+ */
+static int image_mot_parse(struct image *image, struct fileio *fileio,
+	char *lpsz_line, struct image_run_builder *run)
 {
-	struct image_mot *mot = image->type_private;
-	struct fileio *fileio = mot->fileio;
-	uint32_t full_address;
-	uint32_t cooked_bytes;
+	uint32_t full_address = 0x0;
 	bool end_rec = false;
-
-	/* we can't determine the number of sections that we'll have to create ahead of time,
-	 * so we locally hold them until parsing is finished */
-
 	int retval;
-	size_t filesize;
-	retval = fileio_size(fileio, &filesize);
-	if (retval != ERROR_OK)
-		return retval;
-
-	mot->buffer = malloc(filesize >> 1);
-	cooked_bytes = 0x0;
-	image->num_sections = 0;
-
-	while (!fileio_feof(fileio)) {
-		full_address = 0x0;
-		section[image->num_sections].private = &mot->buffer[cooked_bytes];
-		section[image->num_sections].base_address = 0x0;
-		section[image->num_sections].size = 0x0;
-		section[image->num_sections].flags = 0;
-
-		while (fileio_fgets(fileio, 1023, lpsz_line) == ERROR_OK) {
-			uint32_t count;
-			uint32_t address;
-			uint32_t record_type;
-			uint32_t checksum;
-			uint8_t cal_checksum = 0;
-			uint32_t bytes_read = 0;
-
-			/* skip comments and blank lines */
-			if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
-				continue;
-
-			/* get record type and record length */
-			if (sscanf(&lpsz_line[bytes_read], "S%1" SCNx32 "%2" SCNx32, &record_type,
-				&count) != 2)
-				return ERROR_IMAGE_FORMAT_ERROR;
-
-			bytes_read += 4;
-			cal_checksum += (uint8_t)count;
 
-			/* skip checksum byte */
-			count -= 1;
+	while (fileio_fgets(fileio, 1023, lpsz_line) == ERROR_OK) {
+		uint8_t record[IMAGE_RECORD_MAX_SIZE];
+		uint32_t count;
+		uint32_t address;
+		uint32_t record_type;
+		unsigned int address_size;
+
+		/* skip comments and blank lines */
+		if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
+			continue;
+
+		if (end_rec) {
+			end_rec = false;
+			full_address = 0x0;
+			LOG_WARNING("continuing after end-of-file record: %.40s", lpsz_line);
+		}
 
-			if (record_type == 0) {
-				/* S0 - starting record (optional) */
-				int value;
+		/* get record type, then decode record length, address, data
+		 * and checksum at once */
+		if (lpsz_line[0] != 'S' || lpsz_line[1] < '0' || lpsz_line[1] > '9')
+			return ERROR_IMAGE_FORMAT_ERROR;
+		record_type = lpsz_line[1] - '0';
 
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					cal_checksum += (uint8_t)value;
-					bytes_read += 2;
-				}
-			} else if (record_type >= 1 && record_type <= 3) {
-				switch (record_type) {
-					case 1:
-						/* S1 - 16 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%4" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 4;
-						count -= 2;
-						break;
-
-					case 2:
-						/* S2 - 24 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%6" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 6;
-						count -= 3;
-						break;
-
-					case 3:
-						/* S3 - 32 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 24);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
-						bytes_read += 8;
-						count -= 4;
-						break;
+		size_t record_size = unhexify(record, &lpsz_line[2], sizeof(record));
+		if (record_size < 1 || record[0] < 1 || record_size < record[0] + 1u)
+			return ERROR_IMAGE_FORMAT_ERROR;
 
-				}
+		/* skip checksum byte */
+		count = record[0] - 1;
 
-				if (full_address != address) {
-					/* we encountered a nonconsecutive location, create a new section,
-					 * unless the current section has zero size, in which case this specifies
-					 * the current section's base address
-					 */
-					if (section[image->num_sections].size != 0) {
-						image->num_sections++;
-						section[image->num_sections].size = 0x0;
-						section[image->num_sections].flags = 0;
-						section[image->num_sections].private =
-							&mot->buffer[cooked_bytes];
-					}
-					section[image->num_sections].base_address = address;
-					full_address = address;
-				}
-
-				while (count-- > 0) {
-					unsigned value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					mot->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
-				}
-			} else if (record_type == 5 || record_type == 6) {
-				/* S5 and S6 are the data count records, we ignore them */
-				uint32_t dummy;
-
-				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
-					bytes_read += 2;
-				}
-			} else if (record_type >= 7 && record_type <= 9) {
-				/* S7, S8, S9 - ending records for 32, 24 and 16bit */
-				image->num_sections++;
-
-				/* copy section information */
-				image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
-				for (unsigned int i = 0; i < image->num_sections; i++) {
-					image->sections[i].private = section[i].private;
-					image->sections[i].base_address = section[i].base_address;
-					image->sections[i].size = section[i].size;
-					image->sections[i].flags = section[i].flags;
-				}
+		if (record_type < 7 && image_record_checksum(record, count + 2) != 0xff) {
+			/* checksum failed */
+			LOG_ERROR("incorrect record checksum found in S19 file");
+			return ERROR_IMAGE_CHECKSUM;
+		}
 
-				end_rec = true;
-				break;
-			} else {
-				LOG_ERROR("unhandled S19 record type: %i", (int)(record_type));
+		if (record_type == 0) {
+			/* S0 - starting record (optional) */
+		} else if (record_type >= 1 && record_type <= 3) {
+			/* S1, S2, S3 - 16, 24 and 32 bit address data records */
+			address_size = record_type + 1;
+			if (count < address_size)
 				return ERROR_IMAGE_FORMAT_ERROR;
-			}
-
-			/* account for checksum, will always be 0xFF */
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
-			cal_checksum += (uint8_t)checksum;
-
-			if (cal_checksum != 0xFF) {
-				/* checksum failed */
-				LOG_ERROR("incorrect record checksum found in S19 file");
-				return ERROR_IMAGE_CHECKSUM;
-			}
 
-			if (end_rec) {
-				end_rec = false;
-				LOG_WARNING("continuing after end-of-file record: %.40s", lpsz_line);
-			}
+			address = 0;
+			for (unsigned int i = 0; i < address_size; i++)
+				address = (address << 8) | record[1 + i];
+			count -= address_size;
+
+			full_address = address;
+			retval = image_run_add(run, full_address, &record[1 + address_size], count);
+			if (retval != ERROR_OK)
+				return retval;
+			full_address += count;
+		} else if (record_type == 5 || record_type == 6) {
+			/* S5 and S6 are the data count records, we ignore them */
+		} else if (record_type >= 7 && record_type <= 9) {
+			/* S7, S8, S9 - ending records for 32, 24 and 16bit */
+			retval = image_run_flush(run);
+			if (retval != ERROR_OK)
+				return retval;
+			end_rec = true;
+		} else {
+			LOG_ERROR("unhandled S19 record type: %i", (int)(record_type));
+			return ERROR_IMAGE_FORMAT_ERROR;
 		}
 	}
 
-	if (end_rec)
-		return ERROR_OK;
-	else {
+	if (!end_rec) {
 		LOG_ERROR("premature end of S19 file, no matching end-of-file record found");
 		return ERROR_IMAGE_FORMAT_ERROR;
 	}
+
+	return ERROR_OK;
+}
+
+/* builds the sections of an IHEX or S19 image from its runs */
+struct image_section_builder {
+	struct image *image;
+	const char *format;
+	/* we can't determine the number of sections that we'll have to create
+	 * ahead of time, so we locally hold them until parsing is finished */
+	struct imagesection *sections;
+	uint8_t *buffer;
+	uint32_t cooked_bytes;
+};
+
+static int image_section_add_run(void *priv, target_addr_t address,
+	const uint8_t *data, uint32_t size)
+{
+	struct image_section_builder *builder = priv;
+	struct image *image = builder->image;
+	struct imagesection *section = NULL;
+
+	if (image->num_sections)
+		section = &builder->sections[image->num_sections - 1];
+
+	if (!section || section->base_address + section->size != address) {
+		if (image->num_sections == IMAGE_MAX_SECTIONS) {
+			/* too many sections */
+			LOG_ERROR("Too many sections found in %s file", builder->format);
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		section = &builder->sections[image->num_sections++];
+		section->base_address = address;
+		section->size = 0x0;
+		section->flags = 0;
+		section->private = &builder->buffer[builder->cooked_bytes];
+	}
+
+	memcpy(&builder->buffer[builder->cooked_bytes], data, size);
+	builder->cooked_bytes += size;
+	section->size += size;
+
+	return ERROR_OK;
 }
 
 /**
+ * Parse a whole IHEX or S19 file into sections, held in a buffer.
  * Allocate memory dynamically instead of on the stack. This
  * is important w/embedded hosts.
  */
-static int image_mot_buffer_complete(struct image *image)
+static int image_records_buffer_complete(struct image *image, struct fileio *fileio,
+	uint8_t **buffer)
 {
+	size_t filesize;
+	int retval = fileio_size(fileio, &filesize);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* each data byte takes two characters in the file */
+	struct image_section_builder builder = {
+		.image = image,
+		.format = image->type == IMAGE_IHEX ? "IHEX" : "S19",
+		.sections = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS),
+		.buffer = malloc((filesize >> 1) + 1),
+	};
+	struct image_run_builder run = {
+		.handler = image_section_add_run,
+		.priv = &builder,
+		.data = malloc(IMAGE_STREAM_RUN_SIZE),
+	};
 	char *lpsz_line = malloc(1023);
-	if (!lpsz_line) {
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
-	struct imagesection *section = malloc(sizeof(struct imagesection) * IMAGE_MAX_SECTIONS);
-	if (!section) {
-		free(lpsz_line);
+
+	*buffer = builder.buffer;
+	image->num_sections = 0;
+
+	if (!builder.sections || !builder.buffer || !run.data || !lpsz_line) {
 		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+	} else if (image->type == IMAGE_IHEX) {
+		retval = image_ihex_parse(image, fileio, lpsz_line, &run);
+	} else {
+		retval = image_mot_parse(image, fileio, lpsz_line, &run);
 	}
-	int retval;
 
-	retval = image_mot_buffer_complete_inner(image, lpsz_line, section);
+	if (retval == ERROR_OK) {
+		/* copy section information */
+		image->sections = malloc(sizeof(struct imagesection) * image->num_sections);
+		if (image->sections) {
+			memcpy(image->sections, builder.sections,
+				sizeof(struct imagesection) * image->num_sections);
+		} else if (image->num_sections) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+		}
+	}
 
-	free(section);
 	free(lpsz_line);
+	free(run.data);
+	free(builder.sections);
 
 	return retval;
 }
@@ -988,7 +902,7 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = image_ihex_buffer_complete(image);
+		retval = image_records_buffer_complete(image, image_ihex->fileio, &image_ihex->buffer);
 		if (retval != ERROR_OK) {
 			LOG_ERROR(
 				"failed buffering IHEX image, check server output for additional information");
@@ -1039,7 +953,7 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = image_mot_buffer_complete(image);
+		retval = image_records_buffer_complete(image, image_mot->fileio, &image_mot->buffer);
 		if (retval != ERROR_OK) {
 			LOG_ERROR(
 				"failed buffering S19 image, check server output for additional information");
@@ -1067,6 +981,45 @@ int image_open(struct image *image, const char *url, const char *type_string)
 	return retval;
 };
 
+int image_stream(struct image *image, const char *url, const char *type_string,
+	image_run_handler_t handler, void *priv)
+{
+	int retval = identify_image_type(image, type_string, url);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (image->type != IMAGE_IHEX && image->type != IMAGE_SRECORD)
+		return ERROR_NOT_IMPLEMENTED;
+
+	struct fileio *fileio;
+	retval = fileio_open(&fileio, url, FILEIO_READ, FILEIO_TEXT);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct image_run_builder run = {
+		.handler = handler,
+		.priv = priv,
+		.offset = image->base_address_set ? image->base_address : 0,
+		.data = malloc(IMAGE_STREAM_RUN_SIZE),
+	};
+	char *lpsz_line = malloc(1023);
+
+	if (!run.data || !lpsz_line) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+	} else if (image->type == IMAGE_IHEX) {
+		retval = image_ihex_parse(image, fileio, lpsz_line, &run);
+	} else {
+		retval = image_mot_parse(image, fileio, lpsz_line, &run);
+	}
+
+	free(lpsz_line);
+	free(run.data);
+	fileio_close(fileio);
+
+	return retval;
+}
+
 int image_read_section(struct image *image,
 	int section,
 	target_addr_t offset,
@@ -1162,6 +1115,109 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+static int image_elf_borrow_section(struct image *image, int section,
+	target_addr_t offset, uint32_t size, const uint8_t **data)
+{
+	struct image_elf *elf = image->type_private;
+	const uint8_t *map;
+	uint64_t file_offset, file_size;
+
+	if (elf->is_64_bit) {
+		Elf64_Phdr *segment = image->sections[section].private;
+		file_offset = field64(elf, segment->p_offset);
+		file_size = field64(elf, segment->p_filesz);
+	} else {
+		Elf32_Phdr *segment = image->sections[section].private;
+		file_offset = field32(elf, segment->p_offset);
+		file_size = field32(elf, segment->p_filesz);
+	}
+
+	/* only the initialized part of a segment is present in the file */
+	if (offset + size > file_size)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	int retval = fileio_mmap(elf->fileio, &map);
+	if (retval != ERROR_OK)
+		return retval;
+
+	size_t map_size;
+	fileio_size(elf->fileio, &map_size);
+	if (file_offset + offset + size > map_size)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	*data = map + file_offset + offset;
+	return ERROR_OK;
+}
+
+int image_borrow_section(struct image *image,
+	int section,
+	target_addr_t offset,
+	uint32_t size,
+	const uint8_t **data,
+	size_t *size_read)
+{
+	int retval;
+
+	/* don't read past the end of a section */
+	if (offset + size > image->sections[section].size)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (image->type == IMAGE_BINARY) {
+		struct image_binary *image_binary = image->type_private;
+		const uint8_t *map;
+
+		/* only one section in a plain binary */
+		if (section != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		retval = fileio_mmap(image_binary->fileio, &map);
+		if (retval != ERROR_OK)
+			return retval;
+
+		*data = map + offset;
+	} else if (image->type == IMAGE_ELF) {
+		retval = image_elf_borrow_section(image, section, offset, size, data);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (image->type == IMAGE_IHEX || image->type == IMAGE_SRECORD ||
+			image->type == IMAGE_BUILDER) {
+		/* these are kept in memory anyway */
+		*data = (const uint8_t *)image->sections[section].private + offset;
+	} else {
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+	}
+
+	*size_read = size;
+	return ERROR_OK;
+}
+
+int image_get_section(struct image *image, int section,
+	const uint8_t **data, uint8_t **buffer, size_t *size_read)
+{
+	uint32_t size = image->sections[section].size;
+
+	*buffer = NULL;
+
+	if (image_borrow_section(image, section, 0, size, data, size_read) == ERROR_OK)
+		return ERROR_OK;
+
+	*buffer = malloc(size);
+	if (!*buffer) {
+		LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", size);
+		return ERROR_FAIL;
+	}
+
+	int retval = image_read_section(image, section, 0, size, *buffer, size_read);
+	if (retval != ERROR_OK) {
+		free(*buffer);
+		*buffer = NULL;
+		return retval;
+	}
+
+	*data = *buffer;
+	return ERROR_OK;
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, uint64_t flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1261,31 +1317,12 @@ int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *c
 	uint32_t crc = 0xffffffff;
 	LOG_DEBUG("Calculating checksum");
 
-	static uint32_t crc32_table[256];
-
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
-		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
-		}
-
-		first_init = true;
-	}
-
 	while (nbytes > 0) {
-		int run = nbytes;
-		if (run > 32768)
-			run = 32768;
+		uint32_t run = MIN(nbytes, 32768u);
+		/* as per gdb */
+		crc = crc32_be(CRC32_POLY_BE, crc, buffer, run);
+		buffer += run;
 		nbytes -= run;
-		while (run--) {
-			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
-		}
 		keep_alive();
 	}
 
@@ -29,6 +29,9 @@
 
 #define IMAGE_MEMORY_CACHE_SIZE		(2048)
 
+/* largest run handed to an image_run_handler_t */
+#define IMAGE_STREAM_RUN_SIZE		(64 * 1024)
+
 enum image_type {
 	IMAGE_BINARY,	/* plain binary */
 	IMAGE_IHEX,		/* intel hex-record format */
@@ -91,9 +94,49 @@ struct image_mot {
 	uint8_t *buffer;
 };
 
+/**
+ * Receives the data of an image parsed by image_stream(), in file order.
+ * Runs following each other at contiguous addresses belong to the same
+ * section of the image.
+ */
+typedef int (*image_run_handler_t)(void *priv, target_addr_t address,
+		const uint8_t *data, uint32_t size);
+
 int image_open(struct image *image, const char *url, const char *type_string);
+
+/**
+ * Parse an IHEX or S19 image record by record, and hand its data over to
+ * @a handler in contiguous runs of at most IMAGE_STREAM_RUN_SIZE bytes as
+ * soon as they are complete, without building the sections in memory.
+ * The base address of @a image is applied, its start address is set; there
+ * is nothing to close afterwards.
+ * @returns ERROR_OK, the error of the parser or of @a handler, or
+ * ERROR_NOT_IMPLEMENTED for the other image types, which are only read
+ * with image_open().
+ */
+int image_stream(struct image *image, const char *url, const char *type_string,
+		image_run_handler_t handler, void *priv);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+
+/**
+ * Get a pointer to the content of a section without copying it. This
+ * works for memory mapped binary and ELF files and for the image types
+ * that are buffered in memory.
+ * @param data Receives a pointer that stays valid until image_close().
+ * @returns ERROR_OK, or ERROR_FILEIO_OPERATION_NOT_SUPPORTED if the data
+ * must be read with image_read_section() instead.
+ */
+int image_borrow_section(struct image *image, int section, target_addr_t offset,
+		uint32_t size, const uint8_t **data, size_t *size_read);
+
+/**
+ * Get the whole content of a section, borrowed from the image when
+ * possible. Otherwise it is read into a new buffer returned in @a buffer,
+ * which the caller must free; @a buffer is NULL for borrowed data.
+ */
+int image_get_section(struct image *image, int section,
+		const uint8_t **data, uint8_t **buffer, size_t *size_read);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, target_addr_t base, uint32_t size,
@@ -262,6 +262,22 @@ static int mem_ap_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(mem_ap->ap, buffer, size, count, address);
 }
 
+static int mem_ap_read_buffer(struct target *target, target_addr_t address,
+			       uint32_t count, uint8_t *buffer)
+{
+	struct mem_ap *mem_ap = target->arch_info;
+
+	return mem_ap_read_bytes(mem_ap->ap, buffer, count, address);
+}
+
+static int mem_ap_write_buffer(struct target *target, target_addr_t address,
+				uint32_t count, const uint8_t *buffer)
+{
+	struct mem_ap *mem_ap = target->arch_info;
+
+	return mem_ap_write_bytes(mem_ap->ap, buffer, count, address);
+}
+
 struct target_type mem_ap_target = {
 	.name = "mem_ap",
 
@@ -286,4 +302,6 @@ struct target_type mem_ap_target = {
 
 	.read_memory = mem_ap_read_memory,
 	.write_memory = mem_ap_write_memory,
+	.read_buffer = mem_ap_read_buffer,
+	.write_buffer = mem_ap_write_buffer,
 };
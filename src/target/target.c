@@ -31,6 +31,7 @@
 #endif
 
 #include <helper/align.h>
+#include <helper/crc32.h>
 #include <helper/nvp.h>
 #include <helper/time_support.h>
 #include <jtag/jtag.h>
@@ -49,6 +50,10 @@
 #include "smp.h"
 #include "semihosting_common.h"
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
 
@@ -823,6 +828,7 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_memory_changed();
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -868,6 +874,7 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_memory_changed();
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -1293,6 +1300,19 @@ int target_read_phys_memory(struct target *target,
 	return target->type->read_phys_memory(target, address, size, count, buffer);
 }
 
+/* bumped each time the content of any target memory may have changed */
+static unsigned int target_memory_gen;
+
+void target_memory_changed(void)
+{
+	target_memory_gen++;
+}
+
+unsigned int target_memory_generation(void)
+{
+	return target_memory_gen;
+}
+
 int target_write_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -1304,6 +1324,7 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_memory_changed();
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1318,6 +1339,7 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_memory_changed();
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1783,7 +1805,7 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		if ((c->callback == callback) && (c->priv == priv) && !c->removed) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1797,6 +1819,20 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	struct target_event_callback *callback = target_event_callbacks;
 	struct target_event_callback *next_callback;
 
+	switch (event) {
+	case TARGET_EVENT_GDB_HALT:
+	case TARGET_EVENT_GDB_START:
+	case TARGET_EVENT_GDB_END:
+	case TARGET_EVENT_GDB_ATTACH:
+	case TARGET_EVENT_GDB_DETACH:
+	case TARGET_EVENT_TRACE_CONFIG:
+		break;
+	default:
+		/* the target ran, was reset or had its flash modified */
+		target_memory_changed();
+		break;
+	}
+
 	if (event == TARGET_EVENT_HALTED) {
 		/* execute early halted first */
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
@@ -1824,6 +1860,8 @@ int target_call_reset_callbacks(struct target *target, enum target_reset_mode re
 	LOG_DEBUG("target reset %i (%s)", reset_mode,
 			nvp_value2name(nvp_reset_modes, reset_mode)->name);
 
+	target_memory_changed();
+
 	list_for_each_entry(callback, &target_reset_callback_list, list)
 		callback->callback(target, reset_mode, callback->priv);
 
@@ -2388,6 +2426,7 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target_memory_changed();
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -3618,8 +3657,69 @@ static COMMAND_HELPER(parse_load_image_command, struct image *image,
 	return ERROR_OK;
 }
 
+/* load_image of an image streamed by image_stream() */
+struct load_image_stream {
+	struct command_invocation *cmd;
+	struct target *target;
+	target_addr_t min_address;
+	target_addr_t max_address;
+	uint32_t image_size;
+	/* contiguous data written so far, reported once complete */
+	target_addr_t written_address;
+	uint32_t written_size;
+};
+
+static void load_image_stream_report(struct load_image_stream *stream)
+{
+	if (!stream->written_size)
+		return;
+
+	command_print(stream->cmd, "%u bytes written at address " TARGET_ADDR_FMT "",
+			(unsigned int)stream->written_size, stream->written_address);
+	stream->written_size = 0;
+}
+
+static int load_image_stream_write(void *priv, target_addr_t address,
+		const uint8_t *data, uint32_t size)
+{
+	struct load_image_stream *stream = priv;
+	uint32_t offset = 0;
+	uint32_t length = size;
+
+	/* DANGER!!! beware of unsigned comparison here!!! */
+
+	if (address + size < stream->min_address || address >= stream->max_address)
+		return ERROR_OK;
+
+	if (address < stream->min_address) {
+		/* clip addresses below */
+		offset += stream->min_address - address;
+		length -= offset;
+	}
+
+	if (address + size > stream->max_address)
+		length -= (address + size) - stream->max_address;
+
+	if (!length)
+		return ERROR_OK;
+
+	if (stream->written_address + stream->written_size != address + offset)
+		load_image_stream_report(stream);
+	if (!stream->written_size)
+		stream->written_address = address + offset;
+
+	int retval = target_write_buffer(stream->target, address + offset, length, data + offset);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stream->written_size += length;
+	stream->image_size += length;
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_load_image_command)
 {
+	const uint8_t *data;
 	uint8_t *buffer;
 	size_t buf_cnt;
 	uint32_t image_size;
@@ -3637,26 +3737,38 @@ COMMAND_HANDLER(handle_load_image_command)
 	struct duration bench;
 	duration_start(&bench);
 
+	/* IHEX and S19 files are written while they are parsed */
+	struct load_image_stream stream = {
+		.cmd = CMD,
+		.target = target,
+		.min_address = min_address,
+		.max_address = max_address,
+	};
+	retval = image_stream(&image, CMD_ARGV[0], (CMD_ARGC >= 3) ? CMD_ARGV[2] : NULL,
+			load_image_stream_write, &stream);
+	if (retval != ERROR_NOT_IMPLEMENTED) {
+		load_image_stream_report(&stream);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (duration_measure(&bench) == ERROR_OK) {
+			command_print(CMD, "downloaded %" PRIu32 " bytes "
+					"in %fs (%0.3f KiB/s)", stream.image_size,
+					duration_elapsed(&bench), duration_kbps(&bench, stream.image_size));
+		}
+		return ERROR_OK;
+	}
+
 	if (image_open(&image, CMD_ARGV[0], (CMD_ARGC >= 3) ? CMD_ARGV[2] : NULL) != ERROR_OK)
 		return ERROR_FAIL;
 
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
-
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		/* large images are written straight from the file mapping */
+		retval = image_get_section(&image, i, &data, &buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		uint32_t offset = 0;
 		uint32_t length = buf_cnt;
@@ -3676,7 +3788,7 @@ COMMAND_HANDLER(handle_load_image_command)
 				length -= (image.sections[i].base_address + buf_cnt)-max_address;
 
 			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
+					image.sections[i].base_address + offset, length, data + offset);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3770,8 +3882,136 @@ enum verify_mode {
 	IMAGE_CHECKSUM_ONLY = 2
 };
 
+#ifdef HAVE_PTHREAD_H
+/*
+ * Reads the sections of the image and computes their checksum ahead of the
+ * command: section i + 1 is prepared while the target computes the checksum
+ * of section i. A single thread serves all the sections of the image.
+ */
+struct verify_image_worker {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct image *image;
+	/* section to prepare, -1 if none */
+	int request;
+	bool quit;
+	/* the prepared section, owned by the worker until collected */
+	bool ready;
+	const uint8_t *data;
+	uint8_t *buffer;
+	size_t size;
+	uint32_t checksum;
+	int retval;
+};
+
+static void *verify_image_worker_thread(void *arg)
+{
+	struct verify_image_worker *worker = arg;
+
+	pthread_mutex_lock(&worker->lock);
+	while (true) {
+		while (worker->request < 0 && !worker->quit)
+			pthread_cond_wait(&worker->cond, &worker->lock);
+		if (worker->quit)
+			break;
+		int section = worker->request;
+		pthread_mutex_unlock(&worker->lock);
+
+		/* runs concurrently with the command, so no keep_alive(); the log
+		 * of other threads is deferred */
+		const uint8_t *data = NULL;
+		uint8_t *buffer = NULL;
+		size_t size = 0;
+		uint32_t checksum = 0;
+		int retval = image_get_section(worker->image, section, &data, &buffer, &size);
+		if (retval == ERROR_OK)
+			checksum = crc32_be(CRC32_POLY_BE, 0xffffffff, data, size);
+
+		pthread_mutex_lock(&worker->lock);
+		worker->data = data;
+		worker->buffer = buffer;
+		worker->size = size;
+		worker->checksum = checksum;
+		worker->retval = retval;
+		worker->request = -1;
+		worker->ready = true;
+		pthread_cond_broadcast(&worker->cond);
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	return NULL;
+}
+
+static bool verify_image_worker_start(struct verify_image_worker *worker, struct image *image)
+{
+	*worker = (struct verify_image_worker) {
+		.image = image,
+		.request = -1,
+	};
+
+	crc32_init();
+	if (pthread_mutex_init(&worker->lock, NULL) != 0)
+		return false;
+	if (pthread_cond_init(&worker->cond, NULL) != 0) {
+		pthread_mutex_destroy(&worker->lock);
+		return false;
+	}
+	if (pthread_create(&worker->thread, NULL, verify_image_worker_thread, worker) != 0) {
+		pthread_cond_destroy(&worker->cond);
+		pthread_mutex_destroy(&worker->lock);
+		return false;
+	}
+
+	return true;
+}
+
+static void verify_image_worker_request(struct verify_image_worker *worker, int section)
+{
+	pthread_mutex_lock(&worker->lock);
+	worker->request = section;
+	pthread_cond_broadcast(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+}
+
+/* Wait for the requested section, which the caller then owns */
+static int verify_image_worker_collect(struct verify_image_worker *worker,
+		const uint8_t **data, uint8_t **buffer, size_t *size, uint32_t *checksum)
+{
+	pthread_mutex_lock(&worker->lock);
+	while (!worker->ready)
+		pthread_cond_wait(&worker->cond, &worker->lock);
+	worker->ready = false;
+	*data = worker->data;
+	*buffer = worker->buffer;
+	*size = worker->size;
+	*checksum = worker->checksum;
+	int retval = worker->retval;
+	pthread_mutex_unlock(&worker->lock);
+
+	return retval;
+}
+
+static void verify_image_worker_stop(struct verify_image_worker *worker)
+{
+	pthread_mutex_lock(&worker->lock);
+	worker->quit = true;
+	pthread_cond_broadcast(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+	pthread_join(worker->thread, NULL);
+
+	/* a section prepared for an iteration that did not happen */
+	if (worker->ready)
+		free(worker->buffer);
+
+	pthread_cond_destroy(&worker->cond);
+	pthread_mutex_destroy(&worker->lock);
+}
+#endif
+
 static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
 {
+	const uint8_t *section_data;
 	uint8_t *buffer;
 	size_t buf_cnt;
 	uint32_t image_size;
@@ -3813,26 +4053,39 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	image_size = 0x0;
 	int diffs = 0;
 	retval = ERROR_OK;
+
+	/* read and checksum the image while the target computes its own; an
+	 * image read from a target can't be read during the target checksum */
+	bool prepared_by_worker = false;
+#ifdef HAVE_PTHREAD_H
+	struct verify_image_worker worker;
+	if (verify >= IMAGE_VERIFY && image.type != IMAGE_MEMORY && image.num_sections > 0)
+		prepared_by_worker = verify_image_worker_start(&worker, &image);
+	if (prepared_by_worker)
+		verify_image_worker_request(&worker, 0);
+#endif
+
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
-			break;
+		if (prepared_by_worker) {
+#ifdef HAVE_PTHREAD_H
+			retval = verify_image_worker_collect(&worker, &section_data, &buffer,
+					&buf_cnt, &checksum);
+			if (retval == ERROR_OK && i + 1 < image.num_sections)
+				verify_image_worker_request(&worker, i + 1);
+#endif
+		} else {
+			retval = image_get_section(&image, i, &section_data, &buffer, &buf_cnt);
 		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		if (verify >= IMAGE_VERIFY) {
-			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
-			if (retval != ERROR_OK) {
-				free(buffer);
-				break;
+			if (!prepared_by_worker) {
+				retval = image_calculate_checksum(section_data, buf_cnt, &checksum);
+				if (retval != ERROR_OK) {
+					free(buffer);
+					break;
+				}
 			}
 
 			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
@@ -3859,13 +4112,13 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				if (retval == ERROR_OK) {
 					uint32_t t;
 					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
+						if (data[t] != section_data[t]) {
 							command_print(CMD,
 										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
 										  diffs,
 										  (unsigned)(t + image.sections[i].base_address),
 										  data[t],
-										  buffer[t]);
+										  section_data[t]);
 							if (diffs++ >= 127) {
 								command_print(CMD, "More than 128 errors, the rest are not printed.");
 								free(data);
@@ -3890,6 +4143,10 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	if (diffs > 0)
 		command_print(CMD, "No more differences found.");
 done:
+#ifdef HAVE_PTHREAD_H
+	if (prepared_by_worker)
+		verify_image_worker_stop(&worker);
+#endif
 	if (diffs > 0)
 		retval = ERROR_FAIL;
 	if ((retval == ERROR_OK) && (duration_measure(&bench) == ERROR_OK)) {
@@ -653,6 +653,22 @@ int target_write_phys_memory(struct target *target,
  */
 int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
+
+/**
+ * Tell the caches of target memory contents that they are stale.
+ *
+ * The memory write wrappers, algorithm runs, reset and the target events
+ * reporting execution or flash changes call it already; code changing
+ * target memory by other means (e.g. flash drivers using the DAP
+ * directly) must call it as well.
+ * Memory can be shared between targets, so this applies to all of them.
+ */
+void target_memory_changed(void);
+/**
+ * @returns A counter incremented by target_memory_changed(); a cache of
+ * target memory is valid as long as this value did not change.
+ */
+unsigned int target_memory_generation(void);
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,